@@ -84,7 +84,7 @@ static void reset_channel (struct channel *);
 static bool check_device_type (struct disk *);
 static void identify_ata_device (struct disk *);
 
-static void select_sector (struct disk *, disk_sector_t);
+static void select_sector (struct disk *, disk_sector_t, size_t sec_cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
@@ -216,7 +216,7 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
 
 	c = d->channel;
 	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
+	select_sector (d, sec_no, 1);
 	issue_pio_command (c, CMD_READ_SECTOR_RETRY);
 	sema_down (&c->completion_wait);
 	if (!wait_while_busy (d))
@@ -240,7 +240,7 @@ disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
 
 	c = d->channel;
 	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
+	select_sector (d, sec_no, 1);
 	issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
 	if (!wait_while_busy (d))
 		PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
@@ -249,6 +249,81 @@ disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
 	d->write_cnt++;
 	lock_release (&c->lock);
 }
+
+/* Reads SEC_CNT consecutive sectors, starting at SEC_NO, from disk
+   D.  Sector SEC_NO + I is stored in SECTORS[I], which must have
+   room for DISK_SECTOR_SIZE bytes.  Unlike calling disk_read()
+   for each sector, this issues one command for up to
+   DISK_MAX_SECTORS sectors at a time.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void
+disk_readv (struct disk *d, disk_sector_t sec_no, void *const sectors[],
+		size_t sec_cnt) {
+	struct channel *c;
+	size_t i;
+
+	ASSERT (d != NULL);
+	ASSERT (sectors != NULL);
+
+	c = d->channel;
+	lock_acquire (&c->lock);
+	for (i = 0; i < sec_cnt; i++) {
+		if (i % DISK_MAX_SECTORS == 0) {
+			size_t left = sec_cnt - i;
+
+			select_sector (d, sec_no + i,
+					left < DISK_MAX_SECTORS ? left : DISK_MAX_SECTORS);
+			issue_pio_command (c, CMD_READ_SECTOR_RETRY);
+		}
+		/* The device interrupts as each sector becomes ready. */
+		sema_down (&c->completion_wait);
+		if (!wait_while_busy (d))
+			PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name,
+					(disk_sector_t) (sec_no + i));
+		input_sector (c, sectors[i]);
+	}
+	d->read_cnt += sec_cnt;
+	lock_release (&c->lock);
+}
+
+/* Writes SEC_CNT consecutive sectors, starting at SEC_NO, to disk
+   D.  SECTORS[I] holds the DISK_SECTOR_SIZE bytes for sector
+   SEC_NO + I.  Returns after the disk has acknowledged receiving
+   the data.  Issues one command for up to DISK_MAX_SECTORS
+   sectors at a time.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void
+disk_writev (struct disk *d, disk_sector_t sec_no,
+		const void *const sectors[], size_t sec_cnt) {
+	struct channel *c;
+	size_t i;
+
+	ASSERT (d != NULL);
+	ASSERT (sectors != NULL);
+
+	c = d->channel;
+	lock_acquire (&c->lock);
+	for (i = 0; i < sec_cnt; i++) {
+		if (i % DISK_MAX_SECTORS == 0) {
+			size_t left = sec_cnt - i;
+
+			select_sector (d, sec_no + i,
+					left < DISK_MAX_SECTORS ? left : DISK_MAX_SECTORS);
+			issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
+		}
+		/* The device asks for each sector in turn and interrupts
+		   once it has taken it. */
+		if (!wait_while_busy (d))
+			PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name,
+					(disk_sector_t) (sec_no + i));
+		output_sector (c, sectors[i]);
+		sema_down (&c->completion_wait);
+	}
+	d->write_cnt += sec_cnt;
+	lock_release (&c->lock);
+}
 
 /* Disk detection and identification. */
 
@@ -402,17 +477,20 @@ print_ata_string (char *string, size_t size) {
 }
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and SEC_CNT, which must be between 1 and
+   DISK_MAX_SECTORS, to the disk's sector selection registers.
+   (We use LBA mode.) */
 static void
-select_sector (struct disk *d, disk_sector_t sec_no) {
+select_sector (struct disk *d, disk_sector_t sec_no, size_t sec_cnt) {
 	struct channel *c = d->channel;
 
-	ASSERT (sec_no < d->capacity);
+	ASSERT (sec_cnt >= 1 && sec_cnt <= DISK_MAX_SECTORS);
+	ASSERT (sec_no + sec_cnt <= d->capacity);
 	ASSERT (sec_no < (1UL << 28));
 
 	select_device_wait (d);
-	outb (reg_nsect (c), 1);
+	/* A count of 0 asks for DISK_MAX_SECTORS sectors. */
+	outb (reg_nsect (c), sec_cnt % DISK_MAX_SECTORS);
 	outb (reg_lbal (c), sec_no);
 	outb (reg_lbam (c), sec_no >> 8);
 	outb (reg_lbah (c), (sec_no >> 16));
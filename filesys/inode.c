@@ -33,6 +33,7 @@ struct inode {
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+	unsigned write_gen;                 /* Bumped by every write. */
 	struct inode_disk data;             /* Inode content. */
 };
 
@@ -124,6 +125,7 @@ inode_open (disk_sector_t sector) {
 	inode->sector = sector;
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
+	inode->write_gen = 0;
 	inode->removed = false;
 	disk_read (filesys_disk, inode->sector, &inode->data);
 	return inode;
@@ -176,6 +178,21 @@ inode_remove (struct inode *inode) {
 	inode->removed = true;
 }
 
+/* Returns true if INODE has been removed, to be deleted once its last
+ * opener closes it. */
+bool
+inode_is_removed (const struct inode *inode) {
+	return inode->removed;
+}
+
+/* Returns a number that changes whenever INODE is written, for caches
+ * of data derived from its contents to tell whether they are stale.  It
+ * only means something while INODE is kept open. */
+unsigned
+inode_write_gen (const struct inode *inode) {
+	return inode->write_gen;
+}
+
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
  * Returns the number of bytes actually read, which may be less
  * than SIZE if an error occurs or end of file is reached. */
@@ -239,6 +256,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
 	if (inode->deny_write_cnt)
 		return 0;
+	inode->write_gen++;
 
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
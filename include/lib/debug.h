@@ -24,8 +24,24 @@ void debug_backtrace (void);
 /* This is outside the header guard so that debug.h may be
  * included multiple times with different settings of NDEBUG. */
 #undef ASSERT
+#undef DEBUG_ASSERT
+#undef PARANOID_ASSERT
 #undef NOT_REACHED
 
+/* Assertions come in three tiers, selected by ASSERT_LEVEL, which
+ * the build profile sets (see Make.config):
+ *
+ *    ASSERT           - always checked (unless NDEBUG).
+ *    DEBUG_ASSERT     - cheap checks in hot paths; ASSERT_LEVEL >= 1.
+ *    PARANOID_ASSERT  - expensive consistency checks, e.g. walking a
+ *                       whole list; ASSERT_LEVEL >= 2.
+ *
+ * The debug profile uses level 1, release uses 0 and paranoid
+ * uses 2. */
+#ifndef ASSERT_LEVEL
+#define ASSERT_LEVEL 1
+#endif
+
 #ifndef NDEBUG
 #define ASSERT(CONDITION)                                       \
 	if ((CONDITION)) { } else {                             \
@@ -35,4 +51,16 @@ void debug_backtrace (void);
 #else
 #define ASSERT(CONDITION) ((void) 0)
 #define NOT_REACHED() for (;;)
+#endif
+
+#if ASSERT_LEVEL >= 1
+#define DEBUG_ASSERT(CONDITION) ASSERT (CONDITION)
+#else
+#define DEBUG_ASSERT(CONDITION) ((void) 0)
+#endif
+
+#if ASSERT_LEVEL >= 2
+#define PARANOID_ASSERT(CONDITION) ASSERT (CONDITION)
+#else
+#define PARANOID_ASSERT(CONDITION) ((void) 0)
 #endif /* lib/debug.h */
@@ -0,0 +1,33 @@
+#ifndef __LIB_KERNEL_LZ_H
+#define __LIB_KERNEL_LZ_H
+
+/* LZ77 compression.
+ *
+ * A small byte-oriented compressor in the LZ4 mould: input is
+ * coded as a sequence of literal runs, each followed by a copy
+ * of earlier output given as a distance and a length.  Matches
+ * are found through a single-probe hash table, so compression
+ * is fast and greedy rather than thorough, and decompression is
+ * little more than memcpy().
+ *
+ * Neither function allocates memory.  The compressor's hash
+ * table lives in a caller-supplied buffer of LZ_WORK_SIZE bytes,
+ * which keeps it off the kernel stack. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Bytes of scratch space lz_compress() needs. */
+#define LZ_HASH_BITS 10
+#define LZ_WORK_SIZE ((1 << LZ_HASH_BITS) * sizeof (uint16_t))
+
+/* Largest input either function accepts. */
+#define LZ_MAX_INPUT 65535
+
+size_t lz_compress (const void *src, size_t src_len,
+		void *dst, size_t dst_cap, void *work);
+bool lz_decompress (const void *src, size_t src_len,
+		void *dst, size_t dst_len);
+
+#endif /* lib/kernel/lz.h */
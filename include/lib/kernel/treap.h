@@ -0,0 +1,80 @@
+#ifndef __LIB_KERNEL_TREAP_H
+#define __LIB_KERNEL_TREAP_H
+
+/* Ordered search tree.
+ *
+ * A treap is a binary search tree in which every node also
+ * carries a pseudo-random priority, and the tree is kept in heap
+ * order by priority.  This keeps the expected depth logarithmic
+ * without any rebalancing bookkeeping.  Lookup, insertion and
+ * deletion take expected O(log n) time.
+ *
+ * Like lists and hash tables, treaps do not allocate memory.
+ * Each structure that can be in a treap embeds a struct
+ * treap_elem member, and treap_entry() converts a struct
+ * treap_elem back to the structure that contains it.  See
+ * lib/kernel/list.h for a detailed explanation of the technique.
+ *
+ * Besides exact lookup, a treap answers "greatest element not
+ * greater than X" (treap_floor()) and "least element not less
+ * than X" (treap_ceil()).  This makes it a good fit for sets of
+ * disjoint ranges keyed by their start. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Treap element. */
+struct treap_elem {
+	struct treap_elem *left;    /* Elements less than this one. */
+	struct treap_elem *right;   /* Elements greater than this one. */
+	uint32_t priority;          /* Heap order key. */
+};
+
+/* Converts pointer to treap element TREAP_ELEM into a pointer to
+ * the structure that TREAP_ELEM is embedded inside.  Supply the
+ * name of the outer structure STRUCT and the member name MEMBER
+ * of the treap element. */
+#define treap_entry(TREAP_ELEM, STRUCT, MEMBER)                 \
+	((STRUCT *) ((uint8_t *) &(TREAP_ELEM)->left            \
+		- offsetof (STRUCT, MEMBER.left)))
+
+/* Compares the value of two treap elements A and B, given
+ * auxiliary data AUX.  Returns true if A is less than B, or
+ * false if A is greater than or equal to B. */
+typedef bool treap_less_func (const struct treap_elem *a,
+		const struct treap_elem *b,
+		void *aux);
+
+/* Performs some operation on treap element E, given auxiliary
+ * data AUX. */
+typedef void treap_action_func (struct treap_elem *e, void *aux);
+
+/* Treap. */
+struct treap {
+	size_t elem_cnt;            /* Number of elements in treap. */
+	struct treap_elem *root;    /* Root element, or NULL. */
+	treap_less_func *less;      /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `less'. */
+};
+
+/* Basic life cycle. */
+void treap_init (struct treap *, treap_less_func *, void *aux);
+void treap_clear (struct treap *, treap_action_func *);
+
+/* Search, insertion, deletion. */
+struct treap_elem *treap_insert (struct treap *, struct treap_elem *);
+struct treap_elem *treap_find (const struct treap *, const struct treap_elem *);
+struct treap_elem *treap_floor (const struct treap *, const struct treap_elem *);
+struct treap_elem *treap_ceil (const struct treap *, const struct treap_elem *);
+struct treap_elem *treap_delete (struct treap *, struct treap_elem *);
+
+/* Iteration, in ascending order. */
+struct treap_elem *treap_first (const struct treap *);
+struct treap_elem *treap_next (const struct treap *, const struct treap_elem *);
+
+/* Information. */
+size_t treap_size (const struct treap *);
+bool treap_empty (const struct treap *);
+
+#endif /* lib/kernel/treap.h */
@@ -36,6 +36,21 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extras for Project 3. */
+	SYS_SHMAP,                  /* Map anonymous shared memory. */
+	SYS_MADVISE,                /* Advise on the use of memory. */
+	SYS_MSYNC,                  /* Write back a file mapping. */
+	SYS_RSSLIMIT,               /* Limit resident memory. */
+
+	/* Extras for Project 2. */
+	SYS_SPAWN,                  /* Start a process from a program. */
+	SYS_PREAD,                  /* Read from a file at an offset. */
+	SYS_PWRITE,                 /* Write to a file at an offset. */
+	SYS_READV,                  /* Read a file into several buffers. */
+	SYS_WRITEV,                 /* Write several buffers to a file. */
+	SYS_RING_SETUP,             /* Register a syscall ring. */
+	SYS_RING_ENTER,             /* Submit and complete ring requests. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -13,6 +13,82 @@ typedef int pid_t;
 typedef int off_t;
 #define MAP_FAILED ((void *) NULL)
 
+/* Or'd into mmap()'s WRITABLE for a mapping shared with every other
+ * process mapping the file shared, instead of a private one. */
+#define MAP_SHARED 2
+
+/* An action spawn() applies to the new process's file descriptors,
+ * which start out as copies of the caller's. */
+struct spawn_action {
+	int op;                 /* SPAWN_END, SPAWN_CLOSE or SPAWN_DUP2. */
+	int fd;                 /* Descriptor to close, or to duplicate. */
+	int newfd;              /* SPAWN_DUP2: descriptor to duplicate to. */
+};
+
+#define SPAWN_END 0             /* Ends the list of actions. */
+#define SPAWN_CLOSE 1           /* close (fd). */
+#define SPAWN_DUP2 2            /* dup2 (fd, newfd). */
+
+/* One of the buffers readv() fills or writev() drains, in order. */
+struct iovec {
+	void *iov_base;         /* Start of the buffer. */
+	size_t iov_len;         /* Its size in bytes. */
+};
+
+/* Most buffers one readv() or writev() takes. */
+#define IOV_MAX 16
+
+/* A syscall ring, shared with the kernel after ring_setup().  Queue
+ * requests at SQ[SQ_TAIL % RING_ENTRIES], advancing SQ_TAIL, and hand
+ * them over with ring_enter(); the kernel advances SQ_HEAD as it takes
+ * them.  Their results appear at CQ[CQ_HEAD % RING_ENTRIES] up to
+ * CQ_TAIL; advance CQ_HEAD past those consumed.  The kernel takes no
+ * more requests than the completion queue has room for, counting
+ * results not yet consumed and those still to come, so requests past
+ * that wait in the submission queue.  The indexes run freely and
+ * wrap. */
+#define RING_ENTRIES 64
+
+#define RING_READ 1             /* read (fd, buf, len). */
+#define RING_WRITE 2            /* write (fd, buf, len). */
+#define RING_PREAD 3            /* pread (fd, buf, len, offset). */
+#define RING_PWRITE 4           /* pwrite (fd, buf, len, offset). */
+#define RING_OPEN 5             /* open (buf); the result is the fd. */
+#define RING_CLOSE 6            /* close (fd). */
+
+struct ring_sqe {
+	int opcode;             /* RING_*. */
+	int fd;
+	void *buf;              /* Data, or for RING_OPEN the file name. */
+	unsigned len;           /* Bytes; at most 4096 are transferred. */
+	off_t offset;           /* For RING_PREAD and RING_PWRITE. */
+	unsigned long long user_data; /* Passed back in the completion. */
+};
+
+struct ring_cqe {
+	unsigned long long user_data;
+	int res;                /* What the plain system call returns. */
+};
+
+struct io_ring {
+	unsigned sq_head;
+	unsigned sq_tail;
+	unsigned cq_head;
+	unsigned cq_tail;
+	struct ring_sqe sq[RING_ENTRIES];
+	struct ring_cqe cq[RING_ENTRIES];
+};
+
+/* Advice for madvise(). */
+#define MADV_NORMAL 0           /* No particular access pattern. */
+#define MADV_RANDOM 1           /* Random access: don't read ahead. */
+#define MADV_SEQUENTIAL 2       /* One pass: read ahead, drop behind. */
+#define MADV_WILLNEED 3         /* Bring the range into memory now. */
+#define MADV_DONTNEED 4         /* Drop the range now; it reads back
+                                   from its file, or as zeros. */
+#define MADV_FREE 8             /* Contents may be dropped, reading back
+                                   as zeros, until next written. */
+
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
@@ -37,10 +113,21 @@ unsigned tell (int fd);
 void close (int fd);
 
 int dup2(int oldfd, int newfd);
+pid_t spawn (const char *file, const struct spawn_action *actions);
+int pread (int fd, void *buffer, unsigned length, off_t offset);
+int pwrite (int fd, const void *buffer, unsigned length, off_t offset);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int ring_setup (struct io_ring *ring);
+int ring_enter (unsigned to_submit, unsigned min_complete);
 
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
+void *shmap (void *addr, size_t length);
+int madvise (void *addr, size_t length, int advice);
+int msync (void *addr, size_t length);
+size_t rsslimit (size_t pages);
 
 /* Project 4 only. */
 bool chdir (const char *dir);
@@ -19,5 +19,12 @@ void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+void *palloc_get_large_page (enum palloc_flags);
+void palloc_free_large_page (void *);
+size_t palloc_user_page_cnt (void);
+size_t palloc_user_free_cnt (void);
+size_t palloc_user_page_no (const void *kpage);
+void clear_page (void *kpage);
+void copy_page (void *dst, const void *src);
 
 #endif /* threads/palloc.h */
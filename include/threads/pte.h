@@ -41,5 +41,15 @@
 #define PTE_U 0x4                        /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20                       /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40                       /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80                      /* 1=2 MB page (PDEs only). */
+
+/* A page directory entry with PTE_PS set maps a whole 2 MB "large
+   page" directly, without a page table below it.  Within 4 kB
+   PTEs the same bit is PAT, which Pintos never sets, so any entry
+   with PTE_PS set can be taken for a large-page PDE. */
+#define LPGSHIFT PDXSHIFT                /* Index of first large-page offset bit. */
+#define LPGSIZE  (1UL << LPGSHIFT)       /* Bytes in a large page (2 MB). */
+#define LPGMASK  (LPGSIZE - 1)           /* Large-page offset bits. */
+#define LPG_PAGES (LPGSIZE / PGSIZE)     /* 4 kB pages per large page. */
 
 #endif /* threads/pte.h */
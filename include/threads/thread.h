@@ -138,10 +138,16 @@ struct thread
 #ifdef USERPROG
 	/* Owned by userprog/process.c. */
 	uint64_t *pml4; /* Page map level 4 */
+	struct ring_ctx *ring; /* Syscall ring, if any (userprog/ring.c). */
 #endif
 #ifdef VM
 	/* Table for whole virtual memory owned by thread. */
 	struct supplemental_page_table spt;
+	void *user_rsp; /* User rsp saved on syscall entry, for stack growth. */
+	struct fault_totals faults; /* Page faults taken, by class. */
+	size_t rss; /* Pages resident, shared ones included. */
+	size_t rss_limit; /* Most pages resident, or 0 if no limit. */
+	size_t rss_hand; /* Frame table index of rss_victim(). */
 #endif
 
 	/* Owned by thread.c. */
@@ -3,15 +3,38 @@
 
 #include "threads/thread.h"
 
+/* An action spawn() applies to the new process's file descriptors.
+   Must match lib/user/syscall.h. */
+struct spawn_action {
+	int op;                 /* SPAWN_END, SPAWN_CLOSE or SPAWN_DUP2. */
+	int fd;                 /* Descriptor to close, or to duplicate. */
+	int newfd;              /* SPAWN_DUP2: descriptor to duplicate to. */
+};
+
+#define SPAWN_END 0             /* Ends the list of actions. */
+#define SPAWN_CLOSE 1           /* close (fd). */
+#define SPAWN_DUP2 2            /* dup2 (fd, newfd). */
+
+/* Most actions one spawn() takes. */
+#define SPAWN_ACTIONS_MAX 16
+
 tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
+tid_t process_spawn (char *cmd_line, const struct spawn_action *actions,
+		size_t action_cnt);
 int process_exec (void *f_name);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (struct thread *next);
+void elf_cache_init (void);
+void elf_cache_drop_removed (void);
 void argument_stack(char **argv, int argc, struct intr_frame *if_);
 
 struct thread *get_child_with_pid(int pid);
 
+/* Map large, 2 MB aligned runs of user segments with 2 MB pages.
+   Set by the "-lp" kernel command-line option. */
+extern bool user_large_pages;
+
 
 #endif /* userprog/process.h */
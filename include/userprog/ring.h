@@ -0,0 +1,55 @@
+#ifndef USERPROG_RING_H
+#define USERPROG_RING_H
+#include <stdint.h>
+#include "filesys/off_t.h"
+
+/* A syscall ring: a submission queue and a completion queue in user
+ * memory, shared with the kernel.  Must match lib/user/syscall.h. */
+
+/* Entries in each queue.  A power of two. */
+#define RING_ENTRIES 64
+
+/* Operations. */
+#define RING_READ 1             /* read (fd, buf, len). */
+#define RING_WRITE 2            /* write (fd, buf, len). */
+#define RING_PREAD 3            /* pread (fd, buf, len, offset). */
+#define RING_PWRITE 4           /* pwrite (fd, buf, len, offset). */
+#define RING_OPEN 5             /* open (buf); the result is the fd. */
+#define RING_CLOSE 6            /* close (fd). */
+
+/* A request. */
+struct ring_sqe {
+	int opcode;
+	int fd;
+	void *buf;
+	unsigned len;
+	off_t offset;
+	uint64_t user_data;          /* Passed back in the completion. */
+};
+
+/* A request's result. */
+struct ring_cqe {
+	uint64_t user_data;
+	int res;                     /* What the plain system call returns. */
+};
+
+/* The user fills SQ[SQ_TAIL % RING_ENTRIES] and advances SQ_TAIL; the
+ * kernel consumes up to it, advancing SQ_HEAD.  The kernel fills
+ * CQ[CQ_TAIL % RING_ENTRIES] and advances CQ_TAIL; the user consumes up
+ * to it, advancing CQ_HEAD.  The indexes run freely and wrap. */
+struct io_ring {
+	unsigned sq_head;
+	unsigned sq_tail;
+	unsigned cq_head;
+	unsigned cq_tail;
+	struct ring_sqe sq[RING_ENTRIES];
+	struct ring_cqe cq[RING_ENTRIES];
+};
+
+void ring_init (void);
+int do_ring_setup (struct io_ring *ring);
+int do_ring_enter (unsigned to_submit, unsigned min_complete);
+void ring_quiesce (void);
+void ring_exit (void);
+
+#endif /* userprog/ring.h */
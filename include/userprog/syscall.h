@@ -4,7 +4,24 @@
 #include <debug.h>
 #include <stddef.h>
 
+/* A user buffer for readv() and writev().  Must match
+ * lib/user/syscall.h. */
+struct iovec {
+	void *iov_base;
+	size_t iov_len;
+};
+
+/* Most buffers one readv() or writev() takes. */
+#define IOV_MAX 16
+
+struct file;
+
 void syscall_init (void);
+void exit (int status) NO_RETURN;
+void close (int fd);
+int dup2 (int oldfd, int newfd);
+int process_add_file (struct file *f);
+struct file *process_get_file (int fd);
 
 struct lock filesys_lock;
 
@@ -0,0 +1,34 @@
+#ifndef USERPROG_UACCESS_H
+#define USERPROG_UACCESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct intr_frame;
+
+/* Accessors for user memory.
+
+   These touch user memory directly instead of walking the page
+   table first.  Each instruction that may fault on a user address
+   is listed in the kernel's exception table together with a fixup
+   address; page_fault() resumes a faulting access at its fixup, so
+   a bad user pointer turns into an error return instead of a
+   kernel panic.  Addresses at or above KERN_BASE are rejected up
+   front, since accessing them would not fault. */
+
+/* An exception table entry: a faulting instruction in the kernel
+   at INSN resumes at FIXUP. */
+struct exception_table_entry {
+	uintptr_t insn;
+	uintptr_t fixup;
+};
+
+bool copy_from_user (void *dst, const void *usrc, size_t size);
+bool copy_to_user (void *udst, const void *src, size_t size);
+int strncpy_from_user (char *dst, const char *usrc, size_t size);
+bool user_range_writable (void *uaddr, size_t size);
+
+bool uaccess_fixup (struct intr_frame *);
+
+#endif /* userprog/uaccess.h */
@@ -2,12 +2,33 @@
 #define VM_ANON_H
 #include "vm/vm.h"
 struct page;
+struct frame;
 enum vm_type;
 
+/* Most pages written to or read ahead from swap in one transfer. */
+#define SWAP_CLUSTER 8
+
 struct anon_page {
+	size_t swap_slot;            /* Slot holding the page, or SWAP_SLOT_NONE. */
+	bool lazy_free;              /* Given MADV_FREE and not written since,
+	                                as far as its dirty bit shows. */
 };
 
+/* anon_page's swap_slot while the page is in memory. */
+#define SWAP_SLOT_NONE ((size_t) -1)
+
+/* anon_page's swap_slot while the page has never been written, and so
+ * reads as zeros.  Such a page has no frame of its own; it is mapped
+ * read-only to the shared zero page, or not at all. */
+#define SWAP_SLOT_ZERO ((size_t) -2)
+
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+void anon_swap_share (struct page *page, struct page *src);
+size_t anon_swap_out_cluster (struct frame *frames[], size_t cnt);
+void swap_write (size_t slot, const void *const kvas[], size_t page_cnt);
+size_t anon_swap_save (const void *kva);
+void anon_swap_restore (size_t slot, void *kva);
+void anon_swap_discard (size_t slot);
 
 #endif
@@ -0,0 +1,30 @@
+#ifndef VM_EVICT_H
+#define VM_EVICT_H
+#include <stdbool.h>
+#include <stddef.h>
+#include "threads/thread.h"
+
+struct frame;
+
+/* A page replacement policy.  The frame table tells the policy about
+ * every frame that comes to hold a mapped page and every frame that is
+ * released, and asks it for a victim when the user pool runs dry.  All
+ * but init are called with the frame table lock held. */
+struct evict_policy {
+	const char *name;                    /* Name on the kernel command line. */
+	void (*init) (size_t frame_cnt);     /* FRAME_CNT is the user pool size. */
+	void (*add) (struct frame *);        /* FRAME now holds a mapped page. */
+	void (*remove) (struct frame *);     /* FRAME is being released. */
+	struct frame *(*victim) (void);      /* Chooses a frame and removes it,
+	                                        or returns NULL if none is held. */
+	void (*cold) (struct frame *);       /* FRAME, which the policy holds,
+	                                        will not be needed soon. */
+	void (*forget) (tid_t);              /* The pages of process TID are
+	                                        gone.  Optional. */
+};
+
+extern const struct evict_policy clock_policy;
+extern const struct evict_policy wsclock_policy;
+extern const struct evict_policy twoq_policy;
+
+#endif /* vm/evict.h */
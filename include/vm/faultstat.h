@@ -0,0 +1,35 @@
+#ifndef VM_FAULTSTAT_H
+#define VM_FAULTSTAT_H
+#include <stdbool.h>
+#include <stdint.h>
+
+/* What handling a page fault came down to. */
+enum fault_class {
+	FAULT_ANON,                  /* First touch of an anonymous page. */
+	FAULT_FILE,                  /* Page filled from a mapped file. */
+	FAULT_ELF,                   /* Page filled from an executable. */
+	FAULT_SWAP,                  /* Page read back from swap. */
+	FAULT_COW,                   /* Copy-on-write sharing broken. */
+	FAULT_MINOR,                 /* Page in memory, only not mapped yet. */
+	FAULT_STACK,                 /* Stack grown. */
+	FAULT_SPURIOUS,              /* Page already mapped; nothing to do. */
+	FAULT_BAD,                   /* Not handled: the access was invalid. */
+	FAULT_CLASS_CNT
+};
+
+/* Latency histogram buckets.  Bucket N counts faults that took from
+ * 2**N up to 2**(N+1) cycles; the last also counts anything longer. */
+#define FAULT_BUCKETS 40
+
+/* One process's faults, kept in its struct thread. */
+struct fault_totals {
+	long long cnt[FAULT_CLASS_CNT];
+	uint64_t cycles;             /* Spent handling all of them. */
+};
+
+void faultstat_enable (void);
+void faultstat_record (enum fault_class class, uint64_t cycles);
+void faultstat_print_process (void);
+void faultstat_print_stats (void);
+
+#endif
@@ -4,14 +4,40 @@
 #include "vm/vm.h"
 
 struct page;
+struct vm_area;
 enum vm_type;
 
 struct file_page {
 };
 
+/* A modified page of a file mapping, to be written back. */
+struct wb_page {
+	struct file *file;
+	off_t ofs;                   /* Where in FILE. */
+	size_t bytes;                /* Bytes of the page in FILE. */
+	const void *kva;             /* The page's frame. */
+};
+
+/* Most pages written back in one write. */
+#define WB_CLUSTER 8
+
+/* Most pages gathered for write-back at a time. */
+#define WB_BATCH 32
+
+/* Or'd into do_mmap()'s WRITABLE for a shared mapping.  Must match
+ * MAP_SHARED in lib/user/syscall.h. */
+#define MAP_SHARED 2
+
 void vm_file_init (void);
 bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
 void do_munmap (void *va);
+bool do_msync (void *addr, size_t length);
+bool page_take_dirty (struct page *page, struct wb_page *wb);
+void write_back_pages (const struct wb_page wbs[], size_t cnt);
+size_t vma_page_read_bytes (struct vm_area *vma, void *va);
+bool vma_read_page (struct vm_area *vma, void *va, void *kva);
+bool filesys_lock_acquire (void);
+void filesys_lock_release (bool acquired);
 #endif
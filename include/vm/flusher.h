@@ -0,0 +1,12 @@
+#ifndef VM_FLUSHER_H
+#define VM_FLUSHER_H
+#include <stddef.h>
+
+/* Interval in milliseconds, used by -flusher without a value. */
+#define FLUSHER_DEFAULT_MS 1000
+
+void flusher_enable (size_t ms);
+void flusher_init (void);
+void flusher_print_stats (void);
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef VM_KSM_H
+#define VM_KSM_H
+#include <stddef.h>
+
+/* Frames scanned per round, used by -ksm without a value. */
+#define KSM_DEFAULT_PAGES 64
+
+void ksm_enable (size_t pages_per_round);
+void ksm_init (void);
+void ksm_print_stats (void);
+
+#endif
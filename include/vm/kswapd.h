@@ -0,0 +1,13 @@
+#ifndef VM_KSWAPD_H
+#define VM_KSWAPD_H
+#include <stddef.h>
+
+/* Low watermark, in frames, used by -kswapd without a value. */
+#define KSWAPD_DEFAULT_LOW 32
+
+void kswapd_enable (size_t low);
+void kswapd_init (void);
+void kswapd_poke (void);
+void kswapd_print_stats (void);
+
+#endif
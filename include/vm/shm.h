@@ -0,0 +1,57 @@
+#ifndef VM_SHM_H
+#define VM_SHM_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <hash.h>
+#include "threads/synch.h"
+#include "vm/vm.h"
+
+struct page;
+struct frame;
+struct file;
+struct wb_page;
+enum vm_type;
+
+/* A shared memory object: the pages behind every MAP_SHARED mapping of
+ * one file, or behind one anonymous shared region and its copies in the
+ * children forked since.  Mappings see each other's writes because their
+ * pages all map the one frame the object holds for each page. */
+struct shm {
+	struct inode *inode;         /* Backing file's inode, or NULL. */
+	struct file *file;           /* Handle for I/O on it, or NULL. */
+	int ref_cnt;                 /* Regions mapping the object. */
+	struct lock lock;            /* Serializes bringing pages in. */
+	struct hash slots;           /* struct shm_slot, by index. */
+	struct hash_elem elem;       /* Element in shm_files. */
+};
+
+/* Page IDX of a shared memory object, and where its contents are.
+ * Guarded by the frame table lock. */
+struct shm_slot {
+	struct shm *shm;             /* Object the page belongs to. */
+	size_t idx;
+	struct frame *frame;         /* Frame holding the page, or NULL. */
+	size_t swap_slot;            /* Anonymous: where it was swapped out,
+	                                or SWAP_SLOT_NONE if it reads as
+	                                zeros. */
+	bool dirty;                  /* File: written since last written
+	                                back, by a mapping now gone. */
+	struct hash_elem elem;       /* Element in shm's slots. */
+};
+
+struct shm_page {
+	struct shm_slot *slot;       /* Set when the page is first claimed. */
+};
+
+void vm_shm_init (void);
+struct shm *shm_create (void);
+struct shm *shm_open (struct file *file);
+void shm_ref (struct shm *shm);
+void shm_unref (struct shm *shm);
+struct shm_slot *shm_get_slot (struct page *page);
+bool shm_take_dirty (struct page *page, struct wb_page *wb);
+bool shm_evict (struct frame *frame);
+bool shm_initializer (struct page *page, enum vm_type type, void *kva);
+void *do_shmap (void *addr, size_t length);
+
+#endif /* vm/shm.h */
@@ -1,7 +1,11 @@
 #ifndef VM_VM_H
 #define VM_VM_H
 #include <stdbool.h>
+#include <hash.h>
+#include <list.h>
+#include <treap.h>
 #include "threads/palloc.h"
+#include "filesys/off_t.h"
 
 enum vm_type {
 	/* page not initialized */
@@ -12,6 +16,8 @@ enum vm_type {
 	VM_FILE = 2,
 	/* page that hold the page cache, for project 4 */
 	VM_PAGE_CACHE = 3,
+	/* page of a shared mapping, whose contents belong to a struct shm */
+	VM_SHM = 4,
 
 	/* Bit flags to store state */
 
@@ -20,6 +26,13 @@ enum vm_type {
 	VM_MARKER_0 = (1 << 3),
 	VM_MARKER_1 = (1 << 4),
 
+	/* Marks the stack region, which grows down on demand. */
+	VM_STACK = VM_MARKER_0,
+
+	/* Marks a read-only segment of an executable.  Its frames are
+	 * shared by every process mapping the same part of the same file. */
+	VM_TEXT = VM_MARKER_1,
+
 	/* DO NOT EXCEED THIS VALUE. */
 	VM_MARKER_END = (1 << 31),
 };
@@ -27,15 +40,27 @@ enum vm_type {
 #include "vm/uninit.h"
 #include "vm/anon.h"
 #include "vm/file.h"
+#include "vm/shm.h"
+#include "vm/faultstat.h"
 #ifdef EFILESYS
 #include "filesys/page_cache.h"
 #endif
 
 struct page_operations;
 struct thread;
+struct file;
 
 #define VM_TYPE(type) ((type) & 7)
 
+/* Advice for madvise().  Must match lib/user/syscall.h. */
+#define MADV_NORMAL 0                /* No particular pattern. */
+#define MADV_RANDOM 1                /* Random access: no fault-around. */
+#define MADV_SEQUENTIAL 2            /* One pass: read ahead, drop behind. */
+#define MADV_WILLNEED 3              /* Bring the range in now. */
+#define MADV_DONTNEED 4              /* Drop the range now. */
+#define MADV_FREE 8                  /* Contents may be dropped until
+                                        next written. */
+
 /* The representation of "page".
  * This is kind of "parent class", which has four "child class"es, which are
  * uninit_page, file_page, anon_page, and page cache (project4).
@@ -46,6 +71,11 @@ struct page {
 	struct frame *frame;   /* Back reference for frame */
 
 	/* Your implementation */
+	struct vm_area *vma;         /* Region this page belongs to. */
+	struct thread *owner;        /* Process whose page table maps it. */
+	struct list_elem frame_elem; /* Element in frame's pages. */
+	struct hash_elem spt_elem;   /* Element in supplemental_page_table's pages. */
+	struct list_elem vma_elem;   /* Element in vm_area's pages. */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -53,6 +83,7 @@ struct page {
 		struct uninit_page uninit;
 		struct anon_page anon;
 		struct file_page file;
+		struct shm_page shm;
 #ifdef EFILESYS
 		struct page_cache page_cache;
 #endif
@@ -62,8 +93,71 @@ struct page {
 /* The representation of "frame" */
 struct frame {
 	void *kva;
-	struct page *page;
+	struct page *page;           /* First of PAGES, or NULL if none. */
+
+	/* Pages mapping the frame.  After fork a frame can be shared
+	 * copy-on-write by several processes, each mapping it read-only
+	 * until it writes.  PAGE_CNT is the reference count. */
+	struct list pages;
+	size_t page_cnt;
+
+	/* Owned by the eviction policy while the frame holds a mapped page,
+	 * or a page of a shared object that no page maps any more, which is
+	 * while ACTIVE is true. */
+	struct list_elem elem;       /* Element in one of the policy's lists. */
+	int queue;                   /* Which list, for policies with several. */
+	bool active;
+
+	/* The part of an executable the frame holds, if it is in the text
+	 * cache; INODE is null otherwise. */
+	struct inode *inode;
+	off_t offset;
+	size_t read_bytes;
+	struct hash_elem text_elem;  /* Element in text_cache. */
+
+	/* If no page maps the frame, the slot of the shared object whose
+	 * page it holds; null otherwise. */
+	struct shm_slot *slot;
+};
+
+/* Paging statistics, reported by vm_print_stats(). */
+struct vm_stats {
+	long long faults;            /* Faults that brought a page in. */
+	long long evictions;         /* Frames taken from another page. */
+	long long swap_outs;         /* Anonymous pages written to swap. */
+	long long swap_ins;          /* Anonymous pages read from swap. */
+	long long swap_writes;       /* Transfers that wrote SWAP_OUTS. */
+	long long swap_reads;        /* Transfers that read SWAP_INS. */
+	long long swap_ticks;        /* Timer ticks spent on swap I/O. */
+	long long write_backs;       /* Dirty file pages written back. */
+	long long write_back_runs;   /* Writes that wrote WRITE_BACKS. */
+	long long msync_pages;       /* WRITE_BACKS asked for by msync(). */
+	long long flusher_passes;    /* Sweeps by the write-back daemon. */
+	long long flusher_pages;     /* WRITE_BACKS by the write-back daemon. */
+	long long cow_copies;        /* Copy-on-write pages copied on a write. */
+	long long fault_arounds;     /* Pages mapped ahead of a fault. */
+	long long text_shares;       /* Text pages mapped to a cached frame. */
+	long long zero_maps;         /* Pages mapped to the zero page on a read. */
+	long long zero_writes;       /* ZERO_MAPS that got a frame on a write. */
+	long long merge_scans;       /* Frames examined by the merging daemon. */
+	long long merges;            /* Frames freed by merging identical ones. */
+	long long kswapd_wakeups;    /* Times the page-out daemon woke up. */
+	long long kswapd_frames;     /* Frames the page-out daemon freed. */
+	long long direct_reclaims;   /* Faults that had to evict for themselves. */
+	long long rss_reclaims;      /* Frames a process at its resident limit
+	                                took back from itself. */
+	long long prefetches;        /* Pages brought in by MADV_WILLNEED. */
+	long long drops;             /* Pages dropped by MADV_DONTNEED. */
+	long long cold_marks;        /* Frames sent to the front of eviction. */
+	long long lazy_frees;        /* MADV_FREE frames evicted unwritten. */
+	long long zswap_stores;      /* Pages kept compressed instead of swapped. */
+	long long zswap_rejects;     /* Pages zswap passed on to the swap disk. */
+	long long zswap_hits;        /* Swap-ins served from zswap. */
+	long long zswap_misses;      /* Swap-ins that went to the swap disk. */
+	long long zswap_write_backs; /* Compressed pages spilled to the swap disk. */
+	long long zswap_bytes;       /* Compressed size of ZSWAP_STORES. */
 };
+extern struct vm_stats vm_stats;
 
 /* The function table for page operations.
  * This is one way of implementing "interface" in C.
@@ -81,10 +175,49 @@ struct page_operations {
 #define destroy(page) \
 	if ((page)->operations->destroy) (page)->operations->destroy (page)
 
-/* Representation of current process's memory space.
- * We don't want to force you to obey any specific design for this struct.
- * All designs up to you for this. */
+/* A virtual memory area: a run of pages with the same type, permissions
+ * and backing, such as an ELF segment, an mmap or the stack.  A region is
+ * set up in O(1) no matter how large it is.  Its struct pages are only
+ * materialized when first looked up, normally by a fault, and kept on
+ * PAGES until the region goes away. */
+struct vm_area {
+	void *start;                 /* First page. */
+	void *end;                   /* One past the last page. */
+	enum vm_type type;           /* Type pages take on their first fault. */
+	bool writable;               /* May user code write these pages? */
+	vm_initializer *init;        /* Fills a page on its first fault. */
+	void *aux;                   /* Passed to INIT; shared by all pages. */
+
+	/* Backing file, if any.  Page START + N * PGSIZE holds the file's
+	 * bytes from OFFSET + N * PGSIZE, of which the first READ_BYTES of
+	 * the region exist in the file and the rest read as zeros.  The
+	 * region owns FILE and closes it when it goes away. */
+	struct file *file;
+	off_t offset;
+	size_t read_bytes;
+
+	/* Fault-around for regions with a backing file.  A fault at
+	 * FAULT_NEXT continues a sequential scan; see vm_fault_around(). */
+	void *fault_next;
+	size_t fault_window;         /* Pages to map after the next fault. */
+
+	/* For a VM_SHM region, the object its pages share.  Page START +
+	 * N * PGSIZE is page OFFSET / PGSIZE + N of it.  Forking shares
+	 * the object rather than copying it. */
+	struct shm *shm;
+
+	int advice;                  /* MADV_NORMAL, MADV_RANDOM or
+	                                MADV_SEQUENTIAL. */
+
+	struct list pages;           /* Materialized pages. */
+	struct treap_elem elem;      /* Element in supplemental_page_table's vmas. */
+};
+
+/* Representation of current process's memory space: its regions ordered
+ * by start address, plus an index of the pages materialized so far. */
 struct supplemental_page_table {
+	struct treap vmas;           /* struct vm_area, by start. */
+	struct hash pages;           /* struct page, by va. */
 };
 
 #include "threads/thread.h"
@@ -96,8 +229,17 @@ struct page *spt_find_page (struct supplemental_page_table *spt,
 		void *va);
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
+struct page *spt_lookup_page (struct supplemental_page_table *spt,
+		void *va);
+struct vm_area *spt_find_vma (struct supplemental_page_table *spt,
+		void *va);
+bool spt_range_mapped (struct supplemental_page_table *spt, void *start,
+		void *end);
 
 void vm_init (void);
+bool vm_select_policy (const char *name);
+void vm_set_fault_around (size_t max);
+void vm_print_stats (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 		bool write, bool not_present);
 
@@ -105,8 +247,24 @@ bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 	vm_alloc_page_with_initializer ((type), (upage), (writable), NULL, NULL)
 bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
+struct vm_area *vm_alloc_region (enum vm_type type, void *start,
+		size_t page_cnt, bool writable, vm_initializer *init, void *aux);
+void vm_free_region (struct vm_area *vma);
 void vm_dealloc_page (struct page *page);
 bool vm_claim_page (void *va);
+bool do_madvise (void *addr, size_t length, int advice);
+size_t vm_set_rss_limit (size_t pages);
+void vm_frame_lock (void);
+void vm_frame_unlock (void);
+void vm_release_frame (struct page *page);
+struct frame *vm_detach_frame (struct page *page);
+void vm_detach_shared (struct page *page);
+void vm_free_held_frame (struct frame *frame);
+struct frame *vm_get_frame_nowait (void);
+size_t vm_reclaim (void);
+bool vm_install_frame (struct page *page, struct frame *frame);
+struct frame *vm_frame_at (size_t idx);
+void vm_merge_frames (struct frame *dst, struct frame *src);
 enum vm_type page_get_type (struct page *page);
 
 #endif  /* VM_VM_H */
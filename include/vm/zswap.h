@@ -0,0 +1,16 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Pool size, in kernel pages, used by -zswap without a value. */
+#define ZSWAP_DEFAULT_PAGES 256
+
+void zswap_enable (size_t page_limit);
+void zswap_init (void);
+bool zswap_store (size_t slot, const void *kva);
+bool zswap_load (size_t slot, void *kva);
+void zswap_invalidate (size_t slot);
+void zswap_print_stats (void);
+
+#endif
@@ -130,8 +130,8 @@ bitmap_size (const struct bitmap *b) {
 /* Atomically sets the bit numbered IDX in B to VALUE. */
 void
 bitmap_set (struct bitmap *b, size_t idx, bool value) {
-	ASSERT (b != NULL);
-	ASSERT (idx < b->bit_cnt);
+	DEBUG_ASSERT (b != NULL);
+	DEBUG_ASSERT (idx < b->bit_cnt);
 	if (value)
 		bitmap_mark (b, idx);
 	else
@@ -179,8 +179,8 @@ bitmap_flip (struct bitmap *b, size_t bit_idx) {
 /* Returns the value of the bit numbered IDX in B. */
 bool
 bitmap_test (const struct bitmap *b, size_t idx) {
-	ASSERT (b != NULL);
-	ASSERT (idx < b->bit_cnt);
+	DEBUG_ASSERT (b != NULL);
+	DEBUG_ASSERT (idx < b->bit_cnt);
 	return (b->bits[elem_idx (idx)] & bit_mask (idx)) != 0;
 }
 
@@ -189,7 +189,7 @@ bitmap_test (const struct bitmap *b, size_t idx) {
 /* Sets all bits in B to VALUE. */
 void
 bitmap_set_all (struct bitmap *b, bool value) {
-	ASSERT (b != NULL);
+	DEBUG_ASSERT (b != NULL);
 
 	bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
@@ -199,9 +199,9 @@ void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) {
 	size_t i;
 
-	ASSERT (b != NULL);
-	ASSERT (start <= b->bit_cnt);
-	ASSERT (start + cnt <= b->bit_cnt);
+	DEBUG_ASSERT (b != NULL);
+	DEBUG_ASSERT (start <= b->bit_cnt);
+	DEBUG_ASSERT (start + cnt <= b->bit_cnt);
 
 	for (i = 0; i < cnt; i++)
 		bitmap_set (b, start + i, value);
@@ -213,9 +213,9 @@ size_t
 bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 	size_t i, value_cnt;
 
-	ASSERT (b != NULL);
-	ASSERT (start <= b->bit_cnt);
-	ASSERT (start + cnt <= b->bit_cnt);
+	DEBUG_ASSERT (b != NULL);
+	DEBUG_ASSERT (start <= b->bit_cnt);
+	DEBUG_ASSERT (start + cnt <= b->bit_cnt);
 
 	value_cnt = 0;
 	for (i = 0; i < cnt; i++)
@@ -230,9 +230,9 @@ bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 	size_t i;
 
-	ASSERT (b != NULL);
-	ASSERT (start <= b->bit_cnt);
-	ASSERT (start + cnt <= b->bit_cnt);
+	DEBUG_ASSERT (b != NULL);
+	DEBUG_ASSERT (start <= b->bit_cnt);
+	DEBUG_ASSERT (start + cnt <= b->bit_cnt);
 
 	for (i = 0; i < cnt; i++)
 		if (bitmap_test (b, start + i) == value)
@@ -269,8 +269,8 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt) {
    If there is no such group, returns BITMAP_ERROR. */
 size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	ASSERT (b != NULL);
-	ASSERT (start <= b->bit_cnt);
+	DEBUG_ASSERT (b != NULL);
+	DEBUG_ASSERT (start <= b->bit_cnt);
 
 	if (cnt <= b->bit_cnt) {
 		size_t last = b->bit_cnt - cnt;
@@ -56,7 +56,7 @@ is_tail (struct list_elem *elem) {
 /* Initializes LIST as an empty list. */
 void
 list_init (struct list *list) {
-	ASSERT (list != NULL);
+	DEBUG_ASSERT (list != NULL);
 	list->head.prev = NULL;
 	list->head.next = &list->tail;
 	list->tail.prev = &list->head;
@@ -66,7 +66,7 @@ list_init (struct list *list) {
 /* Returns the beginning of LIST.  */
 struct list_elem *
 list_begin (struct list *list) {
-	ASSERT (list != NULL);
+	DEBUG_ASSERT (list != NULL);
 	return list->head.next;
 }
 
@@ -75,7 +75,7 @@ list_begin (struct list *list) {
    undefined if ELEM is itself a list tail. */
 struct list_elem *
 list_next (struct list_elem *elem) {
-	ASSERT (is_head (elem) || is_interior (elem));
+	DEBUG_ASSERT (is_head (elem) || is_interior (elem));
 	return elem->next;
 }
 
@@ -86,7 +86,7 @@ list_next (struct list_elem *elem) {
    an example. */
 struct list_elem *
 list_end (struct list *list) {
-	ASSERT (list != NULL);
+	DEBUG_ASSERT (list != NULL);
 	return &list->tail;
 }
 
@@ -94,7 +94,7 @@ list_end (struct list *list) {
    LIST in reverse order, from back to front. */
 struct list_elem *
 list_rbegin (struct list *list) {
-	ASSERT (list != NULL);
+	DEBUG_ASSERT (list != NULL);
 	return list->tail.prev;
 }
 
@@ -103,7 +103,7 @@ list_rbegin (struct list *list) {
    undefined if ELEM is itself a list head. */
 struct list_elem *
 list_prev (struct list_elem *elem) {
-	ASSERT (is_interior (elem) || is_tail (elem));
+	DEBUG_ASSERT (is_interior (elem) || is_tail (elem));
 	return elem->prev;
 }
 
@@ -122,7 +122,7 @@ list_prev (struct list_elem *elem) {
    */
 struct list_elem *
 list_rend (struct list *list) {
-	ASSERT (list != NULL);
+	DEBUG_ASSERT (list != NULL);
 	return &list->head;
 }
 
@@ -139,14 +139,14 @@ list_rend (struct list *list) {
    */
 struct list_elem *
 list_head (struct list *list) {
-	ASSERT (list != NULL);
+	DEBUG_ASSERT (list != NULL);
 	return &list->head;
 }
 
 /* Return's LIST's tail. */
 struct list_elem *
 list_tail (struct list *list) {
-	ASSERT (list != NULL);
+	DEBUG_ASSERT (list != NULL);
 	return &list->tail;
 }
 
@@ -155,8 +155,8 @@ list_tail (struct list *list) {
    list_push_back(). */
 void
 list_insert (struct list_elem *before, struct list_elem *elem) {
-	ASSERT (is_interior (before) || is_tail (before));
-	ASSERT (elem != NULL);
+	DEBUG_ASSERT (is_interior (before) || is_tail (before));
+	DEBUG_ASSERT (elem != NULL);
 
 	elem->prev = before->prev;
 	elem->next = before;
@@ -170,13 +170,13 @@ list_insert (struct list_elem *before, struct list_elem *elem) {
 void
 list_splice (struct list_elem *before,
 		struct list_elem *first, struct list_elem *last) {
-	ASSERT (is_interior (before) || is_tail (before));
+	DEBUG_ASSERT (is_interior (before) || is_tail (before));
 	if (first == last)
 		return;
 	last = list_prev (last);
 
-	ASSERT (is_interior (first));
-	ASSERT (is_interior (last));
+	DEBUG_ASSERT (is_interior (first));
+	DEBUG_ASSERT (is_interior (last));
 
 	/* Cleanly remove FIRST...LAST from its current list. */
 	first->prev->next = last->next;
@@ -239,7 +239,7 @@ struct list_elem *e = list_pop_front (&list);
 */
 struct list_elem *
 list_remove (struct list_elem *elem) {
-	ASSERT (is_interior (elem));
+	DEBUG_ASSERT (is_interior (elem));
 	elem->prev->next = elem->next;
 	elem->next->prev = elem->prev;
 	return elem->next;
@@ -267,7 +267,7 @@ list_pop_back (struct list *list) {
    Undefined behavior if LIST is empty. */
 struct list_elem *
 list_front (struct list *list) {
-	ASSERT (!list_empty (list));
+	DEBUG_ASSERT (!list_empty (list));
 	return list->head.next;
 }
 
@@ -275,7 +275,7 @@ list_front (struct list *list) {
    Undefined behavior if LIST is empty. */
 struct list_elem *
 list_back (struct list *list) {
-	ASSERT (!list_empty (list));
+	DEBUG_ASSERT (!list_empty (list));
 	return list->tail.prev;
 }
 
@@ -338,10 +338,10 @@ is_sorted (struct list_elem *a, struct list_elem *b,
 static struct list_elem *
 find_end_of_run (struct list_elem *a, struct list_elem *b,
 		list_less_func *less, void *aux) {
-	ASSERT (a != NULL);
-	ASSERT (b != NULL);
-	ASSERT (less != NULL);
-	ASSERT (a != b);
+	DEBUG_ASSERT (a != NULL);
+	DEBUG_ASSERT (b != NULL);
+	DEBUG_ASSERT (less != NULL);
+	DEBUG_ASSERT (a != b);
 
 	do {
 		a = list_next (a);
@@ -358,12 +358,12 @@ static void
 inplace_merge (struct list_elem *a0, struct list_elem *a1b0,
 		struct list_elem *b1,
 		list_less_func *less, void *aux) {
-	ASSERT (a0 != NULL);
-	ASSERT (a1b0 != NULL);
-	ASSERT (b1 != NULL);
-	ASSERT (less != NULL);
-	ASSERT (is_sorted (a0, a1b0, less, aux));
-	ASSERT (is_sorted (a1b0, b1, less, aux));
+	DEBUG_ASSERT (a0 != NULL);
+	DEBUG_ASSERT (a1b0 != NULL);
+	DEBUG_ASSERT (b1 != NULL);
+	DEBUG_ASSERT (less != NULL);
+	PARANOID_ASSERT (is_sorted (a0, a1b0, less, aux));
+	PARANOID_ASSERT (is_sorted (a1b0, b1, less, aux));
 
 	while (a0 != a1b0 && a1b0 != b1)
 		if (!less (a1b0, a0, aux))
@@ -381,8 +381,8 @@ void
 list_sort (struct list *list, list_less_func *less, void *aux) {
 	size_t output_run_cnt;        /* Number of runs output in current pass. */
 
-	ASSERT (list != NULL);
-	ASSERT (less != NULL);
+	DEBUG_ASSERT (list != NULL);
+	DEBUG_ASSERT (less != NULL);
 
 	/* Pass over the list repeatedly, merging adjacent runs of
 	   nondecreasing elements, until only one run is left. */
@@ -409,7 +409,7 @@ list_sort (struct list *list, list_less_func *less, void *aux) {
 	}
 	while (output_run_cnt > 1);
 
-	ASSERT (is_sorted (list_begin (list), list_end (list), less, aux));
+	PARANOID_ASSERT (is_sorted (list_begin (list), list_end (list), less, aux));
 }
 
 /* Inserts ELEM in the proper position in LIST, which must be
@@ -420,9 +420,9 @@ list_insert_ordered (struct list *list, struct list_elem *elem,
 		list_less_func *less, void *aux) {
 	struct list_elem *e;
 
-	ASSERT (list != NULL);
-	ASSERT (elem != NULL);
-	ASSERT (less != NULL);
+	DEBUG_ASSERT (list != NULL);
+	DEBUG_ASSERT (elem != NULL);
+	DEBUG_ASSERT (less != NULL);
 
 	for (e = list_begin (list); e != list_end (list); e = list_next (e))
 		if (less (elem, e, aux))
@@ -439,8 +439,8 @@ list_unique (struct list *list, struct list *duplicates,
 		list_less_func *less, void *aux) {
 	struct list_elem *elem, *next;
 
-	ASSERT (list != NULL);
-	ASSERT (less != NULL);
+	DEBUG_ASSERT (list != NULL);
+	DEBUG_ASSERT (less != NULL);
 	if (list_empty (list))
 		return;
 
@@ -0,0 +1,168 @@
+/* LZ77 compression.
+
+   See lz.h for basic information.
+
+   A compressed block is a series of sequences.  Each starts with
+   a token byte whose high nibble is the number of literal bytes
+   that follow and whose low nibble is the match length less
+   LZ_MIN_MATCH.  A nibble of 15 means the count continues in the
+   following bytes, each added to it, until one is less than 255.
+   The literals come next, then the match distance as two bytes,
+   least significant first, then the rest of the match length if
+   any.  The last sequence ends after its literals. */
+
+#include "lz.h"
+#include <string.h>
+#include "../debug.h"
+
+/* Shortest match worth coding. */
+#define LZ_MIN_MATCH 4
+
+static inline uint32_t
+read32 (const uint8_t *p) {
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static inline size_t
+hash32 (uint32_t x) {
+	return (x * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Stores the part of LEN that does not fit in a token nibble at
+   OP and returns the byte after it. */
+static uint8_t *
+put_length (uint8_t *op, size_t len) {
+	for (; len >= 255; len -= 255)
+		*op++ = 255;
+	*op++ = len;
+	return op;
+}
+
+/* Appends a sequence of the LIT_LEN bytes at LIT, followed unless
+   FINAL by a match of MATCH_LEN bytes DIST back, at OP.  Returns
+   the byte after it, or a null pointer if it would run past
+   OEND. */
+static uint8_t *
+put_sequence (uint8_t *op, uint8_t *oend, const uint8_t *lit, size_t lit_len,
+		size_t dist, size_t match_len, bool final) {
+	size_t m = final ? 0 : match_len - LZ_MIN_MATCH;
+	size_t worst = 1 + lit_len / 255 + 1 + lit_len + 2 + m / 255 + 1;
+	uint8_t *token = op++;
+
+	if ((size_t) (oend - token) < worst)
+		return NULL;
+	*token = (lit_len < 15 ? lit_len : 15) << 4 | (m < 15 ? m : 15);
+	if (lit_len >= 15)
+		op = put_length (op, lit_len - 15);
+	memcpy (op, lit, lit_len);
+	op += lit_len;
+	if (!final) {
+		*op++ = dist;
+		*op++ = dist >> 8;
+		if (m >= 15)
+			op = put_length (op, m - 15);
+	}
+	return op;
+}
+
+/* Compresses the SRC_LEN bytes at SRC into the DST_CAP bytes at
+   DST, using the LZ_WORK_SIZE bytes at WORK as scratch space.
+   Returns the compressed length, or 0 if it would exceed
+   DST_CAP. */
+size_t
+lz_compress (const void *src_, size_t src_len, void *dst_, size_t dst_cap,
+		void *work) {
+	const uint8_t *src = src_;
+	const uint8_t *end = src + src_len;
+	const uint8_t *ip = src, *anchor = src;
+	uint8_t *dst = dst_, *op = dst, *oend = dst + dst_cap;
+	uint16_t *table = work;
+
+	ASSERT (src_len <= LZ_MAX_INPUT);
+
+	memset (table, 0, LZ_WORK_SIZE);
+	while (end - ip >= LZ_MIN_MATCH) {
+		uint32_t seq = read32 (ip);
+		size_t h = hash32 (seq);
+		const uint8_t *ref = src + table[h];
+		const uint8_t *mp, *rp;
+
+		table[h] = ip - src;
+		if (ref >= ip || read32 (ref) != seq) {
+			ip++;
+			continue;
+		}
+
+		mp = ip + LZ_MIN_MATCH;
+		rp = ref + LZ_MIN_MATCH;
+		while (mp < end && *mp == *rp)
+			mp++, rp++;
+		op = put_sequence (op, oend, anchor, ip - anchor, ip - ref, mp - ip,
+				false);
+		if (op == NULL)
+			return 0;
+		ip = anchor = mp;
+	}
+	op = put_sequence (op, oend, anchor, end - anchor, 0, 0, true);
+	return op != NULL ? (size_t) (op - dst) : 0;
+}
+
+/* Reads a length continued past its token nibble from *IP, not
+   reading at or past IEND, and adds it to *LEN.  Returns false if
+   the input ends first. */
+static bool
+get_length (const uint8_t **ip, const uint8_t *iend, size_t *len) {
+	uint8_t b;
+
+	do {
+		if (*ip >= iend)
+			return false;
+		b = *(*ip)++;
+		*len += b;
+	} while (b == 255);
+	return true;
+}
+
+/* Decompresses the SRC_LEN bytes at SRC, which must expand to
+   exactly DST_LEN bytes, into DST.  Returns false if SRC is not a
+   well-formed block of that length, in which case the contents
+   of DST are unspecified. */
+bool
+lz_decompress (const void *src_, size_t src_len, void *dst_, size_t dst_len) {
+	const uint8_t *ip = src_, *iend = ip + src_len;
+	uint8_t *dst = dst_, *op = dst, *oend = dst + dst_len;
+
+	while (ip < iend) {
+		uint8_t token = *ip++;
+		size_t lit_len = token >> 4;
+		size_t match_len = token & 15;
+		size_t dist;
+
+		if (lit_len == 15 && !get_length (&ip, iend, &lit_len))
+			return false;
+		if (lit_len > (size_t) (iend - ip) || lit_len > (size_t) (oend - op))
+			return false;
+		memcpy (op, ip, lit_len);
+		op += lit_len;
+		ip += lit_len;
+		if (ip == iend)
+			break;
+
+		if (iend - ip < 2)
+			return false;
+		dist = ip[0] | ip[1] << 8;
+		ip += 2;
+		if (match_len == 15 && !get_length (&ip, iend, &match_len))
+			return false;
+		match_len += LZ_MIN_MATCH;
+		if (dist == 0 || dist > (size_t) (op - dst)
+				|| match_len > (size_t) (oend - op))
+			return false;
+
+		/* The match may overlap the bytes it produces, so copy
+		   forward a byte at a time. */
+		for (; match_len > 0; match_len--, op++)
+			*op = op[-dist];
+	}
+	return op == oend;
+}
@@ -0,0 +1,244 @@
+/* Ordered search tree.
+
+   See treap.h for basic information. */
+
+#include "treap.h"
+#include "../debug.h"
+
+static struct treap_elem **find_link (const struct treap *,
+		const struct treap_elem *);
+static void split (const struct treap *, struct treap_elem *,
+		const struct treap_elem *,
+		struct treap_elem **, struct treap_elem **);
+static struct treap_elem *merge (struct treap_elem *, struct treap_elem *);
+static void clear_subtree (struct treap *, struct treap_elem *,
+		treap_action_func *);
+
+/* Initializes treap T to compare elements using LESS, given
+   auxiliary data AUX. */
+void
+treap_init (struct treap *t, treap_less_func *less, void *aux) {
+	t->elem_cnt = 0;
+	t->root = NULL;
+	t->less = less;
+	t->aux = aux;
+}
+
+/* Removes all the elements from T.
+
+   If DESTRUCTOR is non-null, then it is called for each element
+   in the treap, children before their parent.  DESTRUCTOR may,
+   if appropriate, deallocate the memory used by the treap
+   element.  However, modifying treap T while treap_clear() is
+   running yields undefined behavior. */
+void
+treap_clear (struct treap *t, treap_action_func *destructor) {
+	struct treap_elem *root = t->root;
+
+	t->root = NULL;
+	t->elem_cnt = 0;
+	if (destructor != NULL)
+		clear_subtree (t, root, destructor);
+}
+
+/* Inserts NEW into treap T and returns a null pointer, if no
+   equal element is already in the treap.
+   If an equal element is already in the treap, returns it
+   without inserting NEW. */
+struct treap_elem *
+treap_insert (struct treap *t, struct treap_elem *new) {
+	struct treap_elem *old = *find_link (t, new);
+	struct treap_elem **link;
+
+	if (old != NULL)
+		return old;
+
+	/* The priority is a hash of the element's address, which is
+	   as good as random for keeping the tree shallow and needs
+	   no generator state. */
+	new->priority = ((uint64_t) (uintptr_t) new * 0x9e3779b97f4a7c15ULL) >> 32;
+
+	/* Walk down to where NEW belongs in heap order, then split
+	   the subtree found there around it. */
+	link = &t->root;
+	while (*link != NULL && (*link)->priority > new->priority)
+		link = t->less (new, *link, t->aux) ? &(*link)->left : &(*link)->right;
+	split (t, *link, new, &new->left, &new->right);
+	*link = new;
+	t->elem_cnt++;
+
+	return NULL;
+}
+
+/* Finds and returns an element equal to E in treap T, or a null
+   pointer if no equal element exists in the treap. */
+struct treap_elem *
+treap_find (const struct treap *t, const struct treap_elem *e) {
+	return *find_link (t, e);
+}
+
+/* Returns the greatest element in treap T that is not greater
+   than E, or a null pointer if every element is greater. */
+struct treap_elem *
+treap_floor (const struct treap *t, const struct treap_elem *e) {
+	struct treap_elem *node = t->root;
+	struct treap_elem *best = NULL;
+
+	while (node != NULL)
+		if (t->less (e, node, t->aux))
+			node = node->left;
+		else {
+			best = node;
+			node = node->right;
+		}
+	return best;
+}
+
+/* Returns the least element in treap T that is not less than E,
+   or a null pointer if every element is less. */
+struct treap_elem *
+treap_ceil (const struct treap *t, const struct treap_elem *e) {
+	struct treap_elem *node = t->root;
+	struct treap_elem *best = NULL;
+
+	while (node != NULL)
+		if (t->less (node, e, t->aux))
+			node = node->right;
+		else {
+			best = node;
+			node = node->left;
+		}
+	return best;
+}
+
+/* Finds, removes, and returns an element equal to E in treap T.
+   Returns a null pointer if no equal element existed in the
+   treap.
+
+   If the elements of the treap are dynamically allocated, or own
+   resources that are, then it is the caller's responsibility to
+   deallocate them. */
+struct treap_elem *
+treap_delete (struct treap *t, struct treap_elem *e) {
+	struct treap_elem **link = find_link (t, e);
+	struct treap_elem *found = *link;
+
+	if (found != NULL) {
+		*link = merge (found->left, found->right);
+		t->elem_cnt--;
+	}
+	return found;
+}
+
+/* Returns the least element in treap T, or a null pointer if T is
+   empty. */
+struct treap_elem *
+treap_first (const struct treap *t) {
+	struct treap_elem *node = t->root;
+
+	if (node != NULL)
+		while (node->left != NULL)
+			node = node->left;
+	return node;
+}
+
+/* Returns the least element in treap T that is greater than E,
+   or a null pointer if there is none.  E need not be in T, so
+   iteration may continue after E has been deleted. */
+struct treap_elem *
+treap_next (const struct treap *t, const struct treap_elem *e) {
+	struct treap_elem *node = t->root;
+	struct treap_elem *best = NULL;
+
+	while (node != NULL)
+		if (t->less (e, node, t->aux)) {
+			best = node;
+			node = node->left;
+		} else
+			node = node->right;
+	return best;
+}
+
+/* Returns the number of elements in T. */
+size_t
+treap_size (const struct treap *t) {
+	return t->elem_cnt;
+}
+
+/* Returns true if T contains no elements, false otherwise. */
+bool
+treap_empty (const struct treap *t) {
+	return t->elem_cnt == 0;
+}
+
+/* Returns the link in T that points to the element equal to E,
+   or the null link where such an element would be found. */
+static struct treap_elem **
+find_link (const struct treap *t, const struct treap_elem *e) {
+	struct treap_elem **link = (struct treap_elem **) &t->root;
+
+	while (*link != NULL)
+		if (t->less (e, *link, t->aux))
+			link = &(*link)->left;
+		else if (t->less (*link, e, t->aux))
+			link = &(*link)->right;
+		else
+			break;
+	return link;
+}
+
+/* Splits the subtree rooted at NODE into the elements less than
+   E, stored in *LEFT, and the elements greater than E, stored in
+   *RIGHT.  The subtree must not contain an element equal to E. */
+static void
+split (const struct treap *t, struct treap_elem *node,
+		const struct treap_elem *e,
+		struct treap_elem **left, struct treap_elem **right) {
+	while (node != NULL)
+		if (t->less (node, e, t->aux)) {
+			*left = node;
+			left = &node->right;
+			node = node->right;
+		} else {
+			*right = node;
+			right = &node->left;
+			node = node->left;
+		}
+	*left = *right = NULL;
+}
+
+/* Joins subtrees A and B, where every element of A is less than
+   every element of B, into one subtree and returns its root. */
+static struct treap_elem *
+merge (struct treap_elem *a, struct treap_elem *b) {
+	struct treap_elem *root = NULL;
+	struct treap_elem **link = &root;
+
+	while (a != NULL && b != NULL)
+		if (a->priority > b->priority) {
+			*link = a;
+			link = &a->right;
+			a = a->right;
+		} else {
+			*link = b;
+			link = &b->left;
+			b = b->left;
+		}
+	*link = a != NULL ? a : b;
+	return root;
+}
+
+/* Calls DESTRUCTOR on every element of the subtree rooted at
+   NODE, children first. */
+static void
+clear_subtree (struct treap *t, struct treap_elem *node,
+		treap_action_func *destructor) {
+	if (node != NULL) {
+		struct treap_elem *left = node->left;
+		struct treap_elem *right = node->right;
+
+		clear_subtree (t, left, destructor);
+		clear_subtree (t, right, destructor);
+		destructor (node, t->aux);
+	}
+}
@@ -0,0 +1,25 @@
+#ifndef TESTS_BENCH_H
+#define TESTS_BENCH_H
+
+/* Helpers shared by the user-level benchmarks.  Benchmarks are
+   listed in <dir>_BENCHES rather than <dir>_TESTS and are run by
+   "make bench", which collects their msg() output. */
+
+#include <stdint.h>
+
+/* Reads the processor's time-stamp counter.  Pintos leaves
+   CR4.TSD clear, so this works from user mode. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* Splits the ratio NUM / DEN into integer and hundredths parts,
+   for printing as "%llu.%02llu" without floating point. */
+#define RATIO_INT(NUM, DEN) ((DEN) ? (NUM) / (DEN) : 0)
+#define RATIO_FRAC(NUM, DEN) ((DEN) ? (NUM) * 100 / (DEN) % 100 : 0)
+
+#endif /* tests/bench.h */
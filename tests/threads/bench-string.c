@@ -0,0 +1,158 @@
+/* Measures the throughput of memcpy(), memset(), memcmp() and
+   strlen() in bytes per cycle, for block sizes from 8 bytes to
+   one page, and checks each result for correctness along the
+   way.  The page-sized copy_page() and clear_page() helpers are
+   measured at 4 kB only.
+
+   This is a benchmark rather than a graded test: it is listed in
+   tests/threads_BENCHES and run by "make bench". */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+/* Number of calls timed per size. */
+#define ITERATIONS 256
+
+/* Both buffers are offset by a few bytes from a page boundary so
+   that the unaligned head and tail paths are exercised too. */
+#define MISALIGN 3
+
+static uint8_t *src_page, *dst_page;
+
+/* Prints the throughput of BYTES bytes processed in CYCLES
+   cycles, as a fixed-point number with two decimal places. */
+static void
+report (const char *what, size_t size, uint64_t bytes, uint64_t cycles)
+{
+  uint64_t bpc100 = cycles ? bytes * 100 / cycles : 0;
+  msg ("%-10s %5zu B: %3"PRIu64".%02"PRIu64" bytes/cycle",
+       what, size, bpc100 / 100, bpc100 % 100);
+}
+
+static void
+bench_memcpy (size_t size)
+{
+  uint8_t *dst = dst_page + MISALIGN, *src = src_page + MISALIGN;
+  uint64_t start;
+  int i;
+
+  start = rdtsc ();
+  for (i = 0; i < ITERATIONS; i++)
+    memcpy (dst, src, size);
+  report ("memcpy", size, (uint64_t) size * ITERATIONS, rdtsc () - start);
+
+  for (i = 0; (size_t) i < size; i++)
+    if (dst[i] != src[i])
+      fail ("memcpy of %zu bytes differs at byte %d", size, i);
+}
+
+static void
+bench_memset (size_t size)
+{
+  uint8_t *dst = dst_page + MISALIGN;
+  uint64_t start;
+  int i;
+
+  start = rdtsc ();
+  for (i = 0; i < ITERATIONS; i++)
+    memset (dst, 0x5a, size);
+  report ("memset", size, (uint64_t) size * ITERATIONS, rdtsc () - start);
+
+  for (i = 0; (size_t) i < size; i++)
+    if (dst[i] != 0x5a)
+      fail ("memset of %zu bytes wrong at byte %d", size, i);
+}
+
+static void
+bench_memcmp (size_t size)
+{
+  uint8_t *a = dst_page + MISALIGN, *b = src_page + MISALIGN;
+  uint64_t start;
+  int i, result = 0;
+
+  memcpy (a, b, size);
+  start = rdtsc ();
+  for (i = 0; i < ITERATIONS; i++)
+    result |= memcmp (a, b, size);
+  report ("memcmp", size, (uint64_t) size * ITERATIONS, rdtsc () - start);
+
+  if (result != 0)
+    fail ("memcmp of %zu equal bytes returned nonzero", size);
+  a[size - 1]++;
+  if (memcmp (a, b, size) <= 0 || memcmp (b, a, size) >= 0)
+    fail ("memcmp of %zu bytes misses the last byte", size);
+}
+
+static void
+bench_strlen (size_t size)
+{
+  char *s = (char *) dst_page + MISALIGN;
+  uint64_t start;
+  size_t len = 0;
+  int i;
+
+  memset (s, 'x', size - 1);
+  s[size - 1] = '\0';
+  start = rdtsc ();
+  for (i = 0; i < ITERATIONS; i++)
+    len += strlen (s);
+  report ("strlen", size, (uint64_t) size * ITERATIONS, rdtsc () - start);
+
+  if (len != (size - 1) * ITERATIONS)
+    fail ("strlen of %zu-byte string returned %zu", size,
+          len / ITERATIONS);
+}
+
+static void
+bench_pages (void)
+{
+  uint64_t start;
+  int i;
+
+  start = rdtsc ();
+  for (i = 0; i < ITERATIONS; i++)
+    copy_page (dst_page, src_page);
+  report ("copy_page", PGSIZE, (uint64_t) PGSIZE * ITERATIONS,
+          rdtsc () - start);
+  if (memcmp (dst_page, src_page, PGSIZE))
+    fail ("copy_page produced a different page");
+
+  start = rdtsc ();
+  for (i = 0; i < ITERATIONS; i++)
+    clear_page (dst_page);
+  report ("clear_page", PGSIZE, (uint64_t) PGSIZE * ITERATIONS,
+          rdtsc () - start);
+  for (i = 0; i < PGSIZE; i++)
+    if (dst_page[i] != 0)
+      fail ("clear_page left byte %d nonzero", i);
+}
+
+void
+test_bench_string (void)
+{
+  size_t size;
+  int i;
+
+  src_page = palloc_get_multiple (PAL_ASSERT, 2);
+  dst_page = palloc_get_multiple (PAL_ASSERT, 2);
+  for (i = 0; i < 2 * PGSIZE; i++)
+    src_page[i] = i * 7 + 1;
+
+  for (size = 8; size <= PGSIZE; size *= 2)
+    {
+      bench_memcpy (size);
+      bench_memset (size);
+      bench_memcmp (size);
+      bench_strlen (size);
+    }
+  bench_pages ();
+
+  palloc_free_multiple (src_page, 2);
+  palloc_free_multiple (dst_page, 2);
+  pass ();
+}
@@ -0,0 +1,98 @@
+/* Measures file throughput, in bytes per million cycles, reading
+   and writing a file in 4 kB requests through read and write,
+   pread and pwrite, and readv and writev with each request split
+   into IOV_MAX buffers. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (256 * 1024)
+#define REQUEST 4096
+#define PASSES 4
+#define MEGA 1000000ULL
+
+static char buf[REQUEST];
+
+enum method { PLAIN, POSITIONAL, VECTORED };
+
+static const char *const method_names[] = { "read/write", "pread/pwrite",
+                                            "readv/writev" };
+
+/* Transfers the whole file at FD once, reading or WRITING it with
+   METHOD. */
+static void
+pass (int fd, enum method method, bool writing)
+{
+  struct iovec iov[IOV_MAX];
+  off_t ofs;
+  int i, n = 0;
+
+  for (i = 0; i < IOV_MAX; i++)
+    {
+      iov[i].iov_base = buf + i * (REQUEST / IOV_MAX);
+      iov[i].iov_len = REQUEST / IOV_MAX;
+    }
+
+  seek (fd, 0);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += REQUEST)
+    {
+      switch (method)
+        {
+        case PLAIN:
+          n = writing ? write (fd, buf, REQUEST) : read (fd, buf, REQUEST);
+          break;
+        case POSITIONAL:
+          n = (writing ? pwrite (fd, buf, REQUEST, ofs)
+               : pread (fd, buf, REQUEST, ofs));
+          break;
+        case VECTORED:
+          n = (writing ? writev (fd, iov, IOV_MAX)
+               : readv (fd, iov, IOV_MAX));
+          break;
+        }
+      if (n != REQUEST)
+        fail ("%s: short transfer at %d", method_names[method], ofs);
+    }
+}
+
+/* Returns the bytes per million cycles moved by PASSES passes
+   over the file at FD with METHOD. */
+static uint64_t
+throughput (int fd, enum method method, bool writing)
+{
+  uint64_t start = rdtsc (), elapsed;
+  int i;
+
+  for (i = 0; i < PASSES; i++)
+    pass (fd, method, writing);
+  elapsed = rdtsc () - start;
+  return elapsed ? (uint64_t) FILE_SIZE * PASSES * MEGA / elapsed : 0;
+}
+
+void
+test_main (void)
+{
+  uint64_t rd[3], wr[3];
+  int fd, m;
+
+  CHECK (create ("data", FILE_SIZE), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+
+  for (m = PLAIN; m <= VECTORED; m++)
+    {
+      wr[m] = throughput (fd, m, true);
+      rd[m] = throughput (fd, m, false);
+    }
+  close (fd);
+
+  for (m = PLAIN; m <= VECTORED; m++)
+    msg ("%s: read %llu, write %llu bytes per 10^6 cycles",
+         method_names[m], rd[m], wr[m]);
+  msg ("readv/read: %llu.%02llu", RATIO_INT (rd[VECTORED], rd[PLAIN]),
+       RATIO_FRAC (rd[VECTORED], rd[PLAIN]));
+  msg ("writev/write: %llu.%02llu", RATIO_INT (wr[VECTORED], wr[PLAIN]),
+       RATIO_FRAC (wr[VECTORED], wr[PLAIN]));
+}
@@ -0,0 +1,152 @@
+/* Counts the system calls, and measures the cycles, that two
+   common record patterns take with plain read and write against
+   the vectored and positional calls.  Writing a record of a
+   header and several payload pieces takes one write per piece,
+   or a single writev.  Reading the record at an offset takes a
+   seek and a read, or a single pread. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define HEADER_SIZE 16
+#define PIECES 7
+#define PIECE_SIZE 64
+#define RECORD_SIZE (HEADER_SIZE + PIECES * PIECE_SIZE)
+#define RECORDS 128
+#define ROUNDS 4
+
+static char header[HEADER_SIZE];
+static char payload[PIECES][PIECE_SIZE];
+static char record[RECORD_SIZE];
+
+/* Returns the average cycles to append a record with one write
+   per piece, and adds the calls made to *CALLS. */
+static uint64_t
+time_write (int fd, long long *calls)
+{
+  uint64_t start = rdtsc ();
+  int i, j;
+
+  for (i = 0; i < RECORDS; i++)
+    {
+      if (write (fd, header, HEADER_SIZE) != HEADER_SIZE)
+        fail ("write header failed");
+      for (j = 0; j < PIECES; j++)
+        if (write (fd, payload[j], PIECE_SIZE) != PIECE_SIZE)
+          fail ("write piece failed");
+      *calls += 1 + PIECES;
+    }
+  return (rdtsc () - start) / RECORDS;
+}
+
+/* Returns the average cycles to append a record with writev,
+   and adds the calls made to *CALLS. */
+static uint64_t
+time_writev (int fd, long long *calls)
+{
+  struct iovec iov[1 + PIECES];
+  uint64_t start;
+  int i;
+
+  iov[0].iov_base = header;
+  iov[0].iov_len = HEADER_SIZE;
+  for (i = 0; i < PIECES; i++)
+    {
+      iov[1 + i].iov_base = payload[i];
+      iov[1 + i].iov_len = PIECE_SIZE;
+    }
+
+  start = rdtsc ();
+  for (i = 0; i < RECORDS; i++)
+    {
+      if (writev (fd, iov, 1 + PIECES) != RECORD_SIZE)
+        fail ("writev failed");
+      *calls += 1;
+    }
+  return (rdtsc () - start) / RECORDS;
+}
+
+/* Returns the offset of the Ith record read, in a scattered
+   order. */
+static off_t
+record_ofs (int i)
+{
+  return (i * 37 % RECORDS) * RECORD_SIZE;
+}
+
+/* Returns the average cycles to read a record at an offset with
+   seek and read, and adds the calls made to *CALLS. */
+static uint64_t
+time_seek_read (int fd, long long *calls)
+{
+  uint64_t start = rdtsc ();
+  int i;
+
+  for (i = 0; i < RECORDS; i++)
+    {
+      seek (fd, record_ofs (i));
+      if (read (fd, record, RECORD_SIZE) != RECORD_SIZE)
+        fail ("read failed");
+      *calls += 2;
+    }
+  return (rdtsc () - start) / RECORDS;
+}
+
+/* Returns the average cycles to read a record at an offset with
+   pread, and adds the calls made to *CALLS. */
+static uint64_t
+time_pread (int fd, long long *calls)
+{
+  uint64_t start = rdtsc ();
+  int i;
+
+  for (i = 0; i < RECORDS; i++)
+    {
+      if (pread (fd, record, RECORD_SIZE, record_ofs (i)) != RECORD_SIZE)
+        fail ("pread failed");
+      *calls += 1;
+    }
+  return (rdtsc () - start) / RECORDS;
+}
+
+void
+test_main (void)
+{
+  uint64_t plain_w = 0, vec_w = 0, plain_r = 0, pos_r = 0;
+  long long plain_w_calls = 0, vec_w_calls = 0;
+  long long plain_r_calls = 0, pos_r_calls = 0;
+  int fd, i;
+
+  memset (header, 'h', sizeof header);
+  memset (payload, 'p', sizeof payload);
+  CHECK (create ("records", RECORDS * RECORD_SIZE), "create \"records\"");
+  CHECK ((fd = open ("records")) > 1, "open \"records\"");
+
+  for (i = 0; i < ROUNDS; i++)
+    {
+      seek (fd, 0);
+      plain_w += time_write (fd, &plain_w_calls);
+      seek (fd, 0);
+      vec_w += time_writev (fd, &vec_w_calls);
+      plain_r += time_seek_read (fd, &plain_r_calls);
+      pos_r += time_pread (fd, &pos_r_calls);
+    }
+  close (fd);
+
+  msg ("write a record, write: %lld calls, %llu cycles",
+       plain_w_calls / (ROUNDS * RECORDS), plain_w / ROUNDS);
+  msg ("write a record, writev: %lld calls, %llu cycles",
+       vec_w_calls / (ROUNDS * RECORDS), vec_w / ROUNDS);
+  msg ("write/writev: %llu.%02llu", RATIO_INT (plain_w, vec_w),
+       RATIO_FRAC (plain_w, vec_w));
+  msg ("read a record, seek+read: %lld calls, %llu cycles",
+       plain_r_calls / (ROUNDS * RECORDS), plain_r / ROUNDS);
+  msg ("read a record, pread: %lld calls, %llu cycles",
+       pos_r_calls / (ROUNDS * RECORDS), pos_r / ROUNDS);
+  msg ("seek+read/pread: %llu.%02llu", RATIO_INT (plain_r, pos_r),
+       RATIO_FRAC (plain_r, pos_r));
+}
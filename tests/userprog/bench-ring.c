@@ -0,0 +1,156 @@
+/* Measures small-request throughput, in requests per million
+   cycles, through plain system calls against the syscall ring.
+   Each plain write or pread is a trip into the kernel; through
+   the ring, BATCH requests share one ring_enter.  Also counts
+   kernel entries per request for each. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define REQUEST 64
+#define REQUESTS 2048
+#define BATCH 32
+#define MEGA 1000000ULL
+
+static struct io_ring ring;
+static char buf[BATCH][REQUEST];
+
+/* Throughput and kernel entries of one way of doing REQUESTS
+   requests. */
+struct result
+  {
+    uint64_t cycles;
+    long long entries;
+  };
+
+/* Writes, or reads back with pread if READING, REQUESTS records
+   of the file at FD with plain system calls. */
+static struct result
+plain (int fd, bool reading)
+{
+  struct result r = { 0, 0 };
+  uint64_t start = rdtsc ();
+  int i;
+
+  for (i = 0; i < REQUESTS; i++)
+    {
+      int n = (reading ? pread (fd, buf[0], REQUEST, i * REQUEST)
+               : write (fd, buf[0], REQUEST));
+      if (n != REQUEST)
+        fail ("plain request %d: %d bytes", i, n);
+      r.entries++;
+    }
+  r.cycles = rdtsc () - start;
+  return r;
+}
+
+/* Queues a request with OPCODE on FD for BUFFER, of LEN bytes at
+   OFFSET. */
+static void
+queue (int opcode, int fd, void *buffer, unsigned len, off_t offset)
+{
+  struct ring_sqe *sqe = &ring.sq[ring.sq_tail % RING_ENTRIES];
+
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->buf = buffer;
+  sqe->len = len;
+  sqe->offset = offset;
+  sqe->user_data = ring.sq_tail;
+  ring.sq_tail++;
+}
+
+/* Hands over everything queued, waits for all of it, and returns
+   the result of the last request.  Fails if any other request
+   did not return EXPECT. */
+static int
+submit_all (int expect, long long *entries)
+{
+  unsigned queued = ring.sq_tail - ring.sq_head;
+  unsigned done = 0;
+  int res = -1;
+
+  while (done < queued)
+    {
+      if (ring_enter (ring.sq_tail - ring.sq_head, queued - done) < 0)
+        fail ("ring_enter failed");
+      (*entries)++;
+      while (ring.cq_head != ring.cq_tail)
+        {
+          struct ring_cqe *cqe = &ring.cq[ring.cq_head % RING_ENTRIES];
+
+          res = cqe->res;
+          if (++done < queued && res != expect)
+            fail ("ring request %llu: %d", cqe->user_data, res);
+          ring.cq_head++;
+        }
+    }
+  return res;
+}
+
+/* Does the same requests as plain() through the ring. */
+static struct result
+ringed (int fd, bool reading)
+{
+  struct result r = { 0, 0 };
+  uint64_t start = rdtsc ();
+  int i, j;
+
+  for (i = 0; i < REQUESTS; i += BATCH)
+    {
+      for (j = 0; j < BATCH; j++)
+        if (reading)
+          queue (RING_PREAD, fd, buf[j], REQUEST, (i + j) * REQUEST);
+        else
+          queue (RING_WRITE, fd, buf[j], REQUEST, 0);
+      if (submit_all (REQUEST, &r.entries) != REQUEST)
+        fail ("ring batch at %d failed", i);
+    }
+  r.cycles = rdtsc () - start;
+  return r;
+}
+
+static void
+report (const char *what, struct result plain_r, struct result ring_r)
+{
+  uint64_t plain_tput = plain_r.cycles ? REQUESTS * MEGA / plain_r.cycles : 0;
+  uint64_t ring_tput = ring_r.cycles ? REQUESTS * MEGA / ring_r.cycles : 0;
+
+  msg ("%s, plain: %llu requests per 10^6 cycles, %lld entries", what,
+       plain_tput, plain_r.entries);
+  msg ("%s, ring: %llu requests per 10^6 cycles, %lld entries", what,
+       ring_tput, ring_r.entries);
+  msg ("%s, ring/plain: %llu.%02llu", what, RATIO_INT (ring_tput, plain_tput),
+       RATIO_FRAC (ring_tput, plain_tput));
+}
+
+void
+test_main (void)
+{
+  struct result plain_w, plain_r, ring_w, ring_r;
+  long long entries = 0;
+  int fd;
+
+  memset (buf, 'r', sizeof buf);
+  CHECK (create ("data", REQUESTS * REQUEST), "create \"data\"");
+  CHECK (ring_setup (&ring) == 0, "ring_setup");
+
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  plain_w = plain (fd, false);
+  plain_r = plain (fd, true);
+  close (fd);
+
+  queue (RING_OPEN, 0, "data", 0, 0);
+  CHECK ((fd = submit_all (0, &entries)) > 1, "open \"data\" through ring");
+  ring_w = ringed (fd, false);
+  ring_r = ringed (fd, true);
+  queue (RING_CLOSE, fd, NULL, 0, 0);
+  CHECK (submit_all (0, &entries) == 0, "close through ring");
+
+  report ("write", plain_w, ring_w);
+  report ("pread", plain_r, ring_r);
+}
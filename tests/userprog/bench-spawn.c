@@ -0,0 +1,76 @@
+/* Measures process launches per second, counted per billion
+   cycles, through fork followed by exec against spawn.  Each
+   launch starts a program that exits at once and waits for it.
+   The parent has some memory resident, as a real launcher would,
+   which fork shares with the child and exec then throws away;
+   spawn never touches it. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGES 256
+#define LAUNCHES 32
+#define GIGA 1000000000ULL
+
+static uint8_t buf[PAGES * PAGE_SIZE];
+
+/* Returns the average cycles per launch through fork and exec. */
+static uint64_t
+time_fork_exec (void)
+{
+  uint64_t start = rdtsc ();
+  int i;
+
+  for (i = 0; i < LAUNCHES; i++)
+    {
+      pid_t pid = fork ("child-exit");
+      if (pid == 0)
+        {
+          exec ("child-exit");
+          exit (-1);
+        }
+      if (wait (pid) != 0)
+        fail ("fork+exec child failed");
+    }
+  return (rdtsc () - start) / LAUNCHES;
+}
+
+/* Returns the average cycles per launch through spawn. */
+static uint64_t
+time_spawn (void)
+{
+  uint64_t start = rdtsc ();
+  int i;
+
+  for (i = 0; i < LAUNCHES; i++)
+    {
+      pid_t pid = spawn ("child-exit", NULL);
+      if (pid < 0 || wait (pid) != 0)
+        fail ("spawned child failed");
+    }
+  return (rdtsc () - start) / LAUNCHES;
+}
+
+void
+test_main (void)
+{
+  uint64_t fork_exec, spawned;
+  size_t i;
+
+  for (i = 0; i < PAGES; i++)
+    buf[i * PAGE_SIZE] = i;
+
+  fork_exec = time_fork_exec ();
+  spawned = time_spawn ();
+
+  msg ("fork+exec: %llu cycles, %llu launches per 10^9 cycles",
+       fork_exec, fork_exec ? GIGA / fork_exec : 0);
+  msg ("spawn: %llu cycles, %llu launches per 10^9 cycles",
+       spawned, spawned ? GIGA / spawned : 0);
+  msg ("fork+exec/spawn: %llu.%02llu", RATIO_INT (fork_exec, spawned),
+       RATIO_FRAC (fork_exec, spawned));
+}
@@ -0,0 +1,51 @@
+/* Measures the cost of touching one byte in each page of a 4 MB
+   buffer in a scattered order, which misses in the TLB on nearly
+   every access when the buffer is mapped with 4 kB pages.  Run
+   as bench-tlb for 4 kB pages and as bench-tlb-lp, with the -lp
+   kernel option, for 2 MB pages. */
+
+#include <stdint.h>
+#include "tests/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define LARGE_PAGE (2 * 1024 * 1024)
+#define BUF_SIZE (2 * LARGE_PAGE)
+#define PAGE_SIZE 4096
+#define PAGE_CNT (BUF_SIZE / PAGE_SIZE)
+
+/* Stride between consecutive accesses, in pages.  It is odd, and
+   so coprime to PAGE_CNT, so every page is visited once per
+   round. */
+#define STRIDE 613
+#define ROUNDS 32
+
+/* Aligned so that -lp can map it with whole large pages. */
+static volatile uint8_t buf[BUF_SIZE] __attribute__ ((aligned (LARGE_PAGE)));
+
+void
+test_main (void)
+{
+  uint64_t start, cycles, accesses;
+  unsigned sum = 0;
+  size_t page = 0;
+  int round, i;
+
+  /* Warm up: make sure every page is present. */
+  for (i = 0; i < PAGE_CNT; i++)
+    buf[i * PAGE_SIZE] = i;
+
+  start = rdtsc ();
+  for (round = 0; round < ROUNDS; round++)
+    for (i = 0; i < PAGE_CNT; i++)
+      {
+        sum += buf[page * PAGE_SIZE + (i & 63) * 64];
+        page = (page + STRIDE) % PAGE_CNT;
+      }
+  cycles = rdtsc () - start;
+  accesses = (uint64_t) ROUNDS * PAGE_CNT;
+
+  msg ("%d pages, %llu accesses: %llu.%02llu cycles/access (sum %u)",
+       PAGE_CNT, accesses, RATIO_INT (cycles, accesses),
+       RATIO_FRAC (cycles, accesses), sum);
+}
@@ -0,0 +1,9 @@
+/* Child process for bench-fork and bench-spawn.  Exits at once,
+   without printing anything, so that only the cost of starting it
+   is measured. */
+
+int
+main (void)
+{
+  return 0;
+}
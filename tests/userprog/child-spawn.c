@@ -0,0 +1,31 @@
+/* Child process run by the spawn-fds test.
+
+   Checks the file descriptors spawn() handed it.  The three
+   command-line arguments name one closed by SPAWN_CLOSE, one
+   left open, and a SPAWN_DUP2 copy of the second, which must
+   share its file position. */
+
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+
+const char *test_name = "child-spawn";
+
+int
+main (int argc, char *argv[])
+{
+  int closed, kept, copy;
+  char c;
+
+  if (argc != 4)
+    fail ("bad command-line arguments");
+  closed = atoi (argv[1]);
+  kept = atoi (argv[2]);
+  copy = atoi (argv[3]);
+
+  CHECK (read (closed, &c, 1) == -1, "read closed fd");
+  check_file_handle (copy, "sample.txt", sample, sizeof sample - 1);
+  CHECK (tell (kept) == sizeof sample - 1, "copy shares the file position");
+  return 42;
+}
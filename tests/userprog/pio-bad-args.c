@@ -0,0 +1,31 @@
+/* Passes bad descriptors, offsets and vector lengths to pread,
+   pwrite, readv and writev, which must fail with -1.  Descriptor
+   2 is not open yet; 0 and 1 are the console, which has no
+   offsets and cannot be read into a vector. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char buf[1];
+  struct iovec iov = { buf, 1 };
+  int fd;
+
+  for (fd = 0; fd <= 2; fd++)
+    {
+      CHECK (pread (fd, buf, 1, 0) == -1, "pread fd %d", fd);
+      CHECK (pwrite (fd, buf, 1, 0) == -1, "pwrite fd %d", fd);
+      CHECK (readv (fd, &iov, 1) == -1, "readv fd %d", fd);
+    }
+  CHECK (writev (0, &iov, 1) == -1, "writev fd 0");
+  CHECK (writev (2, &iov, 1) == -1, "writev fd 2");
+
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (pread (fd, buf, 1, -1) == -1, "pread at offset -1");
+  CHECK (pwrite (fd, buf, 1, -1) == -1, "pwrite at offset -1");
+  CHECK (readv (fd, &iov, -1) == -1, "readv -1 buffers");
+  CHECK (writev (fd, &iov, -1) == -1, "writev -1 buffers");
+}
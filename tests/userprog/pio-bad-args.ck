@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pio-bad-args) begin
+(pio-bad-args) pread fd 0
+(pio-bad-args) pwrite fd 0
+(pio-bad-args) readv fd 0
+(pio-bad-args) pread fd 1
+(pio-bad-args) pwrite fd 1
+(pio-bad-args) readv fd 1
+(pio-bad-args) pread fd 2
+(pio-bad-args) pwrite fd 2
+(pio-bad-args) readv fd 2
+(pio-bad-args) writev fd 0
+(pio-bad-args) writev fd 2
+(pio-bad-args) open "sample.txt"
+(pio-bad-args) pread at offset -1
+(pio-bad-args) pwrite at offset -1
+(pio-bad-args) readv -1 buffers
+(pio-bad-args) writev -1 buffers
+(pio-bad-args) end
+pio-bad-args: exit(0)
+EOF
+pass;
@@ -0,0 +1,33 @@
+/* Checks that pread and pwrite transfer at the offset they are
+   given and leave the file position alone, so that read carries
+   on where it was. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char buf[8];
+  int fd;
+
+  CHECK (create ("pos", 64), "create \"pos\"");
+  CHECK ((fd = open ("pos")) > 1, "open \"pos\"");
+  CHECK (write (fd, "0123456789ABCDEF", 16) == 16, "write 16 bytes");
+  seek (fd, 4);
+
+  CHECK (pwrite (fd, "xyz", 3, 40) == 3, "pwrite 3 bytes at 40");
+  CHECK (tell (fd) == 4, "position still 4");
+  CHECK (pread (fd, buf, 3, 40) == 3 && !memcmp (buf, "xyz", 3),
+         "pread 3 bytes at 40");
+  CHECK (pread (fd, buf, 4, 10) == 4 && !memcmp (buf, "ABCD", 4),
+         "pread 4 bytes at 10");
+  CHECK (tell (fd) == 4, "position still 4");
+  CHECK (read (fd, buf, 3) == 3 && !memcmp (buf, "456", 3),
+         "read carries on at 4");
+  CHECK (pread (fd, buf, 8, 60) == 4, "pread past the end is short");
+  CHECK (pwrite (fd, "abcdefgh", 8, 60) == 4, "pwrite past the end is short");
+  close (fd);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-pwrite) begin
+(pread-pwrite) create "pos"
+(pread-pwrite) open "pos"
+(pread-pwrite) write 16 bytes
+(pread-pwrite) pwrite 3 bytes at 40
+(pread-pwrite) position still 4
+(pread-pwrite) pread 3 bytes at 40
+(pread-pwrite) pread 4 bytes at 10
+(pread-pwrite) position still 4
+(pread-pwrite) read carries on at 4
+(pread-pwrite) pread past the end is short
+(pread-pwrite) pwrite past the end is short
+(pread-pwrite) end
+pread-pwrite: exit(0)
+EOF
+pass;
@@ -0,0 +1,80 @@
+/* Writes a file with writev from several buffers, one of them
+   empty, and reads it back with readv into buffers split at
+   other places.  Then does the same with buffers that add up to
+   more than a page.  Also checks that an empty vector transfers
+   nothing and that one longer than IOV_MAX is refused. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BIG 3000
+
+static char big_out[3][BIG];
+static char big_in[2][3 * BIG / 2];
+
+void
+test_main (void)
+{
+  static const char expect[] = "Vectored I/O gathers and scatters.";
+  const int len = sizeof expect - 1;
+  struct iovec out[4] = {
+    { "Vectored ", 9 }, { "", 0 }, { "I/O gathers and ", 16 },
+    { "scatters.", 9 },
+  };
+  struct iovec in[3], many[IOV_MAX + 1];
+  char a[5], b[20], c[64];
+  int fd, i;
+
+  CHECK (create ("iov", len), "create \"iov\"");
+  CHECK ((fd = open ("iov")) > 1, "open \"iov\"");
+  CHECK (writev (fd, out, 4) == len, "writev 4 buffers");
+  CHECK (tell (fd) == (unsigned) len, "position after writev");
+
+  seek (fd, 0);
+  in[0].iov_base = a;
+  in[0].iov_len = sizeof a;
+  in[1].iov_base = b;
+  in[1].iov_len = sizeof b;
+  in[2].iov_base = c;
+  in[2].iov_len = sizeof c;
+  CHECK (readv (fd, in, 3) == len, "readv 3 buffers");
+  if (memcmp (a, expect, 5) || memcmp (b, expect + 5, 20)
+      || memcmp (c, expect + 25, len - 25))
+    fail ("readv scattered the wrong bytes");
+
+  CHECK (readv (fd, in, 0) == 0, "readv 0 buffers");
+  CHECK (writev (fd, out, 0) == 0, "writev 0 buffers");
+  for (i = 0; i < IOV_MAX + 1; i++)
+    {
+      many[i].iov_base = a;
+      many[i].iov_len = 1;
+    }
+  CHECK (readv (fd, many, IOV_MAX + 1) == -1, "readv IOV_MAX + 1 buffers");
+  CHECK (writev (fd, many, IOV_MAX + 1) == -1, "writev IOV_MAX + 1 buffers");
+  CHECK (tell (fd) == (unsigned) len, "position unchanged");
+  close (fd);
+
+  for (i = 0; i < 3 * BIG; i++)
+    big_out[i / BIG][i % BIG] = i % 251;
+  for (i = 0; i < 3; i++)
+    {
+      out[i].iov_base = big_out[i];
+      out[i].iov_len = BIG;
+    }
+  CHECK (create ("big", 3 * BIG), "create \"big\"");
+  CHECK ((fd = open ("big")) > 1, "open \"big\"");
+  CHECK (writev (fd, out, 3) == 3 * BIG, "writev 3 buffers of %d bytes", BIG);
+  seek (fd, 0);
+  for (i = 0; i < 2; i++)
+    {
+      in[i].iov_base = big_in[i];
+      in[i].iov_len = 3 * BIG / 2;
+    }
+  CHECK (readv (fd, in, 2) == 3 * BIG, "readv 2 buffers of %d bytes",
+         3 * BIG / 2);
+  if (memcmp (big_in, big_out, 3 * BIG))
+    fail ("readv read back the wrong bytes");
+  close (fd);
+}
@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(readv-writev) begin
+(readv-writev) create "iov"
+(readv-writev) open "iov"
+(readv-writev) writev 4 buffers
+(readv-writev) position after writev
+(readv-writev) readv 3 buffers
+(readv-writev) readv 0 buffers
+(readv-writev) writev 0 buffers
+(readv-writev) readv IOV_MAX + 1 buffers
+(readv-writev) writev IOV_MAX + 1 buffers
+(readv-writev) position unchanged
+(readv-writev) create "big"
+(readv-writev) open "big"
+(readv-writev) writev 3 buffers of 3000 bytes
+(readv-writev) readv 2 buffers of 4500 bytes
+(readv-writev) end
+readv-writev: exit(0)
+EOF
+pass;
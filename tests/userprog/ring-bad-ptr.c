@@ -0,0 +1,29 @@
+/* Passes ring_setup rings that are not wholly writable user
+   memory: a null pointer, a kernel address, an unmapped address,
+   read-only code, and one that runs off the end of the stack.
+   Each must be refused with -1, as must ring_enter with no ring
+   set up, and a good ring must still work afterward. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct io_ring ring;
+
+void
+test_main (void)
+{
+  struct io_ring *past_stack = (struct io_ring *) (0x47480000 - 16);
+
+  CHECK (ring_enter (0, 0) == -1, "ring_enter without a ring");
+  CHECK (ring_setup (NULL) == -1, "ring_setup (NULL)");
+  CHECK (ring_setup ((struct io_ring *) 0x8004000000) == -1,
+         "ring_setup (kernel address)");
+  CHECK (ring_setup ((struct io_ring *) 0x20101234) == -1,
+         "ring_setup (unmapped address)");
+  CHECK (ring_setup ((struct io_ring *) test_main) == -1,
+         "ring_setup (code)");
+  CHECK (ring_setup (past_stack) == -1, "ring_setup (past the stack)");
+  CHECK (ring_setup (&ring) == 0, "ring_setup (&ring)");
+  CHECK (ring_enter (0, 0) == 0, "ring_enter");
+}
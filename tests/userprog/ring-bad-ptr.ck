@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-bad-ptr) begin
+(ring-bad-ptr) ring_enter without a ring
+(ring-bad-ptr) ring_setup (NULL)
+(ring-bad-ptr) ring_setup (kernel address)
+(ring-bad-ptr) ring_setup (unmapped address)
+(ring-bad-ptr) ring_setup (code)
+(ring-bad-ptr) ring_setup (past the stack)
+(ring-bad-ptr) ring_setup (&ring)
+(ring-bad-ptr) ring_enter
+(ring-bad-ptr) end
+ring-bad-ptr: exit(0)
+EOF
+pass;
@@ -0,0 +1,51 @@
+/* Hands over one batch mixing open, write, pwrite, pread, read
+   and close, then a read of the closed descriptor, and checks
+   that each request completes in submission order with what the
+   plain system call would have returned. */
+
+#include <string.h>
+#include "tests/userprog/ring.inc"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  static const int expect[] = { 5, 2, 5, 5, 0, -1 };
+  char pread_buf[5], read_buf[5], check[12];
+  struct ring_cqe cqe;
+  int fd, i;
+
+  CHECK (create ("ringfile", sizeof check), "create \"ringfile\"");
+  CHECK (ring_setup (&ring) == 0, "ring_setup");
+
+  ring_queue (RING_OPEN, 0, "ringfile", 0, 0, 1);
+  CHECK (ring_enter (1, 1) == 1, "submit open");
+  cqe = ring_reap ();
+  CHECK (cqe.user_data == 1 && (fd = cqe.res) > 1,
+         "open \"ringfile\" through the ring");
+
+  memset (read_buf, 'x', sizeof read_buf);
+  ring_queue (RING_WRITE, fd, "hello", 5, 0, 2);
+  ring_queue (RING_PWRITE, fd, "XY", 2, 10, 3);
+  ring_queue (RING_PREAD, fd, pread_buf, 5, 0, 4);
+  ring_queue (RING_READ, fd, read_buf, 5, 0, 5);
+  ring_queue (RING_CLOSE, fd, NULL, 0, 0, 6);
+  ring_queue (RING_READ, fd, read_buf, 5, 0, 7);
+  CHECK (ring_enter (6, 6) == 6, "submit 6 requests");
+  for (i = 0; i < 6; i++)
+    {
+      cqe = ring_reap ();
+      if (cqe.user_data != (unsigned long long) i + 2 || cqe.res != expect[i])
+        fail ("completion %d: user_data %d, result %d, expected %d, %d",
+              i, (int) cqe.user_data, cqe.res, i + 2, expect[i]);
+    }
+  msg ("completions arrived in order with the right results");
+  CHECK (!memcmp (pread_buf, "hello", 5), "pread saw the write");
+  CHECK (!memcmp (read_buf, "\0\0\0\0\0", 5), "read went on from the write");
+
+  CHECK ((fd = open ("ringfile")) > 1, "open \"ringfile\"");
+  CHECK (read (fd, check, sizeof check) == (int) sizeof check
+         && !memcmp (check, "hello\0\0\0\0\0XY", sizeof check),
+         "file holds both writes");
+  close (fd);
+}
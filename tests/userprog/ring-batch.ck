@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-batch) begin
+(ring-batch) create "ringfile"
+(ring-batch) ring_setup
+(ring-batch) submit open
+(ring-batch) open "ringfile" through the ring
+(ring-batch) submit 6 requests
+(ring-batch) completions arrived in order with the right results
+(ring-batch) pread saw the write
+(ring-batch) read went on from the write
+(ring-batch) open "ringfile"
+(ring-batch) file holds both writes
+(ring-batch) end
+ring-batch: exit(0)
+EOF
+pass;
@@ -0,0 +1,49 @@
+/* Hands over writes without waiting for them, then closes the
+   file while they may still be in flight.  Every write must
+   still complete, with its full length, and reach the file. */
+
+#include <string.h>
+#include "tests/userprog/ring.inc"
+#include "tests/main.h"
+
+#define WRITES 32
+#define SIZE 1024
+
+static char data[WRITES][SIZE];
+static char check[SIZE];
+
+void
+test_main (void)
+{
+  int fd, i;
+
+  CHECK (create ("inflight", WRITES * SIZE), "create \"inflight\"");
+  CHECK ((fd = open ("inflight")) > 1, "open \"inflight\"");
+  CHECK (ring_setup (&ring) == 0, "ring_setup");
+
+  for (i = 0; i < WRITES; i++)
+    {
+      memset (data[i], 'a' + i % 26, SIZE);
+      ring_queue (RING_WRITE, fd, data[i], SIZE, 0, i);
+    }
+  CHECK (ring_enter (WRITES, 0) == WRITES, "submit %d writes", WRITES);
+  close (fd);
+  msg ("close \"inflight\"");
+
+  CHECK (ring_enter (0, WRITES) == 0, "wait for completions");
+  for (i = 0; i < WRITES; i++)
+    {
+      struct ring_cqe cqe = ring_reap ();
+      if (cqe.user_data != (unsigned long long) i || cqe.res != SIZE)
+        fail ("write %d: user_data %d, result %d",
+              i, (int) cqe.user_data, cqe.res);
+    }
+  msg ("all writes completed");
+
+  CHECK ((fd = open ("inflight")) > 1, "open \"inflight\"");
+  for (i = 0; i < WRITES; i++)
+    if (read (fd, check, SIZE) != SIZE || memcmp (check, data[i], SIZE))
+      fail ("write %d missing from \"inflight\"", i);
+  msg ("file holds all writes");
+  close (fd);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-close-inflight) begin
+(ring-close-inflight) create "inflight"
+(ring-close-inflight) open "inflight"
+(ring-close-inflight) ring_setup
+(ring-close-inflight) submit 32 writes
+(ring-close-inflight) close "inflight"
+(ring-close-inflight) wait for completions
+(ring-close-inflight) all writes completed
+(ring-close-inflight) open "inflight"
+(ring-close-inflight) file holds all writes
+(ring-close-inflight) end
+ring-close-inflight: exit(0)
+EOF
+pass;
@@ -0,0 +1,57 @@
+/* A child hands half its queued writes to the kernel without
+   waiting for them and exits with the rest still queued and no
+   completion consumed.  Its exit must not hang, nor post results
+   to the ring that went away with its memory.  The parent then
+   sets up a ring of its own and reads back what the child
+   handed over. */
+
+#include <string.h>
+#include "tests/userprog/ring.inc"
+#include "tests/main.h"
+
+#define WRITES 32
+#define SIZE 1024
+
+static char data[SIZE];
+static char check[SIZE];
+
+static void
+run_child (void)
+{
+  int fd, i;
+
+  if ((fd = open ("pending")) < 2)
+    fail ("child: open \"pending\"");
+  if (ring_setup (&ring) != 0)
+    fail ("child: ring_setup");
+  for (i = 0; i < WRITES; i++)
+    ring_queue (RING_PWRITE, fd, data, SIZE, i * SIZE, i);
+  if (ring_enter (WRITES / 2, 0) != WRITES / 2)
+    fail ("child: ring_enter");
+  exit (81);
+}
+
+void
+test_main (void)
+{
+  struct ring_cqe cqe;
+  int fd, pid, status;
+
+  memset (data, 'p', SIZE);
+  CHECK (create ("pending", WRITES * SIZE), "create \"pending\"");
+
+  pid = fork ("child");
+  if (pid == 0)
+    run_child ();
+  status = wait (pid);
+  CHECK (status == 81, "wait for child");
+
+  CHECK ((fd = open ("pending")) > 1, "open \"pending\"");
+  CHECK (ring_setup (&ring) == 0, "ring_setup");
+  ring_queue (RING_PREAD, fd, check, SIZE, 0, 1);
+  CHECK (ring_enter (1, 1) == 1, "submit pread");
+  cqe = ring_reap ();
+  CHECK (cqe.user_data == 1 && cqe.res == SIZE, "pread completed");
+  CHECK (!memcmp (check, data, SIZE), "child's write reached the file");
+  close (fd);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-exit-pending) begin
+(ring-exit-pending) create "pending"
+child: exit(81)
+(ring-exit-pending) wait for child
+(ring-exit-pending) open "pending"
+(ring-exit-pending) ring_setup
+(ring-exit-pending) submit pread
+(ring-exit-pending) pread completed
+(ring-exit-pending) child's write reached the file
+(ring-exit-pending) end
+ring-exit-pending: exit(0)
+EOF
+pass;
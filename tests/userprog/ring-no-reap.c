@@ -0,0 +1,49 @@
+/* Fills the ring with requests and hands them over without ever
+   reaping a completion, then queues as many more.  The kernel
+   holds no more requests than the completion queue has room for,
+   so the second batch must stay in the submission queue until
+   the first batch's results are reaped. */
+
+#include "tests/userprog/ring.inc"
+#include "tests/main.h"
+
+#define SIZE 16
+
+static char data[SIZE];
+
+void
+test_main (void)
+{
+  unsigned i;
+  int fd;
+
+  CHECK (create ("noreap", SIZE), "create \"noreap\"");
+  CHECK ((fd = open ("noreap")) > 1, "open \"noreap\"");
+  CHECK (ring_setup (&ring) == 0, "ring_setup");
+
+  for (i = 0; i < RING_ENTRIES; i++)
+    ring_queue (RING_PWRITE, fd, data, SIZE, 0, i);
+  CHECK (ring_enter (RING_ENTRIES, 0) == RING_ENTRIES,
+         "submit %d writes", RING_ENTRIES);
+  for (i = 0; i < RING_ENTRIES; i++)
+    ring_queue (RING_PWRITE, fd, data, SIZE, 0, RING_ENTRIES + i);
+  CHECK (ring_enter (RING_ENTRIES, 0) == 0, "submit more without reaping");
+  CHECK (ring_enter (RING_ENTRIES, RING_ENTRIES) == 0, "submit again");
+  CHECK (ring.sq_head == RING_ENTRIES, "rest left in submission queue");
+
+  for (i = 0; i < RING_ENTRIES; i++)
+    {
+      struct ring_cqe cqe = ring_reap ();
+      if (cqe.user_data != i || cqe.res != SIZE)
+        fail ("write %u: user_data %d, result %d",
+              i, (int) cqe.user_data, cqe.res);
+    }
+  msg ("reap %d completions", RING_ENTRIES);
+  CHECK (ring_enter (RING_ENTRIES, RING_ENTRIES) == RING_ENTRIES,
+         "submit the rest");
+  for (i = 0; i < RING_ENTRIES; i++)
+    if (ring_reap ().user_data != RING_ENTRIES + i)
+      fail ("completion %u out of order", RING_ENTRIES + i);
+  msg ("reap %d completions", RING_ENTRIES);
+  close (fd);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-no-reap) begin
+(ring-no-reap) create "noreap"
+(ring-no-reap) open "noreap"
+(ring-no-reap) ring_setup
+(ring-no-reap) submit 64 writes
+(ring-no-reap) submit more without reaping
+(ring-no-reap) submit again
+(ring-no-reap) rest left in submission queue
+(ring-no-reap) reap 64 completions
+(ring-no-reap) submit the rest
+(ring-no-reap) reap 64 completions
+(ring-no-reap) end
+ring-no-reap: exit(0)
+EOF
+pass;
@@ -0,0 +1,39 @@
+/* Passes spawn() a missing program and action lists it must
+   refuse: an unknown action, SPAWN_DUP2 from a descriptor that
+   is not open, one out of range, and a list with no SPAWN_END.
+   Each must return -1 and leave no child behind, and a good
+   spawn must still work afterward. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define LONG_CNT 64
+
+void
+test_main (void)
+{
+  static const struct spawn_action bad_op[] =
+    { { 99, 0, 0 }, { SPAWN_END, 0, 0 } };
+  static const struct spawn_action bad_dup[] =
+    { { SPAWN_DUP2, 20, 21 }, { SPAWN_END, 0, 0 } };
+  static const struct spawn_action bad_fd[] =
+    { { SPAWN_CLOSE, -1, 0 }, { SPAWN_END, 0, 0 } };
+  static struct spawn_action no_end[LONG_CNT];
+  pid_t pid;
+  int i;
+
+  for (i = 0; i < LONG_CNT; i++)
+    no_end[i] = (struct spawn_action) { SPAWN_CLOSE, 20, 0 };
+
+  msg ("spawn(\"no-such-file\"): %d", spawn ("no-such-file", NULL));
+  CHECK (spawn ("child-simple", bad_op) == -1, "spawn with an unknown action");
+  CHECK (spawn ("child-simple", bad_dup) == -1,
+         "spawn with SPAWN_DUP2 from a closed fd");
+  CHECK (spawn ("child-simple", bad_fd) == -1, "spawn with fd -1");
+  CHECK (spawn ("child-simple", no_end) == -1, "spawn with no SPAWN_END");
+  CHECK (wait (-1) == -1, "wait(-1)");
+
+  CHECK ((pid = spawn ("child-simple", NULL)) > 0, "spawn \"child-simple\"");
+  msg ("wait(spawn()) = %d", wait (pid));
+}
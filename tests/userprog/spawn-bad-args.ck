@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn-bad-args) begin
+load: no-such-file: open failed
+(spawn-bad-args) spawn("no-such-file"): -1
+(spawn-bad-args) spawn with an unknown action
+(spawn-bad-args) spawn with SPAWN_DUP2 from a closed fd
+(spawn-bad-args) spawn with fd -1
+(spawn-bad-args) spawn with no SPAWN_END
+(spawn-bad-args) wait(-1)
+(spawn-bad-args) spawn "child-simple"
+(child-simple) run
+child-simple: exit(81)
+(spawn-bad-args) wait(spawn()) = 81
+(spawn-bad-args) end
+spawn-bad-args: exit(0)
+EOF
+pass;
@@ -0,0 +1,14 @@
+/* Passes spawn() an invalid pointer for its actions.  The
+   process must be terminated with -1 exit code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  msg ("spawn(\"child-simple\", 0x20101234): %d",
+       spawn ("child-simple", (struct spawn_action *) 0x20101234));
+  fail ("should have called exit(-1)");
+}
@@ -0,0 +1,37 @@
+/* Spawns a child with one descriptor closed and another copied
+   elsewhere with dup2, for the child to check.  Waiting on the
+   spawned pid must return the child's exit status, and the
+   parent's own descriptors must be as they were. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define COPY_FD 10
+
+void
+test_main (void)
+{
+  struct spawn_action actions[3];
+  char child_cmd[128];
+  int closed, kept;
+  pid_t pid;
+
+  CHECK ((closed = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((kept = open ("sample.txt")) > 1, "open \"sample.txt\" again");
+
+  actions[0] = (struct spawn_action) { SPAWN_CLOSE, closed, 0 };
+  actions[1] = (struct spawn_action) { SPAWN_DUP2, kept, COPY_FD };
+  actions[2] = (struct spawn_action) { SPAWN_END, 0, 0 };
+  snprintf (child_cmd, sizeof child_cmd, "child-spawn %d %d %d",
+            closed, kept, COPY_FD);
+
+  CHECK ((pid = spawn (child_cmd, actions)) > 0, "spawn \"child-spawn\"");
+  msg ("wait(spawn()) = %d", wait (pid));
+  CHECK (wait (pid) == -1, "wait again");
+
+  check_file_handle (closed, "sample.txt", sample, sizeof sample - 1);
+  CHECK (filesize (COPY_FD) == -1, "no fd %d in the parent", COPY_FD);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn-fds) begin
+(spawn-fds) open "sample.txt"
+(spawn-fds) open "sample.txt" again
+(spawn-fds) spawn "child-spawn"
+(child-spawn) read closed fd
+(child-spawn) verified contents of "sample.txt"
+(child-spawn) copy shares the file position
+child-spawn: exit(42)
+(spawn-fds) wait(spawn()) = 42
+(spawn-fds) wait again
+(spawn-fds) verified contents of "sample.txt"
+(spawn-fds) no fd 10 in the parent
+(spawn-fds) end
+spawn-fds: exit(0)
+EOF
+pass;
@@ -0,0 +1,19 @@
+/* Passes writev a vector with an invalid buffer pointer after a
+   valid one.  The process must be terminated with -1 exit code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  struct iovec iov[2] = {
+    { "valid", 5 }, { (char *) 0x10123420, 123 },
+  };
+  int handle;
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  writev (handle, iov, 2);
+  fail ("should have exited with -1");
+}
@@ -0,0 +1,70 @@
+/* Measures the cost of fork followed by wait, for a parent with
+   a small and with a large resident address space.  With
+   copy-on-write fork the two should cost about the same, since
+   the child shares the parent's pages rather than copying them.
+   Also measures fork followed at once by exec, which should cost
+   about the same too, since the child's page table is only filled
+   in as it touches pages, and exec throws it away first. */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define SMALL_PAGES 16
+#define LARGE_PAGES 1024
+#define FORKS 16
+
+static uint8_t buf[LARGE_PAGES * PAGE_SIZE];
+
+/* Makes the first PAGE_CNT pages of BUF resident, then returns
+   the average cycles taken by a fork of a child that exits at
+   once, or that execs a program that does if EXEC is true, and the
+   wait for it. */
+static uint64_t
+time_forks (size_t page_cnt, bool exec_child)
+{
+  uint64_t start;
+  size_t i;
+
+  for (i = 0; i < page_cnt; i++)
+    buf[i * PAGE_SIZE] = i;
+
+  start = rdtsc ();
+  for (i = 0; i < FORKS; i++)
+    {
+      pid_t pid = fork ("child");
+      if (pid == 0)
+        {
+          if (exec_child)
+            exec ("child-exit");
+          exit (0);
+        }
+      if (wait (pid) != 0)
+        fail ("child failed");
+    }
+  return (rdtsc () - start) / FORKS;
+}
+
+void
+test_main (void)
+{
+  uint64_t small = time_forks (SMALL_PAGES, false);
+  uint64_t large = time_forks (LARGE_PAGES, false);
+  uint64_t small_exec = time_forks (SMALL_PAGES, true);
+  uint64_t large_exec = time_forks (LARGE_PAGES, true);
+
+  msg ("fork+wait, %d resident pages: %llu cycles", SMALL_PAGES, small);
+  msg ("fork+wait, %d resident pages: %llu cycles", LARGE_PAGES, large);
+  msg ("large/small: %llu.%02llu", RATIO_INT (large, small),
+       RATIO_FRAC (large, small));
+  msg ("fork+exec+wait, %d resident pages: %llu cycles",
+       SMALL_PAGES, small_exec);
+  msg ("fork+exec+wait, %d resident pages: %llu cycles",
+       LARGE_PAGES, large_exec);
+  msg ("large/small: %llu.%02llu", RATIO_INT (large_exec, small_exec),
+       RATIO_FRAC (large_exec, small_exec));
+}
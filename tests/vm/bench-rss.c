@@ -0,0 +1,118 @@
+/* Measures how a process with a small working set fares next to a
+   memory hog, with and without a resident limit on the hog.  The
+   process touches its working set over and over while the hog
+   sweeps through more memory than the machine has.  Unlimited, the
+   hog evicts the working set again and again, and every pass over
+   it faults; limited, the hog pages against itself, so the working
+   set stays resident and the hog is the one slowed down. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define WS_PAGES 64
+#define HOG_PAGES 2048
+#define HOG_LIMIT 256
+#define HOG_SWEEPS 2
+#define PASSES 1024
+
+static uint8_t ws[WS_PAGES * PAGE_SIZE];
+static uint8_t hog[HOG_PAGES * PAGE_SIZE];
+
+/* Shared with the hog, which reports through it. */
+struct report
+  {
+    volatile int done;          /* Set when the hog is done. */
+    uint64_t cycles;            /* Cycles the hog took. */
+  };
+static struct report *const report = (struct report *) 0x10000000;
+
+/* Writes V to each of the PAGE_CNT pages at P. */
+static void
+touch (uint8_t *p, size_t page_cnt, int v)
+{
+  size_t i;
+
+  for (i = 0; i < page_cnt; i++)
+    p[i * PAGE_SIZE] = v;
+}
+
+/* Sweeps through HOG and exits. */
+static void
+run_hog (void)
+{
+  uint64_t start = rdtsc ();
+  int i;
+
+  for (i = 0; i < HOG_SWEEPS; i++)
+    touch (hog, HOG_PAGES, i);
+  report->cycles = rdtsc () - start;
+  report->done = 1;
+  exit (0);
+}
+
+/* Returns the average cycles per pass over the working set while
+   nothing else runs. */
+static uint64_t
+time_alone (void)
+{
+  uint64_t start = rdtsc ();
+  int i;
+
+  for (i = 0; i < PASSES; i++)
+    touch (ws, WS_PAGES, i);
+  return (rdtsc () - start) / PASSES;
+}
+
+/* Returns the average cycles per pass over the working set while a
+   hog limited to LIMIT resident pages, or unlimited if LIMIT is 0,
+   runs alongside. */
+static uint64_t
+time_with_hog (size_t limit)
+{
+  uint64_t start, elapsed;
+  size_t old;
+  pid_t pid;
+  int passes;
+
+  report->done = 0;
+  old = rsslimit (limit);
+  pid = fork ("hog");
+  if (pid == 0)
+    run_hog ();
+  rsslimit (old);
+
+  start = rdtsc ();
+  for (passes = 0; !report->done; passes++)
+    touch (ws, WS_PAGES, passes);
+  elapsed = rdtsc () - start;
+  wait (pid);
+  return passes > 0 ? elapsed / passes : elapsed;
+}
+
+void
+test_main (void)
+{
+  uint64_t alone, unlimited, limited, unlimited_hog, limited_hog;
+
+  CHECK (shmap (report, sizeof *report) == report, "shmap");
+  touch (ws, WS_PAGES, 0);
+
+  alone = time_alone ();
+  unlimited = time_with_hog (0);
+  unlimited_hog = report->cycles;
+  limited = time_with_hog (HOG_LIMIT);
+  limited_hog = report->cycles;
+
+  msg ("working set alone: %llu cycles/pass", alone);
+  msg ("working set, unlimited hog: %llu cycles/pass", unlimited);
+  msg ("working set, hog limited to %d pages: %llu cycles/pass",
+       HOG_LIMIT, limited);
+  msg ("unlimited/limited: %llu.%02llu", RATIO_INT (unlimited, limited),
+       RATIO_FRAC (unlimited, limited));
+  msg ("hog, unlimited: %llu cycles", unlimited_hog);
+  msg ("hog, limited: %llu cycles", limited_hog);
+}
@@ -0,0 +1,100 @@
+/* Measures passing a buffer from a child process to its parent
+   through anonymous shared memory, against passing it through a
+   file.  Each round forks a child that writes the buffer and exits;
+   the parent waits for it and then reads the buffer back.  Through
+   shared memory the parent reads the very frames the child wrote;
+   through a file the data is copied in by write() and out again by
+   read(). */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGES 32
+#define SIZE (PAGES * PAGE_SIZE)
+#define ROUNDS 8
+
+static uint8_t buf[SIZE];
+static uint8_t *const shared = (uint8_t *) 0x10000000;
+
+/* Checks that the SIZE bytes at P are all ROUND. */
+static void
+check (const uint8_t *p, int round)
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    if (p[i] != (uint8_t) round)
+      fail ("byte %zu is %d after round %d", i, p[i], round);
+}
+
+/* Returns the average cycles per round passing SIZE bytes through
+   the shared region. */
+static uint64_t
+time_shm (void)
+{
+  uint64_t start = rdtsc ();
+  int round;
+
+  for (round = 1; round <= ROUNDS; round++)
+    {
+      pid_t pid = fork ("child");
+      if (pid == 0)
+        {
+          memset (shared, round, SIZE);
+          exit (0);
+        }
+      wait (pid);
+      check (shared, round);
+    }
+  return (rdtsc () - start) / ROUNDS;
+}
+
+/* Returns the average cycles per round passing SIZE bytes through a
+   file. */
+static uint64_t
+time_file (void)
+{
+  uint64_t start = rdtsc ();
+  int round, fd;
+
+  for (round = 1; round <= ROUNDS; round++)
+    {
+      pid_t pid = fork ("child");
+      if (pid == 0)
+        {
+          memset (buf, round, SIZE);
+          fd = open ("data");
+          write (fd, buf, SIZE);
+          close (fd);
+          exit (0);
+        }
+      wait (pid);
+      fd = open ("data");
+      read (fd, buf, SIZE);
+      close (fd);
+      check (buf, round);
+    }
+  return (rdtsc () - start) / ROUNDS;
+}
+
+void
+test_main (void)
+{
+  uint64_t shm, file;
+
+  CHECK (shmap (shared, SIZE) == shared, "shmap \"%d bytes\"", SIZE);
+  CHECK (create ("data", SIZE), "create \"data\"");
+
+  shm = time_shm ();
+  file = time_file ();
+
+  msg ("shared memory, %d KB: %llu cycles", SIZE / 1024, shm);
+  msg ("file, %d KB: %llu cycles", SIZE / 1024, file);
+  msg ("file/shared memory: %llu.%02llu", RATIO_INT (file, shm),
+       RATIO_FRAC (file, shm));
+}
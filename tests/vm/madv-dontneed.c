@@ -0,0 +1,64 @@
+/* Drops pages with MADV_DONTNEED.  Written pages of an anonymous
+   region read back as zeros; a shared region keeps its contents
+   in the object behind it; and a file mapping's writes are
+   written back to the file first, so they read back from it. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define SIZE (4 * PAGE_SIZE)
+
+static uint8_t anon[SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+static uint8_t *const shared = (uint8_t *) 0x10000000;
+static char *const mapped = (char *) 0x20000000;
+static char buf[sizeof sample];
+
+/* Returns true if the SIZE bytes at P are all V. */
+static bool
+all (const uint8_t *p, uint8_t v)
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    if (p[i] != v)
+      return false;
+  return true;
+}
+
+void
+test_main (void)
+{
+  int handle;
+
+  memset (anon, 0xaa, SIZE);
+  CHECK (madvise (anon, SIZE, MADV_DONTNEED) == 0,
+         "madvise (anonymous, MADV_DONTNEED)");
+  CHECK (all (anon, 0), "anonymous pages read back as zeros");
+
+  CHECK (shmap (shared, SIZE) == shared, "shmap");
+  memset (shared, 's', SIZE);
+  CHECK (madvise (shared, SIZE, MADV_DONTNEED) == 0,
+         "madvise (shared, MADV_DONTNEED)");
+  CHECK (all (shared, 's'), "shared pages keep their contents");
+
+  CHECK (create ("dontneed.txt", strlen (sample)), "create \"dontneed.txt\"");
+  CHECK ((handle = open ("dontneed.txt")) > 1, "open \"dontneed.txt\"");
+  CHECK (mmap (mapped, strlen (sample), 1, handle, 0) != MAP_FAILED,
+         "mmap \"dontneed.txt\"");
+  memcpy (mapped, sample, strlen (sample));
+  CHECK (madvise (mapped, PAGE_SIZE, MADV_DONTNEED) == 0,
+         "madvise (file, MADV_DONTNEED)");
+  CHECK (!memcmp (mapped, sample, strlen (sample)),
+         "file pages read back what was written");
+  CHECK (read (handle, buf, strlen (sample)) == (int) strlen (sample)
+         && !memcmp (buf, sample, strlen (sample)),
+         "file holds what was written");
+
+  CHECK (madvise ((void *) 0x30000000, PAGE_SIZE, MADV_DONTNEED) == -1,
+         "madvise (unmapped, MADV_DONTNEED)");
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(madv-dontneed) begin
+(madv-dontneed) madvise (anonymous, MADV_DONTNEED)
+(madv-dontneed) anonymous pages read back as zeros
+(madv-dontneed) shmap
+(madv-dontneed) madvise (shared, MADV_DONTNEED)
+(madv-dontneed) shared pages keep their contents
+(madv-dontneed) create "dontneed.txt"
+(madv-dontneed) open "dontneed.txt"
+(madv-dontneed) mmap "dontneed.txt"
+(madv-dontneed) madvise (file, MADV_DONTNEED)
+(madv-dontneed) file pages read back what was written
+(madv-dontneed) file holds what was written
+(madv-dontneed) madvise (unmapped, MADV_DONTNEED)
+(madv-dontneed) end
+madv-dontneed: exit(0)
+EOF
+pass;
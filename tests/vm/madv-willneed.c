@@ -0,0 +1,52 @@
+/* Gives MADV_WILLNEED and the access pattern hints for a file
+   mapping and an anonymous region.  The hints must change
+   nothing that can be read.  A range that is not all mapped
+   must be refused. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define SIZE (4 * PAGE_SIZE)
+
+static uint8_t anon[SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+static char *const mapped = (char *) 0x10000000;
+
+void
+test_main (void)
+{
+  int handle;
+  size_t i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (mmap (mapped, PAGE_SIZE, 0, handle, 0) != MAP_FAILED,
+         "mmap \"sample.txt\"");
+  CHECK (madvise (mapped, PAGE_SIZE, MADV_WILLNEED) == 0,
+         "madvise (file, MADV_WILLNEED)");
+  CHECK (madvise (mapped, PAGE_SIZE, MADV_SEQUENTIAL) == 0,
+         "madvise (file, MADV_SEQUENTIAL)");
+  CHECK (!memcmp (mapped, sample, strlen (sample)), "file data intact");
+
+  for (i = 0; i < SIZE; i++)
+    anon[i] = i % 251;
+  CHECK (madvise (anon, SIZE, MADV_RANDOM) == 0,
+         "madvise (anonymous, MADV_RANDOM)");
+  CHECK (madvise (anon, SIZE, MADV_WILLNEED) == 0,
+         "madvise (anonymous, MADV_WILLNEED)");
+  for (i = 0; i < SIZE; i++)
+    if (anon[i] != i % 251)
+      fail ("byte %zu is %d after MADV_WILLNEED", i, anon[i]);
+  msg ("anonymous data intact");
+
+  CHECK (madvise (mapped, 2 * PAGE_SIZE, MADV_WILLNEED) == -1,
+         "madvise (past the mapping, MADV_WILLNEED)");
+  CHECK (madvise (mapped + 1, PAGE_SIZE, MADV_WILLNEED) == -1,
+         "madvise (misaligned, MADV_WILLNEED)");
+  CHECK (!memcmp (mapped, sample, strlen (sample)), "file data intact");
+  munmap (mapped);
+  close (handle);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(madv-willneed) begin
+(madv-willneed) open "sample.txt"
+(madv-willneed) mmap "sample.txt"
+(madv-willneed) madvise (file, MADV_WILLNEED)
+(madv-willneed) madvise (file, MADV_SEQUENTIAL)
+(madv-willneed) file data intact
+(madv-willneed) madvise (anonymous, MADV_RANDOM)
+(madv-willneed) madvise (anonymous, MADV_WILLNEED)
+(madv-willneed) anonymous data intact
+(madv-willneed) madvise (past the mapping, MADV_WILLNEED)
+(madv-willneed) madvise (misaligned, MADV_WILLNEED)
+(madv-willneed) file data intact
+(madv-willneed) end
+madv-willneed: exit(0)
+EOF
+pass;
@@ -0,0 +1,53 @@
+/* Writes to a file through a mapping and calls msync, then reads
+   the file back with read() while the mapping is still in place.
+   The data must be in the file already, without an unmap.  Syncing
+   part of the mapping writes that part; a range that is not
+   mapped, or not page-aligned, is refused. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGES 3
+#define SIZE (PAGES * PAGE_SIZE)
+
+static char *const mapped = (char *) 0x10000000;
+static char expected[SIZE];
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  int handle, reader;
+
+  CHECK (create ("msync.txt", SIZE), "create \"msync.txt\"");
+  CHECK ((handle = open ("msync.txt")) > 1, "open \"msync.txt\"");
+  CHECK (mmap (mapped, SIZE, 1, handle, 0) != MAP_FAILED,
+         "mmap \"msync.txt\"");
+
+  /* Two adjacent pages written, the third left alone. */
+  memset (expected, 'a', PAGE_SIZE);
+  memset (expected + PAGE_SIZE, 'b', PAGE_SIZE);
+  memcpy (mapped, expected, 2 * PAGE_SIZE);
+  CHECK (msync (mapped, SIZE) == 0, "msync whole mapping");
+  CHECK ((reader = open ("msync.txt")) > 1, "open \"msync.txt\" again");
+  CHECK (read (reader, buf, SIZE) == SIZE && !memcmp (buf, expected, SIZE),
+         "read back first two pages");
+
+  /* Then just the last page. */
+  memset (expected + 2 * PAGE_SIZE, 'c', PAGE_SIZE);
+  memset (mapped + 2 * PAGE_SIZE, 'c', PAGE_SIZE);
+  CHECK (msync (mapped + 2 * PAGE_SIZE, PAGE_SIZE) == 0, "msync last page");
+  seek (reader, 0);
+  CHECK (read (reader, buf, SIZE) == SIZE && !memcmp (buf, expected, SIZE),
+         "read back all three pages");
+
+  CHECK (msync (mapped + 1, PAGE_SIZE) == -1, "msync misaligned");
+  CHECK (msync (mapped, SIZE + PAGE_SIZE) == -1, "msync past the mapping");
+
+  munmap (mapped);
+  close (reader);
+  close (handle);
+}
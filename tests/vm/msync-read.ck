@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(msync-read) begin
+(msync-read) create "msync.txt"
+(msync-read) open "msync.txt"
+(msync-read) mmap "msync.txt"
+(msync-read) msync whole mapping
+(msync-read) open "msync.txt" again
+(msync-read) read back first two pages
+(msync-read) msync last page
+(msync-read) read back all three pages
+(msync-read) msync misaligned
+(msync-read) msync past the mapping
+(msync-read) end
+msync-read: exit(0)
+EOF
+pass;
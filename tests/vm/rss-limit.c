@@ -0,0 +1,73 @@
+/* Limits the process to LIMIT resident pages and then works
+   through several times as many, so that it keeps evicting its
+   own pages.  The data must come out right all the same, no more
+   than LIMIT of its pages may be resident at a time, and a forked
+   child, whose pages start out shared with its parent, must be
+   held to the inherited limit too. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGES 256
+#define SIZE (PAGES * PAGE_SIZE)
+#define LIMIT 64
+
+static uint8_t data[SIZE];
+
+/* Returns true if every byte of DATA is as written, plus DELTA. */
+static bool
+data_ok (int delta)
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    if (data[i] != (uint8_t) (i % 251 + delta))
+      return false;
+  return true;
+}
+
+/* Returns the number of pages of DATA that are resident. */
+static size_t
+resident_cnt (void)
+{
+  size_t cnt = 0;
+  size_t i;
+
+  for (i = 0; i < PAGES; i++)
+    if (get_phys_addr (&data[i * PAGE_SIZE]) != NULL)
+      cnt++;
+  return cnt;
+}
+
+void
+test_main (void)
+{
+  size_t i, j;
+  pid_t pid;
+  int status;
+
+  CHECK (rsslimit (LIMIT) == 0, "rsslimit (%d)", LIMIT);
+
+  for (i = 0; i < SIZE; i++)
+    data[i] = i % 251;
+  msg ("write %d pages", PAGES);
+  for (i = PAGES; i-- > 0; )
+    for (j = 0; j < PAGE_SIZE; j++)
+      data[i * PAGE_SIZE + j]++;
+  msg ("update them in reverse");
+  CHECK (data_ok (1), "data intact");
+  CHECK (resident_cnt () <= LIMIT, "at most %d pages resident", LIMIT);
+
+  pid = fork ("child");
+  if (pid == 0)
+    exit (rsslimit (LIMIT) == LIMIT && data_ok (1)
+          && resident_cnt () <= LIMIT ? 81 : 1);
+  status = wait (pid);
+  CHECK (status == 81, "child inherits limit, sees data, stays within it");
+
+  CHECK (rsslimit (0) == LIMIT, "rsslimit (0)");
+  CHECK (data_ok (1), "data intact");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rss-limit) begin
+(rss-limit) rsslimit (64)
+(rss-limit) write 256 pages
+(rss-limit) update them in reverse
+(rss-limit) data intact
+(rss-limit) at most 64 pages resident
+child: exit(81)
+(rss-limit) child inherits limit, sees data, stays within it
+(rss-limit) rsslimit (0)
+(rss-limit) data intact
+(rss-limit) end
+rss-limit: exit(0)
+EOF
+pass;
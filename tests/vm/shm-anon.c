@@ -0,0 +1,52 @@
+/* Shares an anonymous region with forked children.  What a child
+   writes must be there for the parent once the child exits, and
+   what the parent writes must be there for the next child. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define SIZE (4 * PAGE_SIZE)
+
+static uint8_t *const shared = (uint8_t *) 0x10000000;
+
+/* Returns true if the SIZE bytes at P are all V. */
+static bool
+all (const uint8_t *p, uint8_t v)
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    if (p[i] != v)
+      return false;
+  return true;
+}
+
+void
+test_main (void)
+{
+  pid_t pid;
+  int status;
+
+  CHECK (shmap (shared, SIZE) == shared, "shmap");
+
+  pid = fork ("child");
+  if (pid == 0)
+    {
+      memset (shared, 'c', SIZE);
+      exit (0);
+    }
+  status = wait (pid);
+  CHECK (status == 0, "wait for child to write");
+  CHECK (all (shared, 'c'), "parent sees child's writes");
+
+  memset (shared, 'p', SIZE);
+  pid = fork ("child");
+  if (pid == 0)
+    exit (all (shared, 'p') ? 81 : 1);
+  status = wait (pid);
+  CHECK (status == 81, "child sees parent's writes");
+}
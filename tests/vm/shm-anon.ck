@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(shm-anon) begin
+(shm-anon) shmap
+child: exit(0)
+(shm-anon) wait for child to write
+(shm-anon) parent sees child's writes
+child: exit(81)
+(shm-anon) child sees parent's writes
+(shm-anon) end
+shm-anon: exit(0)
+EOF
+pass;
@@ -0,0 +1,56 @@
+/* Maps a file shared in two processes, each through a mapping of
+   its own.  Both views are of the one page set kept for the file,
+   so what the child writes through its mapping is there in the
+   parent's, and reaches the file once both are unmapped. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PARENT_MAP ((char *) 0x10000000)
+#define CHILD_MAP ((char *) 0x20000000)
+
+static char buf[sizeof sample];
+
+static void
+run_child (void)
+{
+  int handle = open ("shared.txt");
+
+  if (handle < 2)
+    fail ("child: open \"shared.txt\"");
+  if (mmap (CHILD_MAP, strlen (sample), 1 | MAP_SHARED, handle, 0)
+      == MAP_FAILED)
+    fail ("child: mmap \"shared.txt\"");
+  memcpy (CHILD_MAP, sample, strlen (sample));
+  munmap (CHILD_MAP);
+  exit (0);
+}
+
+void
+test_main (void)
+{
+  int handle, status;
+  pid_t pid;
+
+  CHECK (create ("shared.txt", strlen (sample)), "create \"shared.txt\"");
+  CHECK ((handle = open ("shared.txt")) > 1, "open \"shared.txt\"");
+  CHECK (mmap (PARENT_MAP, strlen (sample), 1 | MAP_SHARED, handle, 0)
+         != MAP_FAILED, "mmap \"shared.txt\" shared");
+
+  pid = fork ("child");
+  if (pid == 0)
+    run_child ();
+  status = wait (pid);
+  CHECK (status == 0, "wait for child to write");
+  CHECK (!memcmp (PARENT_MAP, sample, strlen (sample)),
+         "parent's mapping sees child's writes");
+
+  munmap (PARENT_MAP);
+  CHECK (read (handle, buf, strlen (sample)) == (int) strlen (sample)
+         && !memcmp (buf, sample, strlen (sample)),
+         "file holds child's writes");
+  close (handle);
+}
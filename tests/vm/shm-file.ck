@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(shm-file) begin
+(shm-file) create "shared.txt"
+(shm-file) open "shared.txt"
+(shm-file) mmap "shared.txt" shared
+child: exit(0)
+(shm-file) wait for child to write
+(shm-file) parent's mapping sees child's writes
+(shm-file) file holds child's writes
+(shm-file) end
+shm-file: exit(0)
+EOF
+pass;
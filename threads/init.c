@@ -23,6 +23,7 @@
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
+#include "userprog/ring.h"
 #include "userprog/exception.h"
 #include "userprog/gdt.h"
 #include "userprog/syscall.h"
@@ -31,6 +32,11 @@
 #include "tests/threads/tests.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/faultstat.h"
+#include "vm/flusher.h"
+#include "vm/ksm.h"
+#include "vm/kswapd.h"
+#include "vm/zswap.h"
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
@@ -100,6 +106,7 @@ main (void) {
 #ifdef USERPROG
 	exception_init ();
 	syscall_init ();
+	elf_cache_init ();
 #endif
 	/* Start thread scheduler and enable interrupts. */
 	thread_start ();
@@ -111,6 +118,9 @@ main (void) {
 	disk_init ();
 	filesys_init (format_filesys);
 #endif
+#ifdef USERPROG
+	ring_init ();
+#endif
 
 #ifdef VM
 	vm_init ();
@@ -152,19 +162,34 @@ paging_init (uint64_t mem_end) {
 	extern char start, _end_kernel_text;
 	// Maps physical address [0 ~ mem_end] to
 	//   [LOADER_KERN_BASE ~ LOADER_KERN_BASE + mem_end].
-	for (uint64_t pa = 0; pa < mem_end; pa += PGSIZE) {
+	// Whole 2 MB runs are mapped with single large-page PDEs, which
+	// saves page-table pages and TLB entries.  The run holding the
+	// kernel text and a partial run at the end of memory fall back
+	// to 4 kB pages, so that the text can stay read-only.
+	for (uint64_t pa = 0; pa < mem_end; ) {
 		uint64_t va = (uint64_t) ptov(pa);
 
 		perm = PTE_P | PTE_W;
+		if ((pa & LPGMASK) == 0 && pa + LPGSIZE <= mem_end
+				&& (va + LPGSIZE <= (uint64_t) &start
+					|| va >= (uint64_t) &_end_kernel_text)) {
+			if ((pte = pml4e_walk_pde (pml4, va, 1)) != NULL)
+				*pte = pa | perm | PTE_PS;
+			pa += LPGSIZE;
+			continue;
+		}
+
 		if ((uint64_t) &start <= va && va < (uint64_t) &_end_kernel_text)
 			perm &= ~PTE_W;
 
 		if ((pte = pml4e_walk (pml4, va, 1)) != NULL)
 			*pte = pa | perm;
+		pa += PGSIZE;
 	}
 
 	// reload cr3
 	pml4_activate(0);
+	pml4_pcid_init ();
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -226,6 +251,26 @@ parse_options (char **argv) {
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+		else if (!strcmp (name, "-lp"))
+			user_large_pages = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-evict")) {
+			if (value == NULL || !vm_select_policy (value))
+				PANIC ("unknown eviction policy `%s' (use -h for help)", value);
+		}
+		else if (!strcmp (name, "-fault-around"))
+			vm_set_fault_around (value != NULL ? atoi (value) : 16);
+		else if (!strcmp (name, "-fault-stats"))
+			faultstat_enable ();
+		else if (!strcmp (name, "-flusher"))
+			flusher_enable (value != NULL ? atoi (value) : FLUSHER_DEFAULT_MS);
+		else if (!strcmp (name, "-ksm"))
+			ksm_enable (value != NULL ? atoi (value) : KSM_DEFAULT_PAGES);
+		else if (!strcmp (name, "-kswapd"))
+			kswapd_enable (value != NULL ? atoi (value) : KSWAPD_DEFAULT_LOW);
+		else if (!strcmp (name, "-zswap"))
+			zswap_enable (value != NULL ? atoi (value) : ZSWAP_DEFAULT_PAGES);
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -328,6 +373,23 @@ usage (void) {
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+			"  -lp                Map large user regions with 2 MB pages.\n"
+#endif
+#ifdef VM
+			"  -evict=POLICY      Evict pages by POLICY: clock (default),\n"
+			"                     wsclock or 2q.\n"
+			"  -fault-around[=N]  Map up to N pages (default 16) after a fault\n"
+			"                     in a file or executable.\n"
+			"  -fault-stats       Print fault counts and latencies by kind,\n"
+			"                     per process on exit and overall at shutdown.\n"
+			"  -flusher[=MS]      Write back modified pages of file mappings\n"
+			"                     every MS milliseconds (default 1000).\n"
+			"  -ksm[=PAGES]       Merge identical anonymous pages, scanning\n"
+			"                     PAGES frames (default 64) every 100 ms.\n"
+			"  -kswapd[=LOW]      Page out in the background to keep LOW to\n"
+			"                     2*LOW frames (default 32) free.\n"
+			"  -zswap[=PAGES]     Compress pages bound for swap into up to\n"
+			"                     PAGES kernel pages (default 256) first.\n"
 #endif
 			);
 	power_off ();
@@ -362,4 +424,7 @@ print_stats (void) {
 #ifdef USERPROG
 	exception_print_stats ();
 #endif
+#ifdef VM
+	vm_print_stats ();
+#endif
 }
@@ -208,7 +208,7 @@ free (void *p) {
 		if (d != NULL) {
 			/* It's a normal block.  We handle it here. */
 
-#ifndef NDEBUG
+#if ASSERT_LEVEL >= 1
 			/* Clear the block to help detect use-after-free bugs. */
 			memset (b, 0xcc, d->block_size);
 #endif
@@ -2,6 +2,7 @@
 #include <stddef.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
@@ -13,6 +14,11 @@ pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 	int idx = PDX (va);
 	if (pdp) {
 		uint64_t *pte = (uint64_t *) pdp[idx];
+		/* A 2 MB mapping has no page table below it; the PDE is
+		 * the leaf.  It cannot be split to make room for a new
+		 * 4 kB mapping. */
+		if (is_large_pte (&pdp[idx]))
+			return create ? NULL : &pdp[idx];
 		if (!((uint64_t) pte & PTE_P)) {
 			if (create) {
 				uint64_t *new_page = palloc_get_page (PAL_ZERO);
@@ -88,6 +94,143 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 	return pte;
 }
 
+/* Returns the address of the page directory entry for virtual
+ * address VA in PML4, that is, the entry that maps VA with a 2 MB
+ * large page.  Missing page-directory-pointer and page-directory
+ * tables are created if CREATE is true; otherwise a null pointer
+ * is returned for them. */
+uint64_t *
+pml4e_walk_pde (uint64_t *pml4, const uint64_t va, int create) {
+	uint64_t *table = pml4;
+	const int idx[2] = { PML4 (va), PDPE (va) };
+
+	for (int level = 0; level < 2; level++) {
+		uint64_t *entry = &table[idx[level]];
+		if (!(*entry & PTE_P)) {
+			uint64_t *new_page;
+			if (!create || (new_page = palloc_get_page (PAL_ZERO)) == NULL)
+				return NULL;
+			*entry = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+		}
+		table = ptov (PTE_ADDR (*entry));
+	}
+	return &table[PDX (va)];
+}
+
+/* Process-context identifiers (PCIDs).
+ *
+ * With CR4.PCIDE set, the CPU tags every TLB entry with the 12-bit
+ * PCID held in the low bits of CR3, and a CR3 load with bit 63 set
+ * keeps the TLB entries of all PCIDs.  Each pml4 gets its own PCID,
+ * so switching between processes no longer throws away their
+ * translations.
+ *
+ * The PCID of a pml4 lives in its last entry, which is never
+ * present (user and kernel space both sit below PML4 index 2), so
+ * the CPU ignores its contents.  base_pml4 uses PCID 0.  PCID 0 is
+ * also handed out when the PCIDs run out; loading a pml4 with PCID
+ * 0 always flushes its entries, so such pml4s stay correct.
+ *
+ * pcid_stale[] marks PCIDs whose TLB entries may be out of date:
+ * recycled PCIDs, and PCIDs of inactive pml4s whose mappings
+ * changed when INVPCID is unavailable.  The next activation of a
+ * stale PCID flushes it. */
+#define PCID_CNT 4096
+#define PCID_SLOT 511                   /* PML4 entry holding the PCID. */
+#define PCID_SHIFT 12                   /* PCID position in that entry. */
+#define CR3_NOFLUSH (1ULL << 63)        /* Keep this PCID's TLB entries. */
+#define CR4_PCIDE (1 << 17)             /* PCID enable. */
+#define CPUID_1_ECX_PCID (1 << 17)      /* CPU supports PCIDs. */
+#define CPUID_7_EBX_INVPCID (1 << 10)   /* CPU supports INVPCID. */
+#define INVPCID_ADDR 0                  /* INVPCID: single address. */
+
+static bool pcid_enabled;               /* CR4.PCIDE is set. */
+static bool invpcid_enabled;            /* INVPCID is usable. */
+static bool pcid_used[PCID_CNT];        /* PCIDs owned by live pml4s. */
+static bool pcid_stale[PCID_CNT];       /* Flush on next activation. */
+static unsigned pcid_next = 1;          /* Next-fit allocation cursor. */
+
+/* Turns on PCIDs if the CPU supports them.  Must be called while
+ * base_pml4 is loaded with PCID 0. */
+void
+pml4_pcid_init (void) {
+	uint32_t eax, ebx, ecx, edx;
+
+	cpuid (1, 0, &eax, &ebx, &ecx, &edx);
+	if (!(ecx & CPUID_1_ECX_PCID))
+		return;
+	ASSERT ((rcr3 () & PGMASK) == 0);
+	lcr4 (rcr4 () | CR4_PCIDE);
+	pcid_enabled = true;
+	pcid_used[0] = true;
+
+	cpuid (0, 0, &eax, &ebx, &ecx, &edx);
+	if (eax >= 7) {
+		cpuid (7, 0, &eax, &ebx, &ecx, &edx);
+		invpcid_enabled = (ebx & CPUID_7_EBX_INVPCID) != 0;
+	}
+}
+
+/* Returns the PCID of PML4. */
+static unsigned
+pml4_pcid (uint64_t *pml4) {
+	return pml4 == base_pml4 ? 0 : pml4[PCID_SLOT] >> PCID_SHIFT;
+}
+
+/* Gives PML4 a PCID of its own, or PCID 0 if none is free. */
+static void
+pcid_alloc (uint64_t *pml4) {
+	unsigned pcid = 0;
+
+	if (pcid_enabled) {
+		enum intr_level old_level = intr_disable ();
+		for (unsigned i = 0; i < PCID_CNT - 1; i++) {
+			unsigned candidate = pcid_next;
+			pcid_next = pcid_next + 1 < PCID_CNT ? pcid_next + 1 : 1;
+			if (!pcid_used[candidate]) {
+				pcid_used[candidate] = true;
+				pcid = candidate;
+				break;
+			}
+		}
+		intr_set_level (old_level);
+	}
+	pml4[PCID_SLOT] = (uint64_t) pcid << PCID_SHIFT;
+}
+
+/* Releases PML4's PCID.  Its TLB entries may outlive PML4, so the
+ * PCID is flushed when it is next used. */
+static void
+pcid_free (uint64_t *pml4) {
+	unsigned pcid = pml4_pcid (pml4);
+	if (pcid != 0) {
+		pcid_stale[pcid] = true;
+		pcid_used[pcid] = false;
+	}
+}
+
+/* Returns true if PML4 is the page table the CPU is using now.
+ * This is not always the running thread's: kernel threads keep
+ * the last user page table loaded. */
+static bool
+pml4_is_active (uint64_t *pml4) {
+	return PTE_ADDR (rcr3 ()) == vtop (pml4);
+}
+
+/* Drops any TLB entry for VA in PML4 after its mapping changed. */
+static void
+pml4_invalidate (uint64_t *pml4, const void *va) {
+	if (pml4_is_active (pml4))
+		invlpg ((uint64_t) va);
+	else if (pcid_enabled) {
+		unsigned pcid = pml4_pcid (pml4);
+		if (invpcid_enabled && pcid != 0)
+			invpcid (INVPCID_ADDR, pcid, (uint64_t) va);
+		else
+			pcid_stale[pcid] = true;
+	}
+}
+
 /* Creates a new page map level 4 (pml4) has mappings for kernel
  * virtual addresses, but none for user virtual addresses.
  * Returns the new page directory, or a null pointer if memory
@@ -95,8 +238,10 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 uint64_t *
 pml4_create (void) {
 	uint64_t *pml4 = palloc_get_page (0);
-	if (pml4)
+	if (pml4) {
 		memcpy (pml4, base_pml4, PGSIZE);
+		pcid_alloc (pml4);
+	}
 	return pml4;
 }
 
@@ -122,7 +267,14 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if (is_large_pte (&pdp[i])) {
+			/* FUNC sees the PDE itself for a 2 MB page. */
+			void *va = (void *) (((uint64_t) pml4_index << PML4SHIFT) |
+								 ((uint64_t) pdp_index << PDPESHIFT) |
+								 ((uint64_t) i << PDXSHIFT));
+			if (!func (&pdp[i], va, aux))
+				return false;
+		} else if (((uint64_t) pte) & PTE_P)
 			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
 					pml4_index, pdp_index, i))
 				return false;
@@ -169,7 +321,9 @@ static void
 pgdir_destroy (uint64_t *pdp) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if (is_large_pte (&pdp[i]))
+			palloc_free_large_page (ptov (PTE_ADDR (pdp[i])));
+		else if (((uint64_t) pte) & PTE_P)
 			pt_destroy (PTE_ADDR (pte));
 	}
 	palloc_free_page ((void *) pdp);
@@ -196,14 +350,30 @@ pml4_destroy (uint64_t *pml4) {
 	uint64_t *pdpe = ptov ((uint64_t *) pml4[0]);
 	if (((uint64_t) pdpe) & PTE_P)
 		pdpe_destroy ((void *) PTE_ADDR (pdpe));
+	pcid_free (pml4);
 	palloc_free_page ((void *) pml4);
 }
 
 /* Loads page directory PD into the CPU's page directory base
- * register. */
+ * register.  With PCIDs, the TLB entries of PD survive unless its
+ * PCID is stale or 0. */
 void
 pml4_activate (uint64_t *pml4) {
-	lcr3 (vtop (pml4 ? pml4 : base_pml4));  // PDBR(register)에 바로 activate
+	if (pml4 == NULL)
+		pml4 = base_pml4;
+
+	uint64_t cr3 = vtop (pml4);  // PDBR(register)에 바로 activate
+	if (pcid_enabled) {
+		enum intr_level old_level = intr_disable ();
+		unsigned pcid = pml4_pcid (pml4);
+		cr3 |= pcid;
+		if (pcid != 0 && !pcid_stale[pcid])
+			cr3 |= CR3_NOFLUSH;
+		pcid_stale[pcid] = false;
+		lcr3 (cr3);
+		intr_set_level (old_level);
+	} else
+		lcr3 (cr3);
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -216,6 +386,8 @@ pml4_get_page (uint64_t *pml4, const void *uaddr) {
 
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) uaddr, 0);
 
+	if (pte && is_large_pte (pte))
+		return ptov (PTE_ADDR (*pte)) + ((uint64_t) uaddr & LPGMASK);
 	if (pte && (*pte & PTE_P))
 		return ptov (PTE_ADDR (*pte)) + pg_ofs (uaddr);
 	return NULL;
@@ -243,10 +415,32 @@ pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 	return pte != NULL;
 }
 
+/* Adds a 2 MB mapping in PML4 from user virtual address UPAGE to
+ * the physical large page at kernel virtual address KPAGE, which
+ * should come from palloc_get_large_page().  Both addresses must
+ * be 2 MB aligned and nothing in the 2 MB range at UPAGE may be
+ * mapped yet.  Returns true if successful, false if memory
+ * allocation failed or the range already has 4 kB mappings. */
+bool
+pml4_set_large_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
+	ASSERT (((uint64_t) upage & LPGMASK) == 0);
+	ASSERT (((uint64_t) kpage & LPGMASK) == 0);
+	ASSERT (is_user_vaddr (upage));
+	ASSERT (pml4 != base_pml4);
+
+	uint64_t *pde = pml4e_walk_pde (pml4, (uint64_t) upage, 1);
+
+	if (pde == NULL || (*pde & PTE_P))
+		return false;
+	*pde = vtop (kpage) | PTE_PS | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+	return true;
+}
+
 /* Marks user virtual page UPAGE "not present" in page
  * directory PD.  Later accesses to the page will fault.  Other
  * bits in the page table entry are preserved.
- * UPAGE need not be mapped. */
+ * UPAGE need not be mapped.  If UPAGE lies in a 2 MB mapping, the
+ * whole large page becomes not present. */
 void
 pml4_clear_page (uint64_t *pml4, void *upage) {
 	uint64_t *pte;
@@ -257,8 +451,7 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
 
 	if (pte != NULL && (*pte & PTE_P) != 0) {
 		*pte &= ~PTE_P;
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) upage);
+		pml4_invalidate (pml4, upage);
 	}
 }
 
@@ -283,8 +476,7 @@ pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
 		else
 			*pte &= ~(uint32_t) PTE_D;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		pml4_invalidate (pml4, vpage);
 	}
 }
 
@@ -309,7 +501,21 @@ pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 		else
 			*pte &= ~(uint32_t) PTE_A;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		pml4_invalidate (pml4, vpage);
+	}
+}
+
+/* Makes the PTE for virtual page VPAGE in PML4 writable or
+ * read-only according to WRITABLE, keeping its other bits. */
+void
+pml4_set_writable (uint64_t *pml4, const void *vpage, bool writable) {
+	uint64_t *pte = pml4e_walk (pml4, (uint64_t) vpage, false);
+	if (pte) {
+		if (writable)
+			*pte |= PTE_W;
+		else
+			*pte &= ~(uint64_t) PTE_W;
+
+		pml4_invalidate (pml4, vpage);
 	}
 }
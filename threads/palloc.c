@@ -8,7 +8,9 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
+#include "threads/pte.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
@@ -31,6 +33,7 @@ struct pool {
 	struct lock lock;               /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
 	uint8_t *base;                  /* Base of pool. */
+	size_t free_cnt;                /* Number of free pages. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -42,6 +45,7 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static void pool_count_free (struct pool *, long delta);
 
 /* multiboot info */
 struct multiboot_info {
@@ -232,6 +236,11 @@ split:
 			}
 		}
 	}
+
+	kernel_pool.free_cnt = bitmap_count (kernel_pool.used_map, 0,
+			bitmap_size (kernel_pool.used_map), false);
+	user_pool.free_cnt = bitmap_count (user_pool.used_map, 0,
+			bitmap_size (user_pool.used_map), false);
 }
 
 /* Initializes the page allocator and get the memory size */
@@ -265,6 +274,8 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 
 	lock_acquire (&pool->lock);
 	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+	if (page_idx != BITMAP_ERROR)
+		pool_count_free (pool, -(long) page_cnt);
 	lock_release (&pool->lock);
 	void *pages;
 
@@ -275,7 +286,8 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 
 	if (pages) {
 		if (flags & PAL_ZERO)
-			memset (pages, 0, PGSIZE * page_cnt);
+			for (size_t i = 0; i < page_cnt; i++)
+				clear_page (pages + PGSIZE * i);
 	} else {
 		if (flags & PAL_ASSERT)
 			PANIC ("palloc_get: out of pages");
@@ -296,6 +308,92 @@ palloc_get_page (enum palloc_flags flags) {
 	return palloc_get_multiple (flags, 1);
 }
 
+/* Obtains a 2 MB "large page": LPG_PAGES contiguous free pages
+   whose physical address is 2 MB aligned, so that the run can be
+   mapped by a single page directory entry.  FLAGS are interpreted
+   as for palloc_get_multiple().  Returns the kernel virtual
+   address of the first page, or a null pointer if the pool has no
+   suitably aligned free run. */
+void *
+palloc_get_large_page (enum palloc_flags flags) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	size_t page_cnt = bitmap_size (pool->used_map);
+	uint64_t aligned = ((uint64_t) pool->base + LPGMASK) & ~LPGMASK;
+	size_t first = pg_no (aligned) - pg_no (pool->base);
+	void *pages = NULL;
+
+	lock_acquire (&pool->lock);
+	for (size_t idx = first; idx + LPG_PAGES <= page_cnt; idx += LPG_PAGES)
+		if (bitmap_none (pool->used_map, idx, LPG_PAGES)) {
+			bitmap_set_multiple (pool->used_map, idx, LPG_PAGES, true);
+			pool_count_free (pool, -LPG_PAGES);
+			pages = pool->base + PGSIZE * idx;
+			break;
+		}
+	lock_release (&pool->lock);
+
+	if (pages) {
+		if (flags & PAL_ZERO)
+			for (size_t i = 0; i < LPG_PAGES; i++)
+				clear_page (pages + PGSIZE * i);
+	} else {
+		if (flags & PAL_ASSERT)
+			PANIC ("palloc_get_large_page: out of aligned pages");
+	}
+	return pages;
+}
+
+/* Frees a large page obtained from palloc_get_large_page(). */
+void
+palloc_free_large_page (void *pages) {
+	ASSERT (((uint64_t) pages & LPGMASK) == 0);
+	palloc_free_multiple (pages, LPG_PAGES);
+}
+
+/* Returns the number of pages in the user pool. */
+size_t
+palloc_user_page_cnt (void) {
+	return bitmap_size (user_pool.used_map);
+}
+
+/* Returns the number of free pages in the user pool.  Another
+   thread may change it at any moment, so it is only a hint. */
+size_t
+palloc_user_free_cnt (void) {
+	return user_pool.free_cnt;
+}
+
+/* Returns the index of KPAGE, a page from the user pool, within
+   the pool.  Indexes run from 0 to palloc_user_page_cnt() - 1. */
+size_t
+palloc_user_page_no (const void *kpage) {
+	ASSERT (page_from_pool (&user_pool, (void *) kpage));
+	return pg_no (kpage) - pg_no (user_pool.base);
+}
+
+/* Fills the page at KPAGE with zeros.  KPAGE must be page
+   aligned, so the whole page is a single `rep stosq'. */
+void
+clear_page (void *kpage) {
+	size_t cnt = PGSIZE / sizeof (uint64_t);
+
+	ASSERT (pg_ofs (kpage) == 0);
+	__asm __volatile ("rep stosq"
+			: "+D" (kpage), "+c" (cnt) : "a" ((uint64_t) 0) : "memory");
+}
+
+/* Copies the page at SRC to the page at DST.  Both must be page
+   aligned and must not overlap. */
+void
+copy_page (void *dst, const void *src) {
+	size_t cnt = PGSIZE / sizeof (uint64_t);
+
+	ASSERT (pg_ofs (dst) == 0);
+	ASSERT (pg_ofs (src) == 0);
+	__asm __volatile ("rep movsq"
+			: "+D" (dst), "+S" (src), "+c" (cnt) : : "memory");
+}
+
 /* Frees the PAGE_CNT pages starting at PAGES. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) {
@@ -315,11 +413,12 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 
 	page_idx = pg_no (pages) - pg_no (pool->base);
 
-#ifndef NDEBUG
+#if ASSERT_LEVEL >= 1
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
 	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	pool_count_free (pool, page_cnt);
 }
 
 /* Frees the page at PAGE. */
@@ -347,6 +446,17 @@ init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
 	*bm_base += bm_pages;
 }
 
+/* Adds DELTA to POOL's count of free pages.  Pages are freed
+   without taking the pool's lock, so the update is made atomic by
+   turning interrupts off instead. */
+static void
+pool_count_free (struct pool *pool, long delta) {
+	enum intr_level old_level = intr_disable ();
+
+	pool->free_cnt += delta;
+	intr_set_level (old_level);
+}
+
 /* Returns true if PAGE was allocated from POOL,
    false otherwise. */
 static bool
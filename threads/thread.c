@@ -297,9 +297,10 @@ thread_current(void)
 	   If either of these assertions fire, then your thread may
 	   have overflowed its stack.  Each thread has less than 4 kB
 	   of stack, so a few big automatic arrays or moderate
-	   recursion can cause stack overflow. */
-	ASSERT(is_thread(t));
-	ASSERT(t->status == THREAD_RUNNING);
+	   recursion can cause stack overflow.  These run on every
+	   thread_current() call, so release builds skip them. */
+	DEBUG_ASSERT(is_thread(t));
+	DEBUG_ASSERT(t->status == THREAD_RUNNING);
 
 	return t;
 }
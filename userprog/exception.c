@@ -2,8 +2,10 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/uaccess.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
 #include "intrinsic.h"
 
 /* Number of page faults processed. */
@@ -146,6 +148,11 @@ page_fault (struct intr_frame *f) {
 		return;
 #endif
 
+	/* A kernel access to user memory through the uaccess
+	   primitives fails softly. */
+	if (!user && is_user_vaddr (fault_addr) && uaccess_fixup (f))
+		return;
+
 	/* Count page faults. */
 	page_fault_cnt++;
 
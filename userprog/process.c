@@ -6,13 +6,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include "userprog/gdt.h"
+#include "userprog/ring.h"
+#include "userprog/syscall.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
@@ -22,10 +26,14 @@
 #include "vm/vm.h"
 #endif
 
+/* Map large user regions with 2 MB pages (kernel option -lp). */
+bool user_large_pages;
+
 static void process_cleanup (void);
 static bool load (const char *file_name, struct intr_frame *if_);
 static void initd (void *f_name);
 static void __do_fork (void *);
+static void __do_spawn (void *);
 
 
 /* General process initializer for initd and other process. */
@@ -111,6 +119,20 @@ duplicate_pte (uint64_t *pte, void *va, void *aux)
 	/* 2. Resolve VA from the parent's page map level 4. */
 	parent_page = pml4_get_page (parent->pml4, va);
 	if(parent_page==NULL){return false;}
+
+	/* A 2 MB mapping is duplicated as a whole. */
+	if (is_large_pte (pte)) {
+		newpage = palloc_get_large_page (PAL_USER);
+		if (newpage == NULL)
+			return false;
+		for (size_t i = 0; i < LPG_PAGES; i++)
+			copy_page (newpage + i * PGSIZE, parent_page + i * PGSIZE);
+		if (!pml4_set_large_page (current->pml4, va, newpage, is_writable (pte))) {
+			palloc_free_large_page (newpage);
+			return false;
+		}
+		return true;
+	}
 	/* 3. TODO: Allocate new PAL_USER page for the child and set result to
 	 *    TODO: NEWPAGE. */
 	newpage = palloc_get_page(PAL_USER);
@@ -122,7 +144,7 @@ duplicate_pte (uint64_t *pte, void *va, void *aux)
 	/* 4. TODO: Duplicate parent's page to the new page and
 	 *    TODO: check whether parent's page is writable or not (set WRITABLE
 	 *    TODO: according to the result). */
-	memcpy(newpage, parent_page, PGSIZE);
+	copy_page(newpage, parent_page);
 	/* pte = parent process */
 	writable = is_writable(pte);
 	
@@ -148,44 +170,15 @@ struct MapElem
 	uintptr_t value;
 };
 
-static void
-__do_fork (void *aux)
+/* PARENT의 file descriptor table을 현재 프로세스로 복사한다.
+ * PARENT는 복사가 끝날 때까지 기다리고 있어야 한다. */
+static bool
+duplicate_fds (struct thread *parent)
 {
-	struct intr_frame if_;
-	struct thread *parent = (struct thread *) aux;
 	struct thread *current = thread_current ();
-	/* TODO: somehow pass the parent_if. (i.e. process_fork()'s if_) */
-	struct intr_frame *parent_if = &parent->parent_if;
-	bool succ = true;
-	
-	/* 1. Read the cpu context to local stack. */
-	memcpy (&if_, parent_if, sizeof (struct intr_frame));
-	if_.R.rax = 0;  // fork return value for child ??????
-
-
-	/* 2. Duplicate PT */
-	current->pml4 = pml4_create();
-	if (current->pml4 == NULL)
-		goto error;
-	
-	process_activate (current);
-#ifdef VM
-	supplemental_page_table_init (&current->spt);
-	if (!supplemental_page_table_copy (&current->spt, &parent->spt))
-		goto error;
-#else
-	if (!pml4_for_each (parent->pml4, duplicate_pte, parent))
-		goto error;
-#endif
-
-	/* TODO: Your code goes here.
-	 * TODO: Hint) To duplicate the file object, use `file_duplicate`
-	 * TODO:       in include/filesys/file.h. Note that parent should not return
-	 * TODO:       from the fork() until this function successfully duplicates
-	 * TODO:       the resources of parent.*/
 
 	if (parent->fdIdx == FDCOUNT_LIMIT)
-		goto error;
+		return false;
 
 	/*        자식 프로세스에 부모프로세스 파일 복사       */
 	const int MAPLEN = 10;
@@ -201,7 +194,7 @@ __do_fork (void *aux)
 		// Project2-extra) linear search on key-pair array
 		// If 'file' is already duplicated in child, don't duplicate again but share it
 		bool found = false;
-		for (int j = 0; j < MAPLEN; j++)
+		for (int j = 0; j < dupCount; j++)
 		{
 			if (map[j].key == file)
 			{
@@ -228,6 +221,48 @@ __do_fork (void *aux)
 		}
 	}
 	current->fdIdx = parent->fdIdx;
+	return true;
+}
+
+static void
+__do_fork (void *aux)
+{
+	struct intr_frame if_;
+	struct thread *parent = (struct thread *) aux;
+	struct thread *current = thread_current ();
+	/* TODO: somehow pass the parent_if. (i.e. process_fork()'s if_) */
+	struct intr_frame *parent_if = &parent->parent_if;
+	bool succ = true;
+	
+	/* 1. Read the cpu context to local stack. */
+	memcpy (&if_, parent_if, sizeof (struct intr_frame));
+	if_.R.rax = 0;  // fork return value for child ??????
+
+
+	/* 2. Duplicate PT */
+	current->pml4 = pml4_create();
+	if (current->pml4 == NULL)
+		goto error;
+	
+	process_activate (current);
+#ifdef VM
+	current->rss_limit = parent->rss_limit;
+	supplemental_page_table_init (&current->spt);
+	if (!supplemental_page_table_copy (&current->spt, &parent->spt))
+		goto error;
+#else
+	if (!pml4_for_each (parent->pml4, duplicate_pte, parent))
+		goto error;
+#endif
+
+	/* TODO: Your code goes here.
+	 * TODO: Hint) To duplicate the file object, use `file_duplicate`
+	 * TODO:       in include/filesys/file.h. Note that parent should not return
+	 * TODO:       from the fork() until this function successfully duplicates
+	 * TODO:       the resources of parent.*/
+
+	if (!duplicate_fds (parent))
+		goto error;
 	
 	/*      왜있는걸까 나중에 추가될지도  ???*/
 	process_init ();
@@ -250,6 +285,108 @@ error:
 	exit(TID_ERROR);
 }
 
+/* What process_spawn() hands the new process.  Lives on the parent's
+ * stack, which is fine since the parent waits on the child's fork_sema
+ * until the child is done with it. */
+struct spawn_args {
+	struct thread *parent;
+	char *cmd_line;
+	const struct spawn_action *actions;
+	size_t action_cnt;
+	bool success;
+};
+
+/* Starts a new process running CMD_LINE, a page that the new process
+ * takes over, without the copy of the current process that fork() would
+ * make only for exec() to throw it away.  The new process gets a copy of
+ * the current process's file descriptors, changed by the ACTION_CNT
+ * ACTIONS in order, and a fresh address space loaded from the program.
+ * Returns the new process's thread id, or TID_ERROR if it cannot be
+ * created, an action fails, or the program cannot be loaded. */
+tid_t
+process_spawn (char *cmd_line, const struct spawn_action *actions,
+		size_t action_cnt) {
+	struct spawn_args args = {
+		.parent = thread_current (),
+		.cmd_line = cmd_line,
+		.actions = actions,
+		.action_cnt = action_cnt,
+		.success = false,
+	};
+	char name[16], *save_ptr;
+	tid_t tid;
+
+	strlcpy (name, cmd_line, sizeof name);
+	strtok_r (name, " ", &save_ptr);
+	tid = thread_create (name, PRI_DEFAULT, __do_spawn, &args);
+	if (tid == TID_ERROR) {
+		palloc_free_page (cmd_line);
+		return TID_ERROR;
+	}
+
+	sema_down (&get_child_with_pid (tid)->fork_sema);
+	if (!args.success) {
+		/* The child exits without running; reap it. */
+		process_wait (tid);
+		return TID_ERROR;
+	}
+	return tid;
+}
+
+/* Applies ACTION to the current process's file descriptors.  Returns
+ * false if it names a descriptor out of range, or if SPAWN_DUP2's FD is
+ * not open. */
+static bool
+spawn_action (const struct spawn_action *action) {
+	if (action->fd < 0 || action->fd >= FDCOUNT_LIMIT)
+		return false;
+	switch (action->op) {
+		case SPAWN_CLOSE:
+			close (action->fd);
+			return true;
+		case SPAWN_DUP2:
+			return action->newfd >= 0 && action->newfd < FDCOUNT_LIMIT
+				&& dup2 (action->fd, action->newfd) == action->newfd;
+		default:
+			return false;
+	}
+}
+
+/* A thread function that sets up a process for process_spawn(). */
+static void
+__do_spawn (void *aux) {
+	struct spawn_args *args = aux;
+	struct thread *current = thread_current ();
+	struct intr_frame if_;
+	bool success;
+	size_t i;
+
+	if_.ds = if_.es = if_.ss = SEL_UDSEG;
+	if_.cs = SEL_UCSEG;
+	if_.eflags = FLAG_IF | FLAG_MBS;
+
+#ifdef VM
+	current->rss_limit = args->parent->rss_limit;
+	supplemental_page_table_init (&current->spt);
+#endif
+	success = duplicate_fds (args->parent);
+	for (i = 0; success && i < args->action_cnt; i++)
+		success = spawn_action (&args->actions[i]);
+	if (success)
+		success = load (args->cmd_line, &if_);
+	palloc_free_page (args->cmd_line);
+
+	/* ARGS is gone once the parent wakes up. */
+	args->success = success;
+	sema_up (&current->fork_sema);
+	if (!success) {
+		current->exit_status = -1;
+		thread_exit ();
+	}
+	do_iret (&if_);
+	NOT_REACHED ();
+}
+
 /* Switch the current execution context to the f_name.
  * Returns -1 on fail. */
 int
@@ -267,6 +404,9 @@ process_exec (void *f_name) {
 
 	/* We first kill the current conxtext */
 	process_cleanup ();
+#ifdef VM
+	supplemental_page_table_init (&thread_current ()->spt);
+#endif
 	
 	/* And then load the binary */
 	success = load (file_name, &_if);
@@ -332,6 +472,9 @@ process_exit (void) {
 	/* 때문에 더이상 다른 process(kernel)가 접근 할수있도록 allow해줘야됨*/
 	file_close(cur->running);
 
+#ifdef VM
+	faultstat_print_process ();
+#endif
 	process_cleanup ();
 
 	sema_up(&cur->wait_sema);
@@ -344,6 +487,7 @@ static void
 process_cleanup (void) {
 	struct thread *curr = thread_current ();
 
+	ring_exit ();
 #ifdef VM
 	supplemental_page_table_kill (&curr->spt);
 #endif
@@ -370,8 +514,12 @@ process_cleanup (void) {
  * This function is called on every context switch. */
 void
 process_activate (struct thread *next) {
-	/* Activate thread's page tables. */
-	pml4_activate (next->pml4);
+	/* Activate thread's page tables.  A kernel thread only touches
+	 * kernel addresses, which every pml4 maps identically, so it
+	 * keeps the previous process's page tables (and TLB entries)
+	 * loaded instead of switching to base_pml4. */
+	if (next->pml4 != NULL)
+		pml4_activate (next->pml4);
 
 	/* Set thread's kernel stack for use in processing interrupts. */
 	tss_update (next);
@@ -430,8 +578,41 @@ struct ELF64_PHDR {
 #define ELF ELF64_hdr
 #define Phdr ELF64_PHDR
 
+/* A loadable segment of an executable, as load_segment() takes it. */
+struct elf_segment {
+	uint64_t file_page;
+	uint64_t mem_page;
+	uint32_t read_bytes;
+	uint32_t zero_bytes;
+	bool writable;
+};
+
+/* What load() needs of an executable: its entry point and its
+ * validated loadable segments.  Kept in elf_cache by inode, so that
+ * exec of a program run before skips reading and checking its headers
+ * again.  An entry holds its inode open, which keeps WRITE_GEN
+ * meaningful: if the file is written the entry is stale.  Entries for
+ * removed files are dropped, so as not to keep their blocks. */
+struct elf_image {
+	struct inode *inode;
+	unsigned write_gen;          /* inode_write_gen() when parsed. */
+	uint64_t entry;
+	int ref_cnt;                 /* elf_cache plus users in load(). */
+	struct list_elem elem;       /* Element in elf_cache. */
+	size_t seg_cnt;
+	struct elf_segment segs[];
+};
+
+/* Executables whose headers to remember, most recently used first. */
+#define ELF_CACHE_SIZE 8
+static struct list elf_cache;
+static struct lock elf_cache_lock;
+
 static bool setup_stack (struct intr_frame *if_);
 static bool validate_segment (const struct Phdr *, struct file *);
+static struct elf_image *elf_parse (struct file *);
+static struct elf_image *elf_image_get (struct file *);
+static void elf_image_put (struct elf_image *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		uint32_t read_bytes, uint32_t zero_bytes,
 		bool writable);
@@ -443,11 +624,10 @@ static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
 static bool
 load (const char *file_name, struct intr_frame *if_) {
 	struct thread *t = thread_current ();
-	struct ELF ehdr;
+	struct elf_image *image = NULL;
 	struct file *file = NULL;
-	off_t file_ofs;
 	bool success = false;
-	int i;
+	size_t i;
 
 	char *token, *save_ptr;
 	char *argv[64];
@@ -475,69 +655,19 @@ load (const char *file_name, struct intr_frame *if_) {
 	}
 	t->running = file;
 	file_deny_write(file);
-	/* Read and verify executable header. */
-	if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
-			|| memcmp (ehdr.e_ident, "\177ELF\2\1\1", 7)
-			|| ehdr.e_type != 2
-			|| ehdr.e_machine != 0x3E // amd64
-			|| ehdr.e_version != 1
-			|| ehdr.e_phentsize != sizeof (struct Phdr)
-			|| ehdr.e_phnum > 1024) {
+	/* Read and verify the executable's headers, unless they are
+	 * cached already. */
+	image = elf_image_get (file);
+	if (image == NULL) {
 		printf ("load: %s: error loading executable\n", argv[0]);
 		goto done;
 	}
+	for (i = 0; i < image->seg_cnt; i++) {
+		struct elf_segment *seg = &image->segs[i];
 
-	/* Read program headers. */
-	file_ofs = ehdr.e_phoff;
-	for (i = 0; i < ehdr.e_phnum; i++) {
-		struct Phdr phdr;
-
-		if (file_ofs < 0 || file_ofs > file_length (file))
+		if (!load_segment (file, seg->file_page, (void *) seg->mem_page,
+					seg->read_bytes, seg->zero_bytes, seg->writable))
 			goto done;
-		file_seek (file, file_ofs);
-
-		if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
-			goto done;
-		file_ofs += sizeof phdr;
-		switch (phdr.p_type) {
-			case PT_NULL:
-			case PT_NOTE:
-			case PT_PHDR:
-			case PT_STACK:
-			default:
-				/* Ignore this segment. */
-				break;
-			case PT_DYNAMIC:
-			case PT_INTERP:
-			case PT_SHLIB:
-				goto done;
-			case PT_LOAD:
-				if (validate_segment (&phdr, file)) {
-					bool writable = (phdr.p_flags & PF_W) != 0;
-					uint64_t file_page = phdr.p_offset & ~PGMASK;
-					uint64_t mem_page = phdr.p_vaddr & ~PGMASK;
-					uint64_t page_offset = phdr.p_vaddr & PGMASK;
-					uint32_t read_bytes, zero_bytes;
-					if (phdr.p_filesz > 0) {
-						/* Normal segment.
-						 * Read initial part from disk and zero the rest. */
-						read_bytes = page_offset + phdr.p_filesz;
-						zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
-								- read_bytes);
-					} else {
-						/* Entirely zero.
-						 * Don't read anything from disk. */
-						read_bytes = 0;
-						zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
-					}
-					if (!load_segment (file, file_page, (void *) mem_page,
-								read_bytes, zero_bytes, writable))
-						goto done;
-				}
-				else
-					goto done;
-				break;
-		}
 	}
 
 	/* Set up stack. */
@@ -545,7 +675,7 @@ load (const char *file_name, struct intr_frame *if_) {
 		goto done;
 
 	/* Start address. */
-	if_->rip = ehdr.e_entry;
+	if_->rip = image->entry;
 
 	/* TODO: Your code goes here.
 	 * TODO: Implement argument passing (see project2/argument_passing.html). */
@@ -557,6 +687,8 @@ load (const char *file_name, struct intr_frame *if_) {
 done:
 	/* We arrive here whether the load is successful or not. */
 	//file_close (file);
+	if (image != NULL)
+		elf_image_put (image);
 	
 	return success;
 }
@@ -606,6 +738,227 @@ validate_segment (const struct Phdr *phdr, struct file *file) {
 	return true;
 }
 
+/* Fills in SEG from PHDR, a valid PT_LOAD program header. */
+static void
+elf_segment_init (struct elf_segment *seg, const struct Phdr *phdr) {
+	uint64_t page_offset = phdr->p_vaddr & PGMASK;
+
+	seg->writable = (phdr->p_flags & PF_W) != 0;
+	seg->file_page = phdr->p_offset & ~PGMASK;
+	seg->mem_page = phdr->p_vaddr & ~PGMASK;
+	if (phdr->p_filesz > 0) {
+		/* Normal segment.
+		 * Read initial part from disk and zero the rest. */
+		seg->read_bytes = page_offset + phdr->p_filesz;
+		seg->zero_bytes = (ROUND_UP (page_offset + phdr->p_memsz, PGSIZE)
+				- seg->read_bytes);
+	} else {
+		/* Entirely zero.
+		 * Don't read anything from disk. */
+		seg->read_bytes = 0;
+		seg->zero_bytes = ROUND_UP (page_offset + phdr->p_memsz, PGSIZE);
+	}
+}
+
+/* Reads the ELF header and the program header table of FILE, in one
+ * read of its first page unless the table lies beyond it, and checks
+ * them and every segment before building anything.  Returns a new image
+ * with no references, or a null pointer if FILE is not a valid
+ * executable or memory is short. */
+static struct elf_image *
+elf_parse (struct file *file) {
+	uint8_t *buf = palloc_get_page (0);
+	const struct ELF *ehdr = (const struct ELF *) buf;
+	const struct Phdr *phdrs;
+	struct Phdr *table = NULL;
+	struct elf_image *image = NULL;
+	size_t phdrs_size, seg_cnt = 0;
+	off_t len;
+	int i;
+
+	if (buf == NULL)
+		return NULL;
+	len = file_read_at (file, buf, PGSIZE, 0);
+	if (len < (off_t) sizeof *ehdr
+			|| memcmp (ehdr->e_ident, "\177ELF\2\1\1", 7)
+			|| ehdr->e_type != 2
+			|| ehdr->e_machine != 0x3E // amd64
+			|| ehdr->e_version != 1
+			|| ehdr->e_phentsize != sizeof (struct Phdr)
+			|| ehdr->e_phnum > 1024)
+		goto done;
+
+	/* The program headers normally follow the ELF header, in the page
+	 * just read. */
+	phdrs_size = ehdr->e_phnum * sizeof *phdrs;
+	if (ehdr->e_phoff <= (uint64_t) len
+			&& phdrs_size <= (uint64_t) len - ehdr->e_phoff)
+		phdrs = (const struct Phdr *) (buf + ehdr->e_phoff);
+	else {
+		if (ehdr->e_phoff > (uint64_t) file_length (file)
+				|| (table = malloc (phdrs_size)) == NULL
+				|| file_read_at (file, table, phdrs_size, ehdr->e_phoff)
+					!= (off_t) phdrs_size)
+			goto done;
+		phdrs = table;
+	}
+
+	for (i = 0; i < ehdr->e_phnum; i++)
+		switch (phdrs[i].p_type) {
+			case PT_NULL:
+			case PT_NOTE:
+			case PT_PHDR:
+			case PT_STACK:
+			default:
+				/* Ignore this segment. */
+				break;
+			case PT_DYNAMIC:
+			case PT_INTERP:
+			case PT_SHLIB:
+				goto done;
+			case PT_LOAD:
+				if (!validate_segment (&phdrs[i], file))
+					goto done;
+				seg_cnt++;
+				break;
+		}
+
+	image = malloc (sizeof *image + seg_cnt * sizeof *image->segs);
+	if (image == NULL)
+		goto done;
+	image->entry = ehdr->e_entry;
+	image->ref_cnt = 0;
+	image->seg_cnt = 0;
+	for (i = 0; i < ehdr->e_phnum; i++)
+		if (phdrs[i].p_type == PT_LOAD)
+			elf_segment_init (&image->segs[image->seg_cnt++], &phdrs[i]);
+
+done:
+	free (table);
+	palloc_free_page (buf);
+	return image;
+}
+
+/* Initializes the cache of executables' headers. */
+void
+elf_cache_init (void) {
+	list_init (&elf_cache);
+	lock_init (&elf_cache_lock);
+}
+
+/* Drops a reference to IMAGE, freeing it with the last.  The caller
+ * must hold elf_cache_lock. */
+static void
+elf_image_unref (struct elf_image *image) {
+	if (--image->ref_cnt > 0)
+		return;
+	inode_close (image->inode);
+	free (image);
+}
+
+/* Returns the entry of elf_cache for INODE, with a reference for the
+ * caller, or a null pointer if there is none that is up to date.  Drops
+ * stale entries for INODE and entries for executables that have been
+ * removed, which would keep the files' blocks allocated.  The caller
+ * must hold elf_cache_lock. */
+static struct elf_image *
+elf_cache_lookup (struct inode *inode) {
+	struct elf_image *image = NULL;
+	struct list_elem *e, *next;
+
+	for (e = list_begin (&elf_cache); e != list_end (&elf_cache); e = next) {
+		struct elf_image *cached = list_entry (e, struct elf_image, elem);
+
+		next = list_next (e);
+		if (cached->inode == inode
+				&& cached->write_gen == inode_write_gen (inode)
+				&& !inode_is_removed (inode))
+			image = cached;
+		else if (cached->inode == inode || inode_is_removed (cached->inode)) {
+			list_remove (e);
+			elf_image_unref (cached);
+		}
+	}
+	if (image != NULL) {
+		list_remove (&image->elem);
+		list_push_front (&elf_cache, &image->elem);
+		image->ref_cnt++;
+	}
+	return image;
+}
+
+/* Returns the image of FILE, an executable, with a reference for the
+ * caller to drop with elf_image_put(): from elf_cache if FILE has not
+ * been written since it was parsed, or else parsed afresh and cached.
+ * Returns a null pointer if FILE is not a valid executable or memory is
+ * short. */
+static struct elf_image *
+elf_image_get (struct file *file) {
+	struct inode *inode = file_get_inode (file);
+	struct elf_image *image, *cached;
+	unsigned write_gen;
+
+	lock_acquire (&elf_cache_lock);
+	image = elf_cache_lookup (inode);
+	write_gen = inode_write_gen (inode);
+	lock_release (&elf_cache_lock);
+	if (image != NULL)
+		return image;
+
+	image = elf_parse (file);
+	if (image == NULL)
+		return NULL;
+	image->inode = inode_reopen (inode);
+	image->write_gen = write_gen;
+	image->ref_cnt = 1;
+
+	/* Another process may have cached FILE while we parsed it, or FILE
+	 * may have been written or removed meanwhile. */
+	lock_acquire (&elf_cache_lock);
+	cached = elf_cache_lookup (inode);
+	if (cached != NULL) {
+		elf_image_unref (image);
+		image = cached;
+	} else if (write_gen == inode_write_gen (inode)
+			&& !inode_is_removed (inode)) {
+		image->ref_cnt++;
+		list_push_front (&elf_cache, &image->elem);
+		if (list_size (&elf_cache) > ELF_CACHE_SIZE)
+			elf_image_unref (list_entry (list_pop_back (&elf_cache),
+						struct elf_image, elem));
+	}
+	lock_release (&elf_cache_lock);
+	return image;
+}
+
+/* Drops the reference to IMAGE that elf_image_get() returned. */
+static void
+elf_image_put (struct elf_image *image) {
+	lock_acquire (&elf_cache_lock);
+	elf_image_unref (image);
+	lock_release (&elf_cache_lock);
+}
+
+/* Drops the entries of elf_cache for executables that have been
+ * removed, so that the files' blocks are freed once no process is
+ * running them, rather than when the next executable is loaded. */
+void
+elf_cache_drop_removed (void) {
+	struct list_elem *e, *next;
+
+	lock_acquire (&elf_cache_lock);
+	for (e = list_begin (&elf_cache); e != list_end (&elf_cache); e = next) {
+		struct elf_image *image = list_entry (e, struct elf_image, elem);
+
+		next = list_next (e);
+		if (inode_is_removed (image->inode)) {
+			list_remove (e);
+			elf_image_unref (image);
+		}
+	}
+	lock_release (&elf_cache_lock);
+}
+
 #ifndef VM
 /* Codes of this block will be ONLY USED DURING project 2.
  * If you want to implement the function for whole project 2, implement it
@@ -637,6 +990,35 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 
 	file_seek (file, ofs);
 	while (read_bytes > 0 || zero_bytes > 0) {
+		/* With -lp, fill each 2 MB aligned run of at least 2 MB
+		 * with one large page.  If no aligned run of frames is
+		 * free, or 4 kB pages of another segment already share the
+		 * range, fall back to 4 kB pages. */
+		if (user_large_pages && ((uint64_t) upage & LPGMASK) == 0
+				&& read_bytes + zero_bytes >= LPGSIZE) {
+			size_t lpage_read_bytes = read_bytes < LPGSIZE ? read_bytes : LPGSIZE;
+			size_t lpage_zero_bytes = LPGSIZE - lpage_read_bytes;
+			uint8_t *kpage = palloc_get_large_page (PAL_USER);
+
+			if (kpage != NULL) {
+				if (file_read (file, kpage, lpage_read_bytes) != (int) lpage_read_bytes) {
+					palloc_free_large_page (kpage);
+					return false;
+				}
+				memset (kpage + lpage_read_bytes, 0, lpage_zero_bytes);
+
+				if (pml4_set_large_page (thread_current ()->pml4, upage, kpage,
+							writable)) {
+					read_bytes -= lpage_read_bytes;
+					zero_bytes -= lpage_zero_bytes;
+					upage += LPGSIZE;
+					continue;
+				}
+				palloc_free_large_page (kpage);
+				file_seek (file, file_tell (file) - lpage_read_bytes);
+			}
+		}
+
 		/* Do calculate how to fill this page.
 		 * We will read PAGE_READ_BYTES bytes from FILE
 		 * and zero the final PAGE_ZERO_BYTES bytes. */
@@ -710,11 +1092,11 @@ install_page (void *upage, void *kpage, bool writable) {
  * If you want to implement the function for only project 2, implement it on the
  * upper block. */
 
+/* Reads a page of an ELF segment on its first fault.  Where it comes
+ * from in the file is recorded in the page's region. */
 static bool
-lazy_load_segment (struct page *page, void *aux) {
-	/* TODO: Load the segment from the file */
-	/* TODO: This called when the first page fault occurs on address VA. */
-	/* TODO: VA is available when calling this function. */
+lazy_load_segment (struct page *page, void *aux UNUSED) {
+	return vma_read_page (page->vma, page->va, page->frame->kva);
 }
 
 /* Loads a segment starting at offset OFS in FILE at address
@@ -738,24 +1120,24 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 	ASSERT (pg_ofs (upage) == 0);
 	ASSERT (ofs % PGSIZE == 0);
 
-	while (read_bytes > 0 || zero_bytes > 0) {
-		/* Do calculate how to fill this page.
-		 * We will read PAGE_READ_BYTES bytes from FILE
-		 * and zero the final PAGE_ZERO_BYTES bytes. */
-		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-		size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-		/* TODO: Set up aux to pass information to the lazy_load_segment. */
-		void *aux = NULL;
-		if (!vm_alloc_page_with_initializer (VM_ANON, upage,
-					writable, lazy_load_segment, aux))
-			return false;
+	/* The whole segment is one region.  Its pages are read from the
+	 * region's own handle on FILE as they are first touched.  A
+	 * read-only segment never changes, so it is file-backed, which lets
+	 * its pages be dropped rather than swapped and shared between
+	 * processes running the same executable. */
+	enum vm_type type = writable ? VM_ANON : VM_FILE | VM_TEXT;
+	struct vm_area *vma = vm_alloc_region (type, upage,
+			(read_bytes + zero_bytes) / PGSIZE, writable, lazy_load_segment, NULL);
+	if (vma == NULL)
+		return false;
 
-		/* Advance. */
-		read_bytes -= page_read_bytes;
-		zero_bytes -= page_zero_bytes;
-		upage += PGSIZE;
+	vma->file = file_reopen (file);
+	if (vma->file == NULL) {
+		vm_free_region (vma);
+		return false;
 	}
+	vma->offset = ofs;
+	vma->read_bytes = read_bytes;
 	return true;
 }
 
@@ -765,11 +1147,14 @@ setup_stack (struct intr_frame *if_) {
 	bool success = false;
 	void *stack_bottom = (void *) (((uint8_t *) USER_STACK) - PGSIZE);
 
-	/* TODO: Map the stack on stack_bottom and claim the page immediately.
-	 * TODO: If success, set the rsp accordingly.
-	 * TODO: You should mark the page is stack. */
-	/* TODO: Your code goes here */
-
+	/* The stack region grows down from here on faults; see
+	 * vm_try_handle_fault(). */
+	if (vm_alloc_region (VM_ANON | VM_STACK, stack_bottom, 1, true,
+				NULL, NULL) != NULL
+			&& vm_claim_page (stack_bottom)) {
+		if_->rsp = USER_STACK;
+		success = true;
+	}
 	return success;
 }
 #endif /* VM */
@@ -0,0 +1,443 @@
+/* ring.c: Batched, asynchronous system calls through a shared ring. */
+
+#include "userprog/ring.h"
+#include <debug.h>
+#include <list.h>
+#include <stdio.h>
+#include "filesys/directory.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "userprog/syscall.h"
+#include "userprog/uaccess.h"
+
+/* A process that registers a struct io_ring with ring_setup() can
+ * queue many requests and hand them all over with one ring_enter(),
+ * instead of trapping into the kernel for each.  ring_enter() copies
+ * each request in, taking any data to write along, and queues them for
+ * a kernel worker.  The worker takes everything queued at once and
+ * carries it out under a single acquisition of filesys_lock, in order.
+ * Requests done on the spot, such as a close or one with a bad
+ * descriptor, go through the worker too, so that results come back in
+ * the order requests were submitted.
+ * Results come back to the process's struct ring_ctx.  ring_enter()
+ * posts them to the completion queue, copying read data out to the
+ * user's buffers, since only the process itself can touch its memory.
+ *
+ * Requests on a descriptor hold its struct file, so close() waits for
+ * the process's requests in flight to finish before closing.
+ *
+ * A process holds no more requests in the kernel, in flight or done
+ * but not yet posted, than its completion queue has room for after
+ * what it has not yet reaped.  Past that, ring_enter() leaves requests
+ * in the submission queue, so a process that never reaps cannot make
+ * the kernel hold on to more and more memory for it. */
+
+/* Most bytes one request transfers.  Longer ones come up short. */
+#define RING_IO_MAX 4096
+
+#define RING_MASK (RING_ENTRIES - 1)
+
+/* A process's ring. */
+struct ring_ctx {
+	struct io_ring *ring;        /* In user memory. */
+	unsigned sq_head;            /* Kernel's copies of its indexes. */
+	unsigned cq_tail;
+
+	struct lock lock;
+	struct condition done_cond;  /* Signaled when a request is done. */
+	struct list done;            /* Done, to post; struct ring_req. */
+	int inflight;                /* Queued to the worker, not yet done. */
+	unsigned held;               /* Taken from the submission queue, not
+	                                yet posted. */
+};
+
+/* A request taken from a submission queue. */
+struct ring_req {
+	struct ring_ctx *ctx;
+	int opcode;
+	struct file *file;           /* Resolved from the descriptor. */
+	void *buf;                   /* Kernel copy of the data or name. */
+	void *ubuf;                  /* User buffer to read into. */
+	unsigned len;
+	off_t offset;
+	uint64_t user_data;
+	int res;
+	bool ready;                  /* Done already; the worker skips it. */
+	struct file *opened;         /* RING_OPEN: the file opened. */
+	struct list_elem elem;       /* Element in queue or ctx's done. */
+};
+
+/* Requests for the worker, oldest first. */
+static struct list queue;
+static struct lock queue_lock;
+static struct condition queue_cond;
+
+static void ring_worker (void *aux);
+
+/* Starts the worker. */
+void
+ring_init (void) {
+	list_init (&queue);
+	lock_init (&queue_lock);
+	cond_init (&queue_cond);
+	if (thread_create ("ringd", PRI_DEFAULT, ring_worker, NULL) == TID_ERROR)
+		PANIC ("ring_init: cannot start the ring worker");
+}
+
+/* Carries out REQ.  The caller holds filesys_lock. */
+static void
+ring_execute (struct ring_req *req) {
+	switch (req->opcode) {
+		case RING_READ:
+			req->res = file_read (req->file, req->buf, req->len);
+			break;
+		case RING_PREAD:
+			req->res = file_read_at (req->file, req->buf, req->len, req->offset);
+			break;
+		case RING_WRITE:
+			if (req->file == (struct file *) 2) {
+				putbuf (req->buf, req->len);
+				req->res = req->len;
+			} else
+				req->res = file_write (req->file, req->buf, req->len);
+			break;
+		case RING_PWRITE:
+			req->res = file_write_at (req->file, req->buf, req->len,
+					req->offset);
+			break;
+		case RING_OPEN:
+			req->opened = filesys_open (req->buf);
+			req->res = req->opened != NULL ? 0 : -1;
+			break;
+		default:
+			NOT_REACHED ();
+	}
+}
+
+/* The worker: carries out the queued requests a batch at a time. */
+static void
+ring_worker (void *aux UNUSED) {
+	for (;;) {
+		struct list batch;
+		struct list_elem *e;
+
+		list_init (&batch);
+		lock_acquire (&queue_lock);
+		while (list_empty (&queue))
+			cond_wait (&queue_cond, &queue_lock);
+		list_splice (list_end (&batch), list_begin (&queue), list_end (&queue));
+		lock_release (&queue_lock);
+
+		lock_acquire (&filesys_lock);
+		for (e = list_begin (&batch); e != list_end (&batch); e = list_next (e)) {
+			struct ring_req *req = list_entry (e, struct ring_req, elem);
+
+			if (!req->ready)
+				ring_execute (req);
+		}
+		lock_release (&filesys_lock);
+
+		while (!list_empty (&batch)) {
+			struct ring_req *req = list_entry (list_pop_front (&batch),
+					struct ring_req, elem);
+			struct ring_ctx *ctx = req->ctx;
+
+			lock_acquire (&ctx->lock);
+			list_push_back (&ctx->done, &req->elem);
+			ctx->inflight--;
+			cond_signal (&ctx->done_cond, &ctx->lock);
+			lock_release (&ctx->lock);
+		}
+	}
+}
+
+/* Queues BATCH, requests of CTX, for the worker. */
+static void
+ring_queue (struct ring_ctx *ctx, struct list *batch) {
+	if (list_empty (batch))
+		return;
+	lock_acquire (&ctx->lock);
+	ctx->inflight += list_size (batch);
+	lock_release (&ctx->lock);
+
+	lock_acquire (&queue_lock);
+	list_splice (list_end (&queue), list_begin (batch), list_end (batch));
+	cond_signal (&queue_cond, &queue_lock);
+	lock_release (&queue_lock);
+}
+
+/* Frees REQ, which has not been posted. */
+static void
+ring_req_free (struct ring_req *req) {
+	if (req->opened != NULL)
+		file_close (req->opened);
+	free (req->buf);
+	free (req);
+}
+
+/* Fills in REQ from SQE.  Returns true if REQ is for the worker, false
+ * if it is already done, with REQ->res set. */
+static bool
+ring_prepare (struct ring_req *req, const struct ring_sqe *sqe) {
+	struct file *file;
+	int len;
+
+	req->opcode = sqe->opcode;
+	req->ubuf = sqe->buf;
+	req->len = sqe->len < RING_IO_MAX ? sqe->len : RING_IO_MAX;
+	req->offset = sqe->offset;
+	req->user_data = sqe->user_data;
+	req->res = -1;
+
+	switch (sqe->opcode) {
+		case RING_READ:
+		case RING_PREAD:
+		case RING_WRITE:
+		case RING_PWRITE:
+			file = process_get_file (sqe->fd);
+			if (file == NULL || file == (struct file *) 1)
+				return false;
+			if (file == (struct file *) 2 && sqe->opcode != RING_WRITE)
+				return false;
+			if ((sqe->opcode == RING_PREAD || sqe->opcode == RING_PWRITE)
+					&& sqe->offset < 0)
+				return false;
+			req->file = file;
+			if (req->len == 0) {
+				req->res = 0;
+				return false;
+			}
+			req->buf = malloc (req->len);
+			if (req->buf == NULL)
+				return false;
+			if (sqe->opcode == RING_WRITE || sqe->opcode == RING_PWRITE)
+				return copy_from_user (req->buf, sqe->buf, req->len);
+			return true;
+
+		case RING_OPEN:
+			req->buf = malloc (NAME_MAX + 1);
+			if (req->buf == NULL)
+				return false;
+			len = strncpy_from_user (req->buf, sqe->buf, NAME_MAX + 1);
+			return len >= 0 && len < NAME_MAX + 1;
+
+		case RING_CLOSE:
+			if (process_get_file (sqe->fd) == NULL)
+				return false;
+			close (sqe->fd);
+			req->res = 0;
+			return false;
+
+		default:
+			return false;
+	}
+}
+
+/* Returns how many completions CTX's completion queue holds that the
+ * process has not reaped yet. */
+static unsigned
+ring_unreaped (struct ring_ctx *ctx) {
+	unsigned cq_head;
+
+	if (!copy_from_user (&cq_head, &ctx->ring->cq_head, sizeof cq_head))
+		exit (-1);
+	return ctx->cq_tail - cq_head < RING_ENTRIES
+		? ctx->cq_tail - cq_head : RING_ENTRIES;
+}
+
+/* Takes up to TO_SUBMIT requests from CTX's submission queue, but no
+ * more than the completion queue will have room for.  Returns how many
+ * were taken. */
+static unsigned
+ring_submit (struct ring_ctx *ctx, unsigned to_submit) {
+	struct io_ring *ring = ctx->ring;
+	struct list batch;
+	unsigned sq_tail, room, i;
+
+	if (!copy_from_user (&sq_tail, &ring->sq_tail, sizeof sq_tail))
+		exit (-1);
+	room = RING_ENTRIES - ring_unreaped (ctx);
+	room = room > ctx->held ? room - ctx->held : 0;
+	if (to_submit > sq_tail - ctx->sq_head)
+		to_submit = sq_tail - ctx->sq_head;
+	if (to_submit > room)
+		to_submit = room;
+
+	list_init (&batch);
+	for (i = 0; i < to_submit; i++) {
+		struct ring_sqe sqe;
+		struct ring_req *req;
+
+		if (!copy_from_user (&sqe, &ring->sq[ctx->sq_head & RING_MASK],
+					sizeof sqe)) {
+			ring_queue (ctx, &batch);
+			exit (-1);
+		}
+		req = calloc (1, sizeof *req);
+		if (req == NULL)
+			break;
+		req->ctx = ctx;
+
+		/* Whatever came before a close must not see it. */
+		if (sqe.opcode == RING_CLOSE)
+			ring_queue (ctx, &batch);
+
+		req->ready = !ring_prepare (req, &sqe);
+		list_push_back (&batch, &req->elem);
+		ctx->sq_head++;
+		ctx->held++;
+	}
+	ring_queue (ctx, &batch);
+
+	if (!copy_to_user (&ring->sq_head, &ctx->sq_head, sizeof ctx->sq_head))
+		exit (-1);
+	return i;
+}
+
+/* Finishes REQ in the process's context and fills in CQE from it. */
+static void
+ring_finish (struct ring_req *req, struct ring_cqe *cqe) {
+	if ((req->opcode == RING_READ || req->opcode == RING_PREAD)
+			&& req->res > 0 && !copy_to_user (req->ubuf, req->buf, req->res))
+		req->res = -1;
+	if (req->opened != NULL) {
+		req->res = process_add_file (req->opened);
+		if (req->res == -1)
+			file_close (req->opened);
+		req->opened = NULL;
+	}
+	cqe->user_data = req->user_data;
+	cqe->res = req->res;
+	ring_req_free (req);
+}
+
+/* Posts CTX's done requests to its completion queue, as many as fit.
+ * Returns how many were posted, and sets *FULL if the queue filled. */
+static unsigned
+ring_complete (struct ring_ctx *ctx, bool *full) {
+	struct io_ring *ring = ctx->ring;
+	struct list posting;
+	unsigned space = RING_ENTRIES - ring_unreaped (ctx), posted = 0;
+
+	/* Copying out may fault, so not under the lock. */
+	list_init (&posting);
+	lock_acquire (&ctx->lock);
+	while (posted < space && !list_empty (&ctx->done)) {
+		list_push_back (&posting, list_pop_front (&ctx->done));
+		posted++;
+	}
+	*full = posted == space && !list_empty (&ctx->done);
+	lock_release (&ctx->lock);
+
+	while (!list_empty (&posting)) {
+		struct ring_req *req = list_entry (list_pop_front (&posting),
+				struct ring_req, elem);
+		struct ring_cqe cqe;
+
+		ring_finish (req, &cqe);
+		if (!copy_to_user (&ring->cq[ctx->cq_tail & RING_MASK], &cqe,
+					sizeof cqe)) {
+			lock_acquire (&ctx->lock);
+			list_splice (list_begin (&ctx->done), list_begin (&posting),
+					list_end (&posting));
+			lock_release (&ctx->lock);
+			exit (-1);
+		}
+		ctx->cq_tail++;
+		ctx->held--;
+	}
+	if (!copy_to_user (&ring->cq_tail, &ctx->cq_tail, sizeof ctx->cq_tail))
+		exit (-1);
+	return posted;
+}
+
+/* Sets up RING, in user memory, as the current process's syscall ring
+ * and empties its queues.  Returns 0 if successful, -1 if the process
+ * has a ring already, RING is not all writable user memory, or memory
+ * is short. */
+int
+do_ring_setup (struct io_ring *ring) {
+	struct thread *curr = thread_current ();
+	struct ring_ctx *ctx;
+	unsigned zero[4] = { 0, 0, 0, 0 };
+
+	if (curr->ring != NULL || ring == NULL
+			|| !user_range_writable (ring, sizeof *ring)
+			|| !copy_to_user (ring, zero, sizeof zero))
+		return -1;
+	ctx = malloc (sizeof *ctx);
+	if (ctx == NULL)
+		return -1;
+	ctx->ring = ring;
+	ctx->sq_head = ctx->cq_tail = 0;
+	lock_init (&ctx->lock);
+	cond_init (&ctx->done_cond);
+	list_init (&ctx->done);
+	ctx->inflight = 0;
+	ctx->held = 0;
+	curr->ring = ctx;
+	return 0;
+}
+
+/* Submits up to TO_SUBMIT requests from the current process's ring, as
+ * many as its completion queue will have room for, then posts
+ * completions until at least MIN_COMPLETE have been posted, nothing is
+ * left in flight, or the completion queue is full.  Returns the number
+ * of requests submitted, or -1 if there is no ring. */
+int
+do_ring_enter (unsigned to_submit, unsigned min_complete) {
+	struct ring_ctx *ctx = thread_current ()->ring;
+	unsigned submitted, completed = 0;
+	bool full, idle;
+
+	if (ctx == NULL)
+		return -1;
+	submitted = ring_submit (ctx, to_submit);
+	for (;;) {
+		completed += ring_complete (ctx, &full);
+		if (completed >= min_complete || full)
+			break;
+
+		lock_acquire (&ctx->lock);
+		while (list_empty (&ctx->done) && ctx->inflight > 0)
+			cond_wait (&ctx->done_cond, &ctx->lock);
+		idle = list_empty (&ctx->done);
+		lock_release (&ctx->lock);
+		if (idle)
+			break;
+	}
+	return submitted;
+}
+
+/* Waits until none of the current process's requests are in flight. */
+void
+ring_quiesce (void) {
+	struct ring_ctx *ctx = thread_current ()->ring;
+
+	if (ctx == NULL)
+		return;
+	lock_acquire (&ctx->lock);
+	while (ctx->inflight > 0)
+		cond_wait (&ctx->done_cond, &ctx->lock);
+	lock_release (&ctx->lock);
+}
+
+/* Tears down the current process's ring, if any, once its requests in
+ * flight are done.  Results not yet posted are dropped. */
+void
+ring_exit (void) {
+	struct thread *curr = thread_current ();
+	struct ring_ctx *ctx = curr->ring;
+
+	if (ctx == NULL)
+		return;
+	ring_quiesce ();
+	while (!list_empty (&ctx->done))
+		ring_req_free (list_entry (list_pop_front (&ctx->done),
+					struct ring_req, elem));
+	curr->ring = NULL;
+	free (ctx);
+}
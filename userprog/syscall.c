@@ -6,19 +6,27 @@
 #include "threads/vaddr.h"
 #include "userprog/gdt.h"
 #include "userprog/process.h"
+#include "userprog/ring.h"
 #include "userprog/syscall.h"
+#include "userprog/uaccess.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
+#include "filesys/directory.h"
+#include <limits.h>
+#include <round.h>
 #include <list.h>
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
 #include "intrinsic.h"
+#ifdef VM
+#include "vm/vm.h"
+#endif
 
 void syscall_entry(void);
 void syscall_handler(struct intr_frame *);
 
 /* Projects 2 and later. */
-void check_address(const uint64_t *);
 void halt (void) NO_RETURN;
 void exit (int status) NO_RETURN;
 tid_t fork(const char *, struct intr_frame *);
@@ -35,12 +43,31 @@ unsigned tell (int fd);
 void close (int fd);
 
 int dup2(int oldfd, int newfd);
+tid_t spawn (const char *file, const struct spawn_action *actions);
+int pread (int fd, void *buffer, unsigned length, off_t offset);
+int pwrite (int fd, const void *buffer, unsigned length, off_t offset);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int ring_setup (struct io_ring *ring);
+int ring_enter (unsigned to_submit, unsigned min_complete);
+#ifdef VM
+void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
+void munmap (void *addr);
+void *shmap (void *addr, size_t length);
+int madvise (void *addr, size_t length, int advice);
+int msync (void *addr, size_t length);
+size_t rsslimit (size_t pages);
+#endif
 
 
 int process_add_file (struct file *);
 struct file *process_get_file (int);
 void process_close_file (int);
 
+/* Transfers of up to this many bytes are bounced through the
+   kernel stack; larger ones through pages from the pool. */
+#define BOUNCE_SIZE 256
+
 const int STDIN = 1;
 const int STDOUT = 2;
 struct lock file_lock;
@@ -75,7 +102,11 @@ syscall_init (void) {
 /* The main system call interface */
 void
 syscall_handler (struct intr_frame *f UNUSED) {
-	// TODO: Your implementation goes here.
+#ifdef VM
+	/* Page faults taken inside a system call grow the user stack
+	 * relative to this. */
+	thread_current ()->user_rsp = (void *) f->rsp;
+#endif
 	switch (f->R.rax)
 	{
 	case SYS_HALT:
@@ -124,17 +155,236 @@ syscall_handler (struct intr_frame *f UNUSED) {
 	case SYS_DUP2:
 		f->R.rax = dup2(f->R.rdi, f->R.rsi);
 		break;
+	case SYS_SPAWN:
+		f->R.rax = spawn((const char *) f->R.rdi,
+				(const struct spawn_action *) f->R.rsi);
+		break;
+	case SYS_PREAD:
+		f->R.rax = pread(f->R.rdi, (void *) f->R.rsi, f->R.rdx, f->R.r10);
+		break;
+	case SYS_PWRITE:
+		f->R.rax = pwrite(f->R.rdi, (const void *) f->R.rsi, f->R.rdx,
+				f->R.r10);
+		break;
+	case SYS_READV:
+		f->R.rax = readv(f->R.rdi, (const struct iovec *) f->R.rsi, f->R.rdx);
+		break;
+	case SYS_WRITEV:
+		f->R.rax = writev(f->R.rdi, (const struct iovec *) f->R.rsi, f->R.rdx);
+		break;
+	case SYS_RING_SETUP:
+		f->R.rax = ring_setup((struct io_ring *) f->R.rdi);
+		break;
+	case SYS_RING_ENTER:
+		f->R.rax = ring_enter(f->R.rdi, f->R.rsi);
+		break;
+#ifdef VM
+	case SYS_MMAP:
+		f->R.rax = (uint64_t) mmap((void *) f->R.rdi, f->R.rsi, f->R.rdx,
+				f->R.r10, f->R.r8);
+		break;
+	case SYS_MUNMAP:
+		munmap((void *) f->R.rdi);
+		break;
+	case SYS_SHMAP:
+		f->R.rax = (uint64_t) shmap((void *) f->R.rdi, f->R.rsi);
+		break;
+	case SYS_MADVISE:
+		f->R.rax = madvise((void *) f->R.rdi, f->R.rsi, f->R.rdx);
+		break;
+	case SYS_MSYNC:
+		f->R.rax = msync((void *) f->R.rdi, f->R.rsi);
+		break;
+	case SYS_RSSLIMIT:
+		f->R.rax = rsslimit(f->R.rdi);
+		break;
+#endif
 	default:
 		exit(-1);
 		break;
 	}
 }
 
-void check_address(const uint64_t *uaddr)
+/* 사용자 문자열 UNAME을 길이 SIZE의 NAME으로 복사한다.
+   잘못된 포인터면 exit(-1), 너무 길면 false를 반환한다. */
+static bool copy_in_name(char *name, const char *uname, size_t size)
 {
-	struct thread *curr = thread_current ();
-	if (uaddr == NULL || !(is_user_vaddr(uaddr)) || pml4_get_page(curr->pml4, uaddr) == NULL)
+	int len = strncpy_from_user(name, uname, size);
+	if (len < 0)
 		exit(-1);
+	return (size_t) len < size;
+}
+
+/* SIZE 바이트 전송에 쓸 bounce buffer를 고르고 그 크기를 *CAP에 넣는다.
+   작으면 SMALL(BOUNCE_SIZE 바이트)을, 크면 SIZE를 모두 담는 page들을 써서
+   전송 한 번에 filesys_lock을 한 번만 잡게 한다. 그만한 page가 없을 때만
+   page 하나로 나눠 보낸다. */
+static void *bounce_get(void *small, size_t size, size_t *cap)
+{
+	size_t page_cnt = DIV_ROUND_UP(size, PGSIZE);
+	void *pages;
+
+	if (size > BOUNCE_SIZE) {
+		if ((pages = palloc_get_multiple(0, page_cnt)) != NULL) {
+			*cap = page_cnt * PGSIZE;
+			return pages;
+		}
+		if ((pages = palloc_get_page(0)) != NULL) {
+			*cap = PGSIZE;
+			return pages;
+		}
+	}
+	*cap = BOUNCE_SIZE;
+	return small;
+}
+
+static void bounce_put(void *bounce, void *small, size_t cap)
+{
+	if (bounce != small)
+		palloc_free_multiple(bounce, cap / PGSIZE);
+}
+
+/* 사용자 iovec 배열 IOV의 IOVCNT개 원소를 KIOV로 복사하고 길이의 합을 반환한다.
+   잘못된 포인터면 exit(-1), IOVCNT가 범위 밖이거나 합이 int를 넘으면 -1을 반환한다. */
+static long copy_in_iovec(struct iovec *kiov, const struct iovec *iov, int iovcnt)
+{
+	size_t size = 0;
+	int i;
+
+	if (iovcnt < 0 || iovcnt > IOV_MAX)
+		return -1;
+	if (!copy_from_user(kiov, iov, iovcnt * sizeof *kiov))
+		exit(-1);
+	for (i = 0; i < iovcnt; i++) {
+		if (kiov[i].iov_len > INT_MAX - size)
+			return -1;
+		size += kiov[i].iov_len;
+	}
+	return size;
+}
+
+/* 사용자 buffer들 중 다음에 채우거나 비울 곳. */
+struct iov_cursor {
+	const struct iovec *iov;
+	size_t ofs;
+};
+
+/* SRC의 N 바이트를 C가 가리키는 사용자 buffer들에 차례로 복사하고 C를 옮긴다. */
+static bool iov_copy_out(struct iov_cursor *c, const char *src, size_t n)
+{
+	while (n > 0) {
+		size_t chunk = c->iov->iov_len - c->ofs;
+
+		if (chunk == 0) {
+			c->iov++;
+			c->ofs = 0;
+			continue;
+		}
+		if (chunk > n)
+			chunk = n;
+		if (!copy_to_user((char *) c->iov->iov_base + c->ofs, src, chunk))
+			return false;
+		src += chunk;
+		c->ofs += chunk;
+		n -= chunk;
+	}
+	return true;
+}
+
+/* C가 가리키는 사용자 buffer들에서 N 바이트를 DST로 복사하고 C를 옮긴다. */
+static bool iov_copy_in(struct iov_cursor *c, char *dst, size_t n)
+{
+	while (n > 0) {
+		size_t chunk = c->iov->iov_len - c->ofs;
+
+		if (chunk == 0) {
+			c->iov++;
+			c->ofs = 0;
+			continue;
+		}
+		if (chunk > n)
+			chunk = n;
+		if (!copy_from_user(dst, (const char *) c->iov->iov_base + c->ofs, chunk))
+			return false;
+		dst += chunk;
+		c->ofs += chunk;
+		n -= chunk;
+	}
+	return true;
+}
+
+/* FILE_OBJ의 내용을 KIOV의 사용자 buffer들(합 SIZE 바이트)에 차례로 읽어 넣는다.
+   POS가 NULL이면 file position에서 읽고 그만큼 옮기며, 아니면 *POS에서 읽고
+   position은 건드리지 않는다. bounce buffer가 SIZE를 모두 담으므로 buffer가
+   몇 개든 filesys_lock은 한 번만 잡고, 사용자 buffer로는 lock 밖에서 복사한다.
+   사용자 메모리의 page fault는 frame_lock을 잡을 수 있어 lock 안에서 복사하면
+   lock 순서가 뒤집힌다. */
+static int file_readv(struct file *file_obj, const struct iovec *kiov, size_t size,
+		const off_t *pos)
+{
+	struct iov_cursor c = { kiov, 0 };
+	char small[BOUNCE_SIZE];
+	size_t cap, total;
+	char *bounce = bounce_get(small, size, &cap);
+
+	for (total = 0; total < size; ) {
+		size_t chunk = size - total < cap ? size - total : cap;
+		int n;
+
+		lock_acquire (&filesys_lock);
+		if (pos != NULL)
+			n = file_read_at(file_obj, bounce, chunk, *pos + total);
+		else
+			n = file_read(file_obj, bounce, chunk);
+		lock_release (&filesys_lock);
+
+		if (!iov_copy_out(&c, bounce, n)) {
+			bounce_put(bounce, small, cap);
+			exit(-1);
+		}
+		total += n;
+		if ((size_t) n < chunk)
+			break;
+	}
+	bounce_put(bounce, small, cap);
+	return total;
+}
+
+/* KIOV의 사용자 buffer들(합 SIZE 바이트)을 차례로 FILE_OBJ에 쓴다. POS의 뜻은
+   file_readv()와 같다. 모두 bounce buffer로 모은 뒤 filesys_lock을 한 번만
+   잡고 쓰므로 다른 쓰기와 섞이지 않는다. 표준 출력이면 console에 쓴다. */
+static int file_writev(struct file *file_obj, const struct iovec *kiov, size_t size,
+		const off_t *pos)
+{
+	struct iov_cursor c = { kiov, 0 };
+	char small[BOUNCE_SIZE];
+	size_t cap, total;
+	char *bounce = bounce_get(small, size, &cap);
+
+	for (total = 0; total < size; ) {
+		size_t chunk = size - total < cap ? size - total : cap;
+		int n = chunk;
+
+		if (!iov_copy_in(&c, bounce, chunk)) {
+			bounce_put(bounce, small, cap);
+			exit(-1);
+		}
+		if (file_obj == (struct file *) 2)
+			putbuf(bounce, chunk);
+		else {
+			lock_acquire (&filesys_lock);
+			if (pos != NULL)
+				n = file_write_at(file_obj, bounce, chunk, *pos + total);
+			else
+				n = file_write(file_obj, bounce, chunk);
+			lock_release (&filesys_lock);
+		}
+		total += n;
+		if ((size_t) n < chunk)
+			break;
+	}
+	bounce_put(bounce, small, cap);
+	return total;
 }
 
 /* PintOS를 종료한다. */
@@ -155,14 +405,22 @@ void exit(int status)
 
 bool create(const char *file, unsigned initial_size)
 {
-	check_address (file);
-	return filesys_create(file, initial_size);
+	char name[NAME_MAX + 1];
+	if (!copy_in_name(name, file, sizeof name))
+		return false;
+	return filesys_create(name, initial_size);
 }
 
 bool remove(const char *file)
 {
-	check_address (file);
-	return filesys_remove (file);
+	char name[NAME_MAX + 1];
+	if (!copy_in_name(name, file, sizeof name))
+		return false;
+	if (!filesys_remove (name))
+		return false;
+	/* 캐시된 ELF 이미지가 지워진 파일을 열어 두지 않도록 한다. */
+	elf_cache_drop_removed ();
+	return true;
 }
 
 int wait (tid_t tid)
@@ -172,16 +430,19 @@ int wait (tid_t tid)
 
 int exec(const char *file_name)
 {
-	struct thread *curr = thread_current ();
-	check_address(file_name);
-
 	// process_exec -> process_cleanup 으로 인해 f->R.rdi 날아감.  때문에 복사 후 다시 넣어줌
-	int size = strlen(file_name) + 1;
-	char *fn_copy = palloc_get_page(PAL_ZERO);
+	char *fn_copy = palloc_get_page(0);
 
 	if (fn_copy == NULL)
 		exit(-1);
-	strlcpy(fn_copy, file_name, size);	
+
+	int len = strncpy_from_user(fn_copy, file_name, PGSIZE);
+	if (len < 0 || len == PGSIZE) {
+		palloc_free_page(fn_copy);
+		if (len < 0)
+			exit(-1);
+		return -1;
+	}
 
 	if (process_exec (fn_copy) == -1)
 		return -1;
@@ -192,9 +453,10 @@ int exec(const char *file_name)
 
 int open (const char *file)
 {
-	// file이 존재하는지 항상 체크
-	check_address(file);
-	struct file *file_obj = filesys_open(file);
+	char name[NAME_MAX + 1];
+	if (!copy_in_name(name, file, sizeof name))
+		return -1;
+	struct file *file_obj = filesys_open(name);
 
 	if (file_obj == NULL)
 		return -1;
@@ -218,11 +480,8 @@ int filesize (int fd)
 
 int read (int fd, void *buffer, unsigned size)
 {
-	check_address(buffer);  /* page fault를 피하기 위해 */
-	int ret;
 	struct thread *curr = thread_current ();
 
-	
 	struct file *file_obj = process_get_file(fd);
 	if (file_obj == NULL)
 		return -1;
@@ -236,7 +495,8 @@ int read (int fd, void *buffer, unsigned size)
 		unsigned char *buf = buffer;
 		for (i = 0; i < size; i++) {
 			char c = input_getc();
-			*buf++ = c;
+			if (!copy_to_user(buf++, &c, 1))
+				exit(-1);
 			if (c == '\0')
 				break;
 		}
@@ -247,18 +507,14 @@ int read (int fd, void *buffer, unsigned size)
 		return -1;
 	}
 	
-	lock_acquire (&filesys_lock);
-	ret = file_read(file_obj, buffer, size);
-	lock_release (&filesys_lock);
-	
-	return ret;
+	/* 파일 내용은 bounce buffer로 읽은 뒤 lock 밖에서 사용자 buffer로 복사한다. */
+	struct iovec iov = { buffer, size };
+	return file_readv(file_obj, &iov, size, NULL);
 }
 
 
 int write (int fd, const void *buffer, unsigned size)
 {
-	check_address(buffer);  /* page fault를 피하기 위해 */
-	int ret;
 	struct thread *curr = thread_current ();
 
 	struct file *file_obj = process_get_file(fd);
@@ -271,20 +527,74 @@ int write (int fd, const void *buffer, unsigned size)
 			process_close_file(fd);
 			return -1;
 		}
-
-		putbuf(buffer, size);
-		return size;
 	}
-
-	if (file_obj == 1) {
+	else if (file_obj == 1) {
 		return -1;
 	}
-	
-	lock_acquire (&filesys_lock);
-	ret = file_write(file_obj, buffer, size);
-	lock_release (&filesys_lock);
-	
-	return ret;
+
+	/* 사용자 buffer를 bounce buffer로 복사한 뒤 쓴다. */
+	struct iovec iov = { (void *) buffer, size };
+	return file_writev(file_obj, &iov, size, NULL);
+}
+
+/* fd의 파일을 offset부터 size 바이트 buffer로 읽는다. file position은 바꾸지
+ * 않으므로 dup된 fd를 함께 쓰는 쪽과 섞이지 않는다. 읽은 바이트 수를,
+ * 실패하면 -1을 반환한다. */
+int pread (int fd, void *buffer, unsigned size, off_t offset)
+{
+	struct file *file_obj = process_get_file(fd);
+	struct iovec iov = { buffer, size };
+
+	if (file_obj == NULL || file_obj <= (struct file *) 2 || offset < 0
+			|| size > INT_MAX)
+		return -1;
+	return file_readv(file_obj, &iov, size, &offset);
+}
+
+/* buffer의 size 바이트를 fd의 파일 offset부터 쓴다. file position은 바꾸지
+ * 않는다. 쓴 바이트 수를, 실패하면 -1을 반환한다. */
+int pwrite (int fd, const void *buffer, unsigned size, off_t offset)
+{
+	struct file *file_obj = process_get_file(fd);
+	struct iovec iov = { (void *) buffer, size };
+
+	if (file_obj == NULL || file_obj <= (struct file *) 2 || offset < 0
+			|| size > INT_MAX)
+		return -1;
+	return file_writev(file_obj, &iov, size, &offset);
+}
+
+/* fd의 파일을 iov의 iovcnt개 buffer에 차례로 읽어 넣는다. 한 번의 read처럼
+ * file position에서 읽고 그만큼 옮긴다. 읽은 바이트 수를, 실패하면 -1을
+ * 반환한다. */
+int readv (int fd, const struct iovec *iov, int iovcnt)
+{
+	struct iovec kiov[IOV_MAX];
+	struct file *file_obj = process_get_file(fd);
+	long size;
+
+	if (file_obj == NULL || file_obj <= (struct file *) 2)
+		return -1;
+	size = copy_in_iovec(kiov, iov, iovcnt);
+	if (size < 0)
+		return -1;
+	return file_readv(file_obj, kiov, size, NULL);
+}
+
+/* iov의 iovcnt개 buffer를 차례로 fd에 쓴다. 한 번의 write처럼 file position에
+ * 쓰고 그만큼 옮긴다. 쓴 바이트 수를, 실패하면 -1을 반환한다. */
+int writev (int fd, const struct iovec *iov, int iovcnt)
+{
+	struct iovec kiov[IOV_MAX];
+	struct file *file_obj = process_get_file(fd);
+	long size;
+
+	if (file_obj == NULL || file_obj == (struct file *) 1)
+		return -1;
+	size = copy_in_iovec(kiov, iov, iovcnt);
+	if (size < 0)
+		return -1;
+	return file_writev(file_obj, kiov, size, NULL);
 }
 
 void seek (int fd, unsigned position)
@@ -326,6 +636,8 @@ void close (int fd)
 	
 	if (fd <= 1 || file_obj <= 2)
 		return;
+	/* syscall ring에서 처리 중인 요청이 이 파일을 쓰고 있을 수 있다. */
+	ring_quiesce();
 	process_close_file(fd);
 
 	if (file_obj->dupCount == 0)
@@ -336,7 +648,10 @@ void close (int fd)
 
 tid_t fork (const char *thread_name, struct intr_frame *if_)
 {
-	return process_fork (thread_name, if_);
+	char name[16];	/* struct thread의 name 크기 */
+	if (!copy_in_name(name, thread_name, sizeof name))
+		name[sizeof name - 1] = '\0';
+	return process_fork (name, if_);
 }
 
 int dup2 (int oldfd, int newfd)
@@ -368,6 +683,107 @@ int dup2 (int oldfd, int newfd)
 	return newfd;
 }
 
+/* file의 프로그램을 새 프로세스로 실행한다. fork와 달리 현재 프로세스의
+ * 주소 공간을 복사하지 않는다. 자식은 file descriptor를 물려받은 뒤
+ * actions(SPAWN_END로 끝나며, NULL이면 없음)를 순서대로 적용한다.
+ * 자식의 pid를, 실패하면 -1을 반환한다. */
+tid_t spawn (const char *file, const struct spawn_action *actions)
+{
+	struct spawn_action kactions[SPAWN_ACTIONS_MAX];
+	size_t cnt = 0;
+
+	if (actions != NULL)
+		for (;; cnt++) {
+			if (cnt == SPAWN_ACTIONS_MAX)
+				return -1;
+			if (!copy_from_user(&kactions[cnt], &actions[cnt], sizeof kactions[cnt]))
+				exit(-1);
+			if (kactions[cnt].op == SPAWN_END)
+				break;
+		}
+
+	char *cmd_line = palloc_get_page(0);
+	if (cmd_line == NULL)
+		return -1;
+
+	int len = strncpy_from_user(cmd_line, file, PGSIZE);
+	if (len < 0 || len == PGSIZE) {
+		palloc_free_page(cmd_line);
+		if (len < 0)
+			exit(-1);
+		return -1;
+	}
+
+	return process_spawn(cmd_line, kactions, cnt);
+}
+
+/* 사용자 메모리의 ring을 이 프로세스의 syscall ring으로 등록한다.
+ * 성공하면 0, 이미 등록했거나 실패하면 -1을 반환한다. */
+int ring_setup (struct io_ring *ring)
+{
+	return do_ring_setup(ring);
+}
+
+/* ring의 요청을 최대 to_submit개 넘기고, 완료를 최소 min_complete개 올릴
+ * 때까지 기다린다(처리 중인 요청이 없거나 완료 queue가 차면 더 기다리지
+ * 않는다). 넘긴 요청 수를, ring이 없으면 -1을 반환한다. */
+int ring_enter (unsigned to_submit, unsigned min_complete)
+{
+	return do_ring_enter(to_submit, min_complete);
+}
+
+#ifdef VM
+/* fd의 파일을 addr에 매핑한다. 실패하면 NULL(MAP_FAILED)을 반환한다. */
+void *mmap (void *addr, size_t length, int writable, int fd, off_t offset)
+{
+	struct file *file_obj = process_get_file(fd);
+
+	if (file_obj == NULL || file_obj <= 2)
+		return NULL;
+	if (addr == NULL || pg_ofs(addr) != 0 || offset < 0 || pg_ofs(offset) != 0)
+		return NULL;
+	if (length == 0 || file_length(file_obj) == 0)
+		return NULL;
+
+	return do_mmap(addr, length, writable, file_obj, offset);
+}
+
+void munmap (void *addr)
+{
+	do_munmap(addr);
+}
+
+/* addr에 length 바이트의 익명 공유 메모리를 매핑한다. 이후 fork된 자식과
+ * 공유된다. 실패하면 NULL(MAP_FAILED)을 반환한다. */
+void *shmap (void *addr, size_t length)
+{
+	if (addr == NULL || pg_ofs(addr) != 0 || length == 0)
+		return NULL;
+
+	return do_shmap(addr, length);
+}
+
+/* addr부터 length 바이트의 메모리를 어떻게 쓸지 알린다(MADV_*).
+ * 성공하면 0, 실패하면 -1을 반환한다. */
+int madvise (void *addr, size_t length, int advice)
+{
+	return do_madvise(addr, length, advice) ? 0 : -1;
+}
+
+/* addr부터 length 바이트 안의 파일 매핑 중 수정된 페이지를 파일에 쓴다.
+ * 성공하면 0, 실패하면 -1을 반환한다. */
+int msync (void *addr, size_t length)
+{
+	return do_msync(addr, length) ? 0 : -1;
+}
+
+/* 이 프로세스가 메모리에 둘 수 있는 페이지 수를 pages로 제한한다(0이면 제한 없음).
+ * 이후 fork된 자식도 같은 제한을 물려받는다. 이전 제한을 반환한다. */
+size_t rsslimit (size_t pages)
+{
+	return vm_set_rss_limit(pages);
+}
+#endif
 
 int process_add_file (struct file *f)
 {
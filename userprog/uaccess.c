@@ -0,0 +1,124 @@
+#include "userprog/uaccess.h"
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/vaddr.h"
+
+/* Bounds of the exception table, from kernel.lds.S. */
+extern const struct exception_table_entry _start_ex_table[], _end_ex_table[];
+
+/* Records the instruction at local label INSN as one that may
+   fault on a user address, to be resumed at local label FIXUP. */
+#define EX_TABLE(INSN, FIXUP)                  \
+	".pushsection __ex_table, \"a\"\n"         \
+	".balign 8\n"                              \
+	".quad " INSN ", " FIXUP "\n"              \
+	".popsection\n"
+
+/* strncpy_from_user() copies at most this many bytes at a time.
+   Chunks are aligned to their size, so a chunk never spans two
+   pages and the copy never reads far past the terminator. */
+#define STRING_CHUNK 64
+
+/* Returns true if [UADDR, UADDR + SIZE) lies entirely in user
+   space. */
+static bool
+user_range_ok (const void *uaddr, size_t size) {
+	uintptr_t start = (uintptr_t) uaddr;
+	return start + size >= start && start + size <= KERN_BASE;
+}
+
+/* Copies SIZE bytes from SRC to DST, either of which may be a
+   user address.  Returns the number of bytes left uncopied, which
+   is nonzero only if the copy faulted.  On a fault page_fault()
+   resumes at label 2 with RCX still holding the remaining count,
+   and clobbers RAX. */
+static size_t
+copy_raw (void *dst, const void *src, size_t size) {
+	asm volatile ("1: rep movsb\n"
+			"2:\n"
+			EX_TABLE ("1b", "2b")
+			: "+D" (dst), "+S" (src), "+c" (size)
+			: : "rax", "memory");
+	return size;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel buffer DST.
+   Returns true if successful, false if USRC does not point to
+   SIZE bytes of readable user memory. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t size) {
+	if (!user_range_ok (usrc, size))
+		return false;
+	return copy_raw (dst, usrc, size) == 0;
+}
+
+/* Copies SIZE bytes from kernel buffer SRC to user address UDST.
+   Returns true if successful, false if UDST does not point to
+   SIZE bytes of writable user memory. */
+bool
+copy_to_user (void *udst, const void *src, size_t size) {
+	if (!user_range_ok (udst, size))
+		return false;
+	return copy_raw (udst, src, size) == 0;
+}
+
+/* Returns true if SIZE bytes at user address UADDR are all mapped
+   readable and writable, checking each page by reading a byte and
+   writing it back. */
+bool
+user_range_writable (void *uaddr, size_t size) {
+	uint8_t *p = uaddr, *end = p + size;
+	uint8_t byte;
+
+	if (!user_range_ok (uaddr, size))
+		return false;
+	for (; p < end; p = (uint8_t *) pg_round_down (p) + PGSIZE)
+		if (copy_raw (&byte, p, 1) != 0 || copy_raw (p, &byte, 1) != 0)
+			return false;
+	return true;
+}
+
+/* Copies the null-terminated string at user address USRC into
+   DST, which holds SIZE bytes.  Returns the length of the string,
+   not counting the null terminator, if it fits in SIZE bytes.
+   Returns SIZE, leaving DST unterminated, if the string is
+   longer than that.  Returns -1 if USRC is not a readable user
+   string. */
+int
+strncpy_from_user (char *dst, const char *usrc, size_t size) {
+	size_t copied = 0;
+
+	while (copied < size) {
+		const char *src = usrc + copied;
+		size_t chunk = STRING_CHUNK - ((uintptr_t) src & (STRING_CHUNK - 1));
+		char *nul;
+
+		if (chunk > size - copied)
+			chunk = size - copied;
+		if (!is_user_vaddr (src) || copy_raw (dst + copied, src, chunk) != 0)
+			return -1;
+
+		nul = memchr (dst + copied, '\0', chunk);
+		if (nul != NULL)
+			return nul - dst;
+		copied += chunk;
+	}
+	return size;
+}
+
+/* Called by page_fault() for a fault in kernel context.  If the
+   faulting instruction is in the exception table, redirects F to
+   resume at its fixup with RAX set to -1 and returns true.
+   Otherwise returns false. */
+bool
+uaccess_fixup (struct intr_frame *f) {
+	const struct exception_table_entry *e;
+
+	for (e = _start_ex_table; e < _end_ex_table; e++)
+		if (e->insn == f->rip) {
+			f->rip = e->fixup;
+			f->R.rax = -1;
+			return true;
+		}
+	return false;
+}
@@ -1,7 +1,17 @@
 /* anon.c: Implementation of page for non-disk image (a.k.a. anonymous page). */
 
 #include "vm/vm.h"
+#include <bitmap.h>
+#include <string.h>
 #include "devices/disk.h"
+#include "devices/timer.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/zswap.h"
+
+/* Number of swap disk sectors per page. */
+#define SECTORS_PER_PAGE (PGSIZE / DISK_SECTOR_SIZE)
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -17,36 +27,360 @@ static const struct page_operations anon_ops = {
 	.type = VM_ANON,
 };
 
+/* Swap slots in use, one page-sized slot per bit, and the number of
+ * pages referring to each slot, which is more than one for a page
+ * shared copy-on-write.  Null if there is no swap disk. */
+static struct bitmap *swap_slots;
+static uint16_t *swap_refs;
+static struct lock swap_lock;
+
+/* Where to look for free slots next.  Allocating onward from the last
+ * allocation keeps clusters written one after another next to each
+ * other. */
+static size_t swap_hint;
+
 /* Initialize the data for anonymous pages */
 void
 vm_anon_init (void) {
-	/* TODO: Set up the swap_disk. */
-	swap_disk = NULL;
+	swap_disk = disk_get (1, 1);
+	lock_init (&swap_lock);
+	if (swap_disk != NULL) {
+		size_t slot_cnt = disk_size (swap_disk) / SECTORS_PER_PAGE;
+
+		swap_slots = bitmap_create (slot_cnt);
+		swap_refs = calloc (slot_cnt, sizeof *swap_refs);
+		if (swap_slots == NULL || swap_refs == NULL)
+			PANIC ("vm_anon_init: out of memory for the swap map");
+		zswap_init ();
+	}
 }
 
 /* Initialize the file mapping */
 bool
-anon_initializer (struct page *page, enum vm_type type, void *kva) {
+anon_initializer (struct page *page, enum vm_type type UNUSED, void *kva UNUSED) {
 	/* Set up the handler */
 	page->operations = &anon_ops;
 
-	struct anon_page *anon_page = &page->anon;
+	page->anon.swap_slot = SWAP_SLOT_NONE;
+	page->anon.lazy_free = false;
+	return true;
+}
+
+/* Allocates up to *CNT contiguous swap slots, preferring *CNT but
+ * settling for fewer if swap is fragmented.  Returns the first slot and
+ * stores the number allocated in *CNT, or returns BITMAP_ERROR if swap
+ * is full. */
+static size_t
+swap_alloc (size_t *cnt) {
+	size_t slot = BITMAP_ERROR;
+
+	lock_acquire (&swap_lock);
+	for (; *cnt > 0; *cnt /= 2) {
+		slot = bitmap_scan_and_flip (swap_slots, swap_hint, *cnt, false);
+		if (slot == BITMAP_ERROR)
+			slot = bitmap_scan_and_flip (swap_slots, 0, *cnt, false);
+		if (slot != BITMAP_ERROR) {
+			swap_hint = slot + *cnt;
+			break;
+		}
+	}
+	lock_release (&swap_lock);
+	return slot;
+}
+
+/* Drops a reference to swap slot SLOT, returning it to the free pool
+ * if that was the last one. */
+static void
+swap_unref (size_t slot) {
+	lock_acquire (&swap_lock);
+	if (--swap_refs[slot] == 0) {
+		zswap_invalidate (slot);
+		bitmap_reset (swap_slots, slot);
+	}
+	lock_release (&swap_lock);
+}
+
+/* Reads the PAGE_CNT slots starting at SLOT into the pages at KVAS[],
+ * in one transfer. */
+static void
+swap_read (size_t slot, void *const kvas[], size_t page_cnt) {
+	void *sectors[SWAP_CLUSTER * SECTORS_PER_PAGE];
+	int64_t start = timer_ticks ();
+	size_t i;
+
+	ASSERT (page_cnt <= SWAP_CLUSTER);
+	for (i = 0; i < page_cnt * SECTORS_PER_PAGE; i++)
+		sectors[i] = (uint8_t *) kvas[i / SECTORS_PER_PAGE]
+			+ i % SECTORS_PER_PAGE * DISK_SECTOR_SIZE;
+	disk_readv (swap_disk, slot * SECTORS_PER_PAGE, sectors,
+			page_cnt * SECTORS_PER_PAGE);
+	vm_stats.swap_reads++;
+	vm_stats.swap_ins += page_cnt;
+	vm_stats.swap_ticks += timer_elapsed (start);
+}
+
+/* Writes the pages at KVAS[] to the PAGE_CNT slots starting at SLOT, in
+ * one transfer. */
+void
+swap_write (size_t slot, const void *const kvas[], size_t page_cnt) {
+	const void *sectors[SWAP_CLUSTER * SECTORS_PER_PAGE];
+	int64_t start = timer_ticks ();
+	size_t i;
+
+	ASSERT (page_cnt <= SWAP_CLUSTER);
+	for (i = 0; i < page_cnt * SECTORS_PER_PAGE; i++)
+		sectors[i] = (const uint8_t *) kvas[i / SECTORS_PER_PAGE]
+			+ i % SECTORS_PER_PAGE * DISK_SECTOR_SIZE;
+	disk_writev (swap_disk, slot * SECTORS_PER_PAGE, sectors,
+			page_cnt * SECTORS_PER_PAGE);
+	vm_stats.swap_writes++;
+	vm_stats.swap_outs += page_cnt;
+	vm_stats.swap_ticks += timer_elapsed (start);
+}
+
+/* Reads the PAGE_CNT slots starting at SLOT into the pages at KVAS[].
+ * Slots held by the compressed cache come from there; the rest are read
+ * from disk, each run of adjacent slots in one transfer. */
+static void
+swap_load (size_t slot, void *const kvas[], size_t page_cnt) {
+	size_t i, run = 0;
+
+	for (i = 0; i <= page_cnt; i++) {
+		if (i < page_cnt && !zswap_load (slot + i, kvas[i])) {
+			run++;
+			continue;
+		}
+		if (run > 0)
+			swap_read (slot + i - run, kvas + i - run, run);
+		run = 0;
+	}
+}
+
+/* Stores the frames FRAMES[] in the PAGE_CNT slots starting at SLOT,
+ * like swap_load() in reverse. */
+static void
+swap_store (size_t slot, struct frame *const frames[], size_t page_cnt) {
+	const void *kvas[SWAP_CLUSTER];
+	size_t i, run = 0;
+
+	ASSERT (page_cnt <= SWAP_CLUSTER);
+	for (i = 0; i <= page_cnt; i++) {
+		if (i < page_cnt && !zswap_store (slot + i, frames[i]->kva)) {
+			kvas[run++] = frames[i]->kva;
+			continue;
+		}
+		if (run > 0)
+			swap_write (slot + i - run, kvas, run);
+		run = 0;
+	}
+}
+
+/* Returns true if frame A's page comes before frame B's, ordering by
+ * process and then by address. */
+static bool
+frame_less (const struct frame *a, const struct frame *b) {
+	if (a->page->owner != b->page->owner)
+		return a->page->owner < b->page->owner;
+	return a->page->va < b->page->va;
+}
+
+/* Writes the CNT frames FRAMES[], which hold anonymous pages and are
+ * unmapped, to swap.  Frames are sorted by process and address first,
+ * so that pages adjacent in memory land in adjacent slots, and written
+ * in as few transfers as free space allows.  Every page sharing a frame
+ * goes out with it, to the same slot.  Returns the number of frames
+ * written, which are the first ones in FRAMES[]; fewer than CNT only if
+ * swap fills up.  The caller must hold the frame table lock. */
+size_t
+anon_swap_out_cluster (struct frame *frames[], size_t cnt) {
+	size_t done = 0;
+	size_t i, j;
+
+	ASSERT (cnt <= SWAP_CLUSTER);
+
+	if (swap_slots == NULL)
+		return 0;
+
+	for (i = 1; i < cnt; i++) {
+		struct frame *frame = frames[i];
+
+		for (j = i; j > 0 && frame_less (frame, frames[j - 1]); j--)
+			frames[j] = frames[j - 1];
+		frames[j] = frame;
+	}
+
+	while (done < cnt) {
+		size_t run = cnt - done;
+		size_t slot = swap_alloc (&run);
+
+		if (slot == BITMAP_ERROR)
+			break;
+		swap_store (slot, frames + done, run);
+		for (i = 0; i < run; i++) {
+			struct frame *frame = frames[done + i];
+			struct list_elem *e;
+
+			swap_refs[slot + i] = frame->page_cnt;
+			for (e = list_begin (&frame->pages); e != list_end (&frame->pages);
+					e = list_next (e))
+				list_entry (e, struct page, frame_elem)->anon.swap_slot = slot + i;
+		}
+		done += run;
+	}
+	return done;
+}
+
+/* Returns the page DELTA pages away from PAGE, if it is an anonymous
+ * page of the same region that was swapped out DELTA slots away from
+ * PAGE, so it can be read in with PAGE.  Otherwise returns a null
+ * pointer. */
+static struct page *
+swap_neighbor (struct page *page, long delta) {
+	uint8_t *va = (uint8_t *) page->va + delta * PGSIZE;
+	long slot = (long) page->anon.swap_slot + delta;
+	struct page *n;
+
+	if (va < (uint8_t *) page->vma->start || va >= (uint8_t *) page->vma->end
+			|| slot < 0 || (size_t) slot >= bitmap_size (swap_slots))
+		return NULL;
+	n = spt_lookup_page (&page->owner->spt, va);
+	if (n == NULL || VM_TYPE (n->operations->type) != VM_ANON
+			|| n->frame != NULL || n->anon.swap_slot != (size_t) slot)
+		return NULL;
+	return n;
 }
 
-/* Swap in the page by read contents from the swap disk. */
+/* Swap in the page by read contents from the swap disk.  Neighbouring
+ * pages of the same region that were swapped out alongside it are read
+ * in the same transfer and mapped too, as far as free frames allow. */
 static bool
 anon_swap_in (struct page *page, void *kva) {
-	struct anon_page *anon_page = &page->anon;
+	struct page *pages[SWAP_CLUSTER];
+	struct frame *frames[SWAP_CLUSTER];
+	void *kvas[SWAP_CLUSTER];
+	size_t before = 0, after = 0;
+	size_t first, cnt, i;
+
+	if (page->anon.swap_slot == SWAP_SLOT_NONE)
+		return false;
+	if (page->anon.swap_slot == SWAP_SLOT_ZERO) {
+		memset (kva, 0, PGSIZE);
+		page->anon.swap_slot = SWAP_SLOT_NONE;
+		return true;
+	}
+
+	/* Gather the run of slots around PAGE's: pages after it go at the
+	 * front of PAGES[] for now, pages before it at the back. */
+	while (1 + before + after < SWAP_CLUSTER) {
+		struct page *n = swap_neighbor (page, after + 1);
+		struct frame *frame;
+
+		if (n == NULL || (frame = vm_get_frame_nowait ()) == NULL)
+			break;
+		pages[after] = n;
+		frames[after++] = frame;
+	}
+	while (1 + before + after < SWAP_CLUSTER) {
+		struct page *n = swap_neighbor (page, -(long) before - 1);
+		struct frame *frame;
+
+		if (n == NULL || (frame = vm_get_frame_nowait ()) == NULL)
+			break;
+		pages[SWAP_CLUSTER - 1 - before] = n;
+		frames[SWAP_CLUSTER - 1 - before++] = frame;
+	}
+
+	/* Lay the run out in slot order. */
+	cnt = 1 + before + after;
+	first = page->anon.swap_slot - before;
+	for (i = 0; i < before; i++)
+		kvas[i] = frames[SWAP_CLUSTER - before + i]->kva;
+	kvas[before] = kva;
+	for (i = 0; i < after; i++)
+		kvas[before + 1 + i] = frames[i]->kva;
+	swap_load (first, kvas, cnt);
+
+	swap_unref (page->anon.swap_slot);
+	page->anon.swap_slot = SWAP_SLOT_NONE;
+
+	/* Map the neighbours.  One that cannot be mapped stays in swap. */
+	for (i = 0; i < SWAP_CLUSTER; i++) {
+		struct page *n;
+
+		if (i >= after && i < SWAP_CLUSTER - before)
+			continue;
+		n = pages[i];
+		if (vm_install_frame (n, frames[i])) {
+			swap_unref (n->anon.swap_slot);
+			n->anon.swap_slot = SWAP_SLOT_NONE;
+		}
+	}
+	return true;
 }
 
-/* Swap out the page by writing contents to the swap disk. */
+/* Swap out the page by writing contents to the swap disk.  Every page
+ * sharing PAGE's frame is swapped out with it, to the same slot. */
 static bool
 anon_swap_out (struct page *page) {
-	struct anon_page *anon_page = &page->anon;
+	struct frame *frame = page->frame;
+
+	return anon_swap_out_cluster (&frame, 1) == 1;
+}
+
+/* Makes anonymous page PAGE share SRC's swap slot, if it has one.
+ * Used to share a swapped-out page copy-on-write on fork.  A page that
+ * reads as zeros stays that way, with nothing to share.  The caller
+ * must hold the frame table lock. */
+void
+anon_swap_share (struct page *page, struct page *src) {
+	page->anon.swap_slot = src->anon.swap_slot;
+	if (page->anon.swap_slot != SWAP_SLOT_NONE
+			&& page->anon.swap_slot != SWAP_SLOT_ZERO) {
+		lock_acquire (&swap_lock);
+		swap_refs[page->anon.swap_slot]++;
+		lock_release (&swap_lock);
+	}
+}
+
+/* Writes the page at KVA to a swap slot of its own and returns the
+ * slot, or SWAP_SLOT_NONE if swap is full.  For memory that outlives
+ * the pages mapping it, such as a shared memory object's; the slot is
+ * released by anon_swap_restore() or anon_swap_discard(). */
+size_t
+anon_swap_save (const void *kva) {
+	size_t cnt = 1;
+	size_t slot;
+
+	if (swap_slots == NULL || (slot = swap_alloc (&cnt)) == BITMAP_ERROR)
+		return SWAP_SLOT_NONE;
+	if (!zswap_store (slot, kva))
+		swap_write (slot, &kva, 1);
+	swap_refs[slot] = 1;
+	return slot;
+}
+
+/* Reads SLOT, from anon_swap_save(), into KVA and releases it. */
+void
+anon_swap_restore (size_t slot, void *kva) {
+	swap_load (slot, &kva, 1);
+	swap_unref (slot);
+}
+
+/* Releases SLOT, from anon_swap_save(), unread. */
+void
+anon_swap_discard (size_t slot) {
+	swap_unref (slot);
 }
 
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+
+	vm_frame_lock ();
+	vm_release_frame (page);
+	vm_frame_unlock ();
+	if (anon_page->swap_slot != SWAP_SLOT_NONE
+			&& anon_page->swap_slot != SWAP_SLOT_ZERO)
+		swap_unref (anon_page->swap_slot);
 }
@@ -0,0 +1,392 @@
+/* evict.c: Page replacement policies for the frame table. */
+
+#include "vm/evict.h"
+#include <hash.h>
+#include <list.h>
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "vm/vm.h"
+
+/* Returns whether user code has touched any page mapping FRAME since
+ * the last call, and clears their accessed bits. */
+static bool
+frame_test_and_clear_accessed (struct frame *frame) {
+	bool accessed = false;
+	struct list_elem *e;
+
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+		uint64_t *pml4 = page->owner->pml4;
+
+		if (pml4_is_accessed (pml4, page->va)) {
+			pml4_set_accessed (pml4, page->va, false);
+			accessed = true;
+		}
+	}
+	return accessed;
+}
+
+/* Returns whether evicting FRAME means writing its page out.  Anonymous
+ * pages have nowhere to go but swap, so only an unmodified file page is
+ * clean. */
+static bool
+frame_is_dirty (struct frame *frame) {
+	struct page *page = frame->page;
+
+	if (frame->slot != NULL)
+		return frame->slot->shm->file == NULL || frame->slot->dirty;
+	return VM_TYPE (page->operations->type) != VM_FILE
+		|| pml4_is_dirty (page->owner->pml4, page->va);
+}
+
+/* A circular list of frames swept by a clock hand. */
+struct ring {
+	struct list frames;
+	struct list_elem *hand;      /* Next frame to examine. */
+	size_t frame_cnt;
+};
+
+static void
+ring_init (struct ring *r) {
+	list_init (&r->frames);
+	r->hand = list_end (&r->frames);
+	r->frame_cnt = 0;
+}
+
+/* Inserts FRAME just behind the hand, so it is examined last. */
+static void
+ring_insert (struct ring *r, struct frame *frame) {
+	list_insert (r->hand, &frame->elem);
+	r->frame_cnt++;
+}
+
+static void
+ring_remove (struct ring *r, struct frame *frame) {
+	if (r->hand == &frame->elem)
+		r->hand = list_next (r->hand);
+	list_remove (&frame->elem);
+	r->frame_cnt--;
+}
+
+/* Moves FRAME, which is in R, under the hand, so it is examined next. */
+static void
+ring_cold (struct ring *r, struct frame *frame) {
+	ring_remove (r, frame);
+	list_insert (r->hand, &frame->elem);
+	r->hand = &frame->elem;
+	r->frame_cnt++;
+}
+
+/* Returns the frame under the hand and moves the hand past it.  R must
+ * not be empty. */
+static struct frame *
+ring_advance (struct ring *r) {
+	struct frame *frame;
+
+	if (r->hand == list_end (&r->frames))
+		r->hand = list_begin (&r->frames);
+	frame = list_entry (r->hand, struct frame, elem);
+	r->hand = list_next (r->hand);
+	return frame;
+}
+
+/* Second chance: sweeps R for a frame whose page has not been touched
+ * since the hand last passed, clearing accessed bits on the way.  Two
+ * sweeps always suffice unless user code keeps touching pages behind
+ * the hand, so the search gives up after that and takes what it has. */
+static struct frame *
+ring_second_chance (struct ring *r) {
+	struct frame *frame = NULL;
+	size_t i;
+
+	if (r->frame_cnt == 0)
+		return NULL;
+	for (i = 0; i < 2 * r->frame_cnt; i++) {
+		frame = ring_advance (r);
+		if (!frame_test_and_clear_accessed (frame))
+			break;
+	}
+	ring_remove (r, frame);
+	return frame;
+}
+
+/* Clock. */
+
+static struct ring clock_ring;
+
+static void
+clock_init (size_t frame_cnt UNUSED) {
+	ring_init (&clock_ring);
+}
+
+static void
+clock_add (struct frame *frame) {
+	ring_insert (&clock_ring, frame);
+}
+
+static void
+clock_remove (struct frame *frame) {
+	ring_remove (&clock_ring, frame);
+}
+
+static struct frame *
+clock_victim (void) {
+	return ring_second_chance (&clock_ring);
+}
+
+static void
+clock_cold (struct frame *frame) {
+	ring_cold (&clock_ring, frame);
+}
+
+const struct evict_policy clock_policy = {
+	.name = "clock",
+	.init = clock_init,
+	.add = clock_add,
+	.remove = clock_remove,
+	.victim = clock_victim,
+	.cold = clock_cold,
+};
+
+/* WSClock.  Like clock, but an untouched page that must be written out
+ * is passed over in favour of one that can simply be dropped.  The
+ * original algorithm schedules the write and keeps sweeping; evictions
+ * here are synchronous, so if a full sweep finds no clean page the
+ * first untouched dirty page it saw is taken instead. */
+
+static struct ring wsclock_ring;
+
+static void
+wsclock_init (size_t frame_cnt UNUSED) {
+	ring_init (&wsclock_ring);
+}
+
+static void
+wsclock_add (struct frame *frame) {
+	ring_insert (&wsclock_ring, frame);
+}
+
+static void
+wsclock_remove (struct frame *frame) {
+	ring_remove (&wsclock_ring, frame);
+}
+
+static struct frame *
+wsclock_victim (void) {
+	struct ring *r = &wsclock_ring;
+	struct frame *victim = NULL;
+	struct frame *dirty = NULL;
+	size_t i;
+
+	if (r->frame_cnt == 0)
+		return NULL;
+	for (i = 0; i < 2 * r->frame_cnt && victim == NULL; i++) {
+		struct frame *frame = ring_advance (r);
+
+		if (frame_test_and_clear_accessed (frame))
+			continue;
+		if (!frame_is_dirty (frame))
+			victim = frame;
+		else if (dirty == NULL)
+			dirty = frame;
+	}
+	if (victim == NULL)
+		victim = dirty != NULL ? dirty : ring_advance (r);
+	ring_remove (r, victim);
+	return victim;
+}
+
+static void
+wsclock_cold (struct frame *frame) {
+	ring_cold (&wsclock_ring, frame);
+}
+
+const struct evict_policy wsclock_policy = {
+	.name = "wsclock",
+	.init = wsclock_init,
+	.add = wsclock_add,
+	.remove = wsclock_remove,
+	.victim = wsclock_victim,
+	.cold = wsclock_cold,
+};
+
+/* 2Q (Johnson and Shasha).  A page brought in for the first time goes
+ * on A1in, a FIFO holding about a quarter of memory.  Pages leaving A1in
+ * are remembered, without their contents, on the ghost queue A1out.
+ * Only a page faulted in again while remembered there is promoted to
+ * Am, which is managed by second chance.  A single pass over a large
+ * region therefore cycles through A1in without disturbing Am.  Frames
+ * known to be cold are kept apart and taken before either queue. */
+
+enum twoq_queue {
+	TWOQ_A1IN = 1,
+	TWOQ_AM = 2,
+	TWOQ_COLD = 3,
+};
+
+/* A page remembered on A1out, by the id of the process that had it,
+ * which unlike its struct thread is never reused. */
+struct ghost {
+	tid_t tid;
+	void *va;
+	struct hash_elem hash_elem;  /* Element in ghost_table. */
+	struct list_elem list_elem;  /* Element in ghost_fifo. */
+};
+
+static struct list a1in;
+static size_t a1in_cnt, a1in_max;
+static struct list twoq_cold_list;
+static struct ring am;
+static struct hash ghost_table;
+static struct list ghost_fifo;
+static size_t ghost_max;
+
+static uint64_t
+ghost_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct ghost *g = hash_entry (e, struct ghost, hash_elem);
+
+	return hash_int (g->tid) ^ hash_bytes (&g->va, sizeof g->va);
+}
+
+static bool
+ghost_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct ghost *a = hash_entry (a_, struct ghost, hash_elem);
+	const struct ghost *b = hash_entry (b_, struct ghost, hash_elem);
+
+	if (a->tid != b->tid)
+		return a->tid < b->tid;
+	return a->va < b->va;
+}
+
+/* Removes and returns the ghost of FRAME's page, or a null pointer.
+ * A frame no page maps has none. */
+static struct ghost *
+ghost_take (struct frame *frame) {
+	struct ghost probe;
+	struct hash_elem *e;
+	struct ghost *g;
+
+	if (frame->page == NULL)
+		return NULL;
+	probe.tid = frame->page->owner->tid;
+	probe.va = frame->page->va;
+	e = hash_delete (&ghost_table, &probe.hash_elem);
+	if (e == NULL)
+		return NULL;
+	g = hash_entry (e, struct ghost, hash_elem);
+	list_remove (&g->list_elem);
+	return g;
+}
+
+/* Remembers FRAME's page on A1out, forgetting the oldest ghost if A1out
+ * is full.  A frame no page maps is not remembered. */
+static void
+ghost_remember (struct frame *frame) {
+	struct ghost *g;
+
+	if (frame->page == NULL)
+		return;
+	if (hash_size (&ghost_table) >= ghost_max) {
+		g = list_entry (list_pop_front (&ghost_fifo), struct ghost, list_elem);
+		hash_delete (&ghost_table, &g->hash_elem);
+	} else if ((g = malloc (sizeof *g)) == NULL)
+		return;
+
+	g->tid = frame->page->owner->tid;
+	g->va = frame->page->va;
+	if (hash_insert (&ghost_table, &g->hash_elem) != NULL) {
+		free (g);
+		return;
+	}
+	list_push_back (&ghost_fifo, &g->list_elem);
+}
+
+/* Forgets the ghosts of process TID, whose pages are gone. */
+static void
+ghost_forget (tid_t tid) {
+	struct list_elem *e, *next;
+
+	for (e = list_begin (&ghost_fifo); e != list_end (&ghost_fifo); e = next) {
+		struct ghost *g = list_entry (e, struct ghost, list_elem);
+
+		next = list_next (e);
+		if (g->tid == tid) {
+			list_remove (&g->list_elem);
+			hash_delete (&ghost_table, &g->hash_elem);
+			free (g);
+		}
+	}
+}
+
+static void
+twoq_init (size_t frame_cnt) {
+	list_init (&a1in);
+	list_init (&twoq_cold_list);
+	a1in_cnt = 0;
+	a1in_max = frame_cnt / 4 > 0 ? frame_cnt / 4 : 1;
+	ring_init (&am);
+	hash_init (&ghost_table, ghost_hash, ghost_less, NULL);
+	list_init (&ghost_fifo);
+	ghost_max = frame_cnt / 2 > 0 ? frame_cnt / 2 : 1;
+}
+
+static void
+twoq_add (struct frame *frame) {
+	struct ghost *g = ghost_take (frame);
+
+	if (g != NULL) {
+		free (g);
+		frame->queue = TWOQ_AM;
+		ring_insert (&am, frame);
+	} else {
+		frame->queue = TWOQ_A1IN;
+		list_push_back (&a1in, &frame->elem);
+		a1in_cnt++;
+	}
+}
+
+static void
+twoq_remove (struct frame *frame) {
+	if (frame->queue == TWOQ_AM)
+		ring_remove (&am, frame);
+	else if (frame->queue == TWOQ_COLD)
+		list_remove (&frame->elem);
+	else {
+		list_remove (&frame->elem);
+		a1in_cnt--;
+	}
+}
+
+static struct frame *
+twoq_victim (void) {
+	struct frame *frame;
+
+	if (!list_empty (&twoq_cold_list))
+		return list_entry (list_pop_front (&twoq_cold_list), struct frame, elem);
+	if (a1in_cnt > 0 && (a1in_cnt > a1in_max || am.frame_cnt == 0)) {
+		frame = list_entry (list_pop_front (&a1in), struct frame, elem);
+		a1in_cnt--;
+		ghost_remember (frame);
+		return frame;
+	}
+	return ring_second_chance (&am);
+}
+
+static void
+twoq_cold (struct frame *frame) {
+	twoq_remove (frame);
+	frame->queue = TWOQ_COLD;
+	list_push_back (&twoq_cold_list, &frame->elem);
+}
+
+const struct evict_policy twoq_policy = {
+	.name = "2q",
+	.init = twoq_init,
+	.add = twoq_add,
+	.remove = twoq_remove,
+	.victim = twoq_victim,
+	.cold = twoq_cold,
+	.forget = ghost_forget,
+};
@@ -0,0 +1,95 @@
+/* faultstat.c: Page fault latency, by what each fault came down to. */
+
+#include "vm/faultstat.h"
+#include <stdio.h>
+#include "threads/thread.h"
+
+/* vm_try_handle_fault() times every fault from entry to return, in
+ * CPU cycles, and files it under its class: overall, in a log2
+ * histogram per class, and for the process that took it.  Only the
+ * time spent in the VM fault handler is counted, not the trap and the
+ * return to the faulting code.  With -fault-stats, each process's
+ * totals are printed when it exits and the histograms at shutdown. */
+
+/* Printing the statistics? */
+static bool enabled;
+
+static const char *const class_names[FAULT_CLASS_CNT] = {
+	"anon", "file", "elf", "swap-in", "cow", "minor", "stack", "spurious",
+	"bad",
+};
+
+static long long counts[FAULT_CLASS_CNT];
+static uint64_t cycles_total[FAULT_CLASS_CNT];
+static long long histogram[FAULT_CLASS_CNT][FAULT_BUCKETS];
+
+/* Makes processes print their fault totals on exit, and the kernel the
+ * latency histograms at shutdown. */
+void
+faultstat_enable (void) {
+	enabled = true;
+}
+
+/* Returns the histogram bucket for a fault that took CYCLES. */
+static int
+bucket_of (uint64_t cycles) {
+	int b = 0;
+
+	while (cycles > 1 && b < FAULT_BUCKETS - 1) {
+		cycles >>= 1;
+		b++;
+	}
+	return b;
+}
+
+/* Counts a fault of CLASS that took CYCLES to handle, for the current
+ * process and overall. */
+void
+faultstat_record (enum fault_class class, uint64_t cycles) {
+	struct fault_totals *totals = &thread_current ()->faults;
+
+	counts[class]++;
+	cycles_total[class] += cycles;
+	histogram[class][bucket_of (cycles)]++;
+	totals->cnt[class]++;
+	totals->cycles += cycles;
+}
+
+/* Prints the current process's fault totals, if enabled. */
+void
+faultstat_print_process (void) {
+	struct thread *t = thread_current ();
+	long long all = 0;
+	int c;
+
+	if (!enabled || t->pml4 == NULL)
+		return;
+	printf ("%s: faults:", t->name);
+	for (c = 0; c < FAULT_CLASS_CNT; c++)
+		if (t->faults.cnt[c] > 0) {
+			printf (" %s %lld,", class_names[c], t->faults.cnt[c]);
+			all += t->faults.cnt[c];
+		}
+	printf (" %lld cycles in %lld\n", (long long) t->faults.cycles, all);
+}
+
+/* Prints the count, mean latency and latency histogram of each class
+ * of fault seen, if enabled. */
+void
+faultstat_print_stats (void) {
+	int c, b;
+
+	if (!enabled)
+		return;
+	for (c = 0; c < FAULT_CLASS_CNT; c++) {
+		if (counts[c] == 0)
+			continue;
+		printf ("Faults, %s: %lld, mean %lld cycles; by log2 cycles:",
+				class_names[c], counts[c],
+				(long long) (cycles_total[c] / counts[c]));
+		for (b = 0; b < FAULT_BUCKETS; b++)
+			if (histogram[c][b] > 0)
+				printf (" %d:%lld", b, histogram[c][b]);
+		printf ("\n");
+	}
+}
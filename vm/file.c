@@ -1,5 +1,11 @@
 /* file.c: Implementation of memory backed file object (mmaped object). */
 
+#include <round.h>
+#include <string.h>
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "userprog/syscall.h"
 #include "vm/vm.h"
 
 static bool file_backed_swap_in (struct page *page, void *kva);
@@ -14,45 +20,253 @@ static const struct page_operations file_ops = {
 	.type = VM_FILE,
 };
 
+/* Staging area for writing back WB_CLUSTER adjacent pages in one write.
+ * Guarded by the frame table lock, which every write-back holds. */
+static uint8_t *wb_buffer;
+
 /* The initializer of file vm */
 void
 vm_file_init (void) {
+	wb_buffer = palloc_get_multiple (PAL_ASSERT, WB_CLUSTER);
 }
 
 /* Initialize the file backed page */
 bool
-file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
+file_backed_initializer (struct page *page, enum vm_type type UNUSED,
+		void *kva UNUSED) {
 	/* Set up the handler */
 	page->operations = &file_ops;
+	return true;
+}
+
+/* Acquires filesys_lock unless the current thread already holds it, as
+ * it may when a fault happens inside a file system call.  Returns
+ * whether it was acquired, to pass to filesys_lock_release(). */
+bool
+filesys_lock_acquire (void) {
+	if (lock_held_by_current_thread (&filesys_lock))
+		return false;
+	lock_acquire (&filesys_lock);
+	return true;
+}
+
+void
+filesys_lock_release (bool acquired) {
+	if (acquired)
+		lock_release (&filesys_lock);
+}
+
+/* Returns the number of bytes of page VA of VMA that come from its file. */
+size_t
+vma_page_read_bytes (struct vm_area *vma, void *va) {
+	size_t ofs = (uint8_t *) va - (uint8_t *) vma->start;
+
+	if (ofs >= vma->read_bytes)
+		return 0;
+	return vma->read_bytes - ofs < PGSIZE ? vma->read_bytes - ofs : PGSIZE;
+}
+
+/* Fills KVA with the contents of page VA of VMA: the bytes backed by
+ * VMA's file, then zeros.  Returns false on a short read. */
+bool
+vma_read_page (struct vm_area *vma, void *va, void *kva) {
+	size_t read_bytes = vma_page_read_bytes (vma, va);
+
+	if (read_bytes > 0) {
+		off_t ofs = vma->offset + ((uint8_t *) va - (uint8_t *) vma->start);
+		bool acquired = filesys_lock_acquire ();
+		off_t n = file_read_at (vma->file, kva, read_bytes, ofs);
+
+		filesys_lock_release (acquired);
+		if (n != (off_t) read_bytes)
+			return false;
+	}
+	memset ((uint8_t *) kva + read_bytes, 0, PGSIZE - read_bytes);
+	return true;
+}
+
+/* If PAGE, a page of a file mapping, has been modified since it was
+ * last written back, clears its dirty bit and fills in WB to write it
+ * back, and returns true.  Otherwise, or if none of the page is in the
+ * file, returns false.  The dirty bit is cleared before the page is
+ * written rather than after, so that a write landing in the meantime
+ * sets it again and goes out next time instead of being lost.  The
+ * caller must hold the frame table lock. */
+bool
+page_take_dirty (struct page *page, struct wb_page *wb) {
+	struct vm_area *vma = page->vma;
+	uint64_t *pml4 = page->owner->pml4;
+
+	if (VM_TYPE (page->operations->type) == VM_SHM)
+		return shm_take_dirty (page, wb);
+	if (VM_TYPE (page->operations->type) != VM_FILE || page->frame == NULL
+			|| pml4 == NULL || !pml4_is_dirty (pml4, page->va))
+		return false;
+
+	pml4_set_dirty (pml4, page->va, false);
+	wb->file = vma->file;
+	wb->ofs = vma->offset + ((uint8_t *) page->va - (uint8_t *) vma->start);
+	wb->bytes = vma_page_read_bytes (vma, page->va);
+	wb->kva = page->frame->kva;
+	return wb->bytes > 0;
+}
+
+/* Returns true if B continues A in the same file. */
+static bool
+wb_follows (const struct wb_page *a, const struct wb_page *b) {
+	return file_get_inode (a->file) == file_get_inode (b->file)
+		&& a->bytes == PGSIZE && b->ofs == a->ofs + PGSIZE;
+}
+
+/* Writes the CNT pages WBS[] back to their files.  Runs of up to
+ * WB_CLUSTER pages that follow each other in a file go out in a single
+ * write.  The caller must hold the frame table lock, which keeps the
+ * pages' frames in place. */
+void
+write_back_pages (const struct wb_page wbs[], size_t cnt) {
+	size_t i, j, run;
+
+	for (i = 0; i < cnt; i += run) {
+		const void *buf = wbs[i].kva;
+		size_t bytes = wbs[i].bytes;
+		bool acquired;
+
+		for (run = 1; i + run < cnt && run < WB_CLUSTER
+				&& wb_follows (&wbs[i + run - 1], &wbs[i + run]); run++)
+			bytes += wbs[i + run].bytes;
+		if (run > 1) {
+			for (j = 0; j < run; j++)
+				memcpy (wb_buffer + j * PGSIZE, wbs[i + j].kva, wbs[i + j].bytes);
+			buf = wb_buffer;
+		}
 
-	struct file_page *file_page = &page->file;
+		acquired = filesys_lock_acquire ();
+		file_write_at (wbs[i].file, buf, bytes, wbs[i].ofs);
+		filesys_lock_release (acquired);
+		vm_stats.write_backs += run;
+		vm_stats.write_back_runs++;
+	}
+}
+
+/* Writes PAGE back to its file if user code has modified it.  The
+ * caller must hold the frame table lock. */
+static void
+file_backed_write_back (struct page *page) {
+	struct wb_page wb;
+
+	if (page_take_dirty (page, &wb))
+		write_back_pages (&wb, 1);
 }
 
 /* Swap in the page by read contents from the file. */
 static bool
 file_backed_swap_in (struct page *page, void *kva) {
-	struct file_page *file_page UNUSED = &page->file;
+	return vma_read_page (page->vma, page->va, kva);
 }
 
-/* Swap out the page by writeback contents to the file. */
+/* Swap out the page by writeback contents to the file.  Nothing is
+ * kept: the next fault reads the page back from the file. */
 static bool
 file_backed_swap_out (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	file_backed_write_back (page);
+	return true;
 }
 
 /* Destory the file backed page. PAGE will be freed by the caller. */
 static void
 file_backed_destroy (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	vm_frame_lock ();
+	file_backed_write_back (page);
+	vm_release_frame (page);
+	vm_frame_unlock ();
+}
+
+/* Loads a mapped page on its first fault. */
+static bool
+mmap_load (struct page *page, void *aux UNUSED) {
+	return vma_read_page (page->vma, page->va, page->frame->kva);
 }
 
-/* Do the mmap */
+/* Do the mmap.  The mapping is a single region whatever its length;
+ * pages are read from FILE as they are first touched.  WRITABLE may
+ * have MAP_SHARED or'd in, for a mapping that shares its pages with
+ * every other shared mapping of the file, in this process or another,
+ * rather than keeping a private copy of each page. */
 void *
 do_mmap (void *addr, size_t length, int writable,
 		struct file *file, off_t offset) {
+	off_t file_len = file_length (file);
+	bool shared = (writable & MAP_SHARED) != 0;
+	struct vm_area *vma;
+
+	vma = vm_alloc_region (shared ? VM_SHM : VM_FILE, addr,
+			DIV_ROUND_UP (length, PGSIZE), (writable & ~MAP_SHARED) != 0,
+			shared ? NULL : mmap_load, NULL);
+	if (vma == NULL)
+		return NULL;
+	if (shared && (vma->shm = shm_open (file)) == NULL) {
+		vm_free_region (vma);
+		return NULL;
+	}
+
+	/* The mapping keeps its own handle, so it survives close(). */
+	vma->file = file_reopen (file);
+	if (vma->file == NULL) {
+		vm_free_region (vma);
+		return NULL;
+	}
+	vma->offset = offset;
+	vma->read_bytes = offset < file_len ? (size_t) (file_len - offset) : 0;
+	if (vma->read_bytes > length)
+		vma->read_bytes = length;
+	return addr;
 }
 
-/* Do the munmap */
+/* Writes back the pages of file mappings in the LENGTH bytes at ADDR of
+ * the current process that have been modified, adjacent pages
+ * together.  Other memory in the range is passed over.  Returns false,
+ * doing nothing, if ADDR is not page-aligned or any page of the range
+ * is not mapped. */
+bool
+do_msync (void *addr, size_t length) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct wb_page wbs[WB_BATCH];
+	uint8_t *va, *end;
+	size_t cnt = 0;
+
+	if (pg_ofs (addr) != 0 || length == 0 || !is_user_vaddr (addr)
+			|| length > (uintptr_t) KERN_BASE - (uintptr_t) addr)
+		return false;
+	end = pg_round_up ((uint8_t *) addr + length);
+	if (!spt_range_mapped (spt, addr, end))
+		return false;
+
+	vm_frame_lock ();
+	for (va = addr; va < end; va += PGSIZE) {
+		struct page *page = spt_lookup_page (spt, va);
+
+		if (page == NULL || !page_take_dirty (page, &wbs[cnt]))
+			continue;
+		vm_stats.msync_pages++;
+		if (++cnt == WB_BATCH) {
+			write_back_pages (wbs, cnt);
+			cnt = 0;
+		}
+	}
+	write_back_pages (wbs, cnt);
+	vm_frame_unlock ();
+	return true;
+}
+
+/* Do the munmap.  ADDR must be the start of a mapping made by
+ * do_mmap() or do_shmap(); anything else, including an executable's
+ * text, which is file-backed too, is ignored. */
 void
 do_munmap (void *addr) {
+	struct vm_area *vma = spt_find_vma (&thread_current ()->spt, addr);
+
+	if (vma != NULL && vma->start == addr
+			&& ((VM_TYPE (vma->type) == VM_FILE && (vma->type & VM_TEXT) == 0)
+				|| VM_TYPE (vma->type) == VM_SHM))
+		vm_free_region (vma);
 }
@@ -0,0 +1,112 @@
+/* flusher.c: Background write-back of modified file mappings. */
+
+#include "vm/flusher.h"
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "vm/vm.h"
+
+/* Without the daemon, a modified page of a file mapping reaches its
+ * file only when it is evicted, unmapped or msync()ed, so a long-lived
+ * mapping can hold a lot of unwritten data that then goes out all at
+ * once.  The daemon instead sweeps the frame table every so often and
+ * writes back the pages modified since, WB_BATCH at a time, sorted so
+ * that adjacent pages of a file go out together. */
+
+/* Ticks between sweeps, or 0 if the daemon is off. */
+static int64_t interval;
+
+/* Returns true if A belongs before B in write-back order: by file, then
+ * by offset. */
+static bool
+wb_less (const struct wb_page *a, const struct wb_page *b) {
+	struct inode *ia = file_get_inode (a->file);
+	struct inode *ib = file_get_inode (b->file);
+
+	if (ia != ib)
+		return ia < ib;
+	return a->ofs < b->ofs;
+}
+
+/* Sorts the CNT pages WBS[] into write-back order. */
+static void
+wb_sort (struct wb_page wbs[], size_t cnt) {
+	size_t i, j;
+
+	for (i = 1; i < cnt; i++) {
+		struct wb_page wb = wbs[i];
+
+		for (j = i; j > 0 && wb_less (&wb, &wbs[j - 1]); j--)
+			wbs[j] = wbs[j - 1];
+		wbs[j] = wb;
+	}
+}
+
+/* Writes back the modified pages of file mappings in frames NEXT
+ * onward, stopping after WB_BATCH.  A frame that only a shared object
+ * holds, with no page mapping it, is left for eviction to write.  Returns where to go on from, or the
+ * number of frames if the sweep is done. */
+static size_t
+flusher_sweep (size_t next) {
+	size_t frame_cnt = palloc_user_page_cnt ();
+	struct wb_page wbs[WB_BATCH];
+	size_t cnt = 0;
+
+	vm_frame_lock ();
+	for (; next < frame_cnt && cnt < WB_BATCH; next++) {
+		struct frame *frame = vm_frame_at (next);
+
+		if (frame->active && frame->page != NULL
+				&& page_take_dirty (frame->page, &wbs[cnt]))
+			cnt++;
+	}
+	wb_sort (wbs, cnt);
+	write_back_pages (wbs, cnt);
+	vm_stats.flusher_pages += cnt;
+	vm_frame_unlock ();
+	return next;
+}
+
+/* The write-back daemon.  The frame table lock is let go between
+ * batches, so that faults are not held up for a whole sweep. */
+static void
+flusher (void *aux UNUSED) {
+	size_t frame_cnt = palloc_user_page_cnt ();
+
+	for (;;) {
+		size_t next = 0;
+
+		timer_sleep (interval);
+		while (next < frame_cnt)
+			next = flusher_sweep (next);
+		vm_stats.flusher_passes++;
+	}
+}
+
+/* Makes the daemon write back modified file pages every MS
+ * milliseconds.  Must be called before vm_init(). */
+void
+flusher_enable (size_t ms) {
+	interval = (int64_t) ms * TIMER_FREQ / 1000;
+	if (ms > 0 && interval == 0)
+		interval = 1;
+}
+
+/* Starts the daemon, if flusher_enable() asked for it. */
+void
+flusher_init (void) {
+	if (interval == 0)
+		return;
+	if (thread_create ("flusher", PRI_MIN, flusher, NULL) == TID_ERROR)
+		PANIC ("flusher_init: cannot start the write-back daemon");
+}
+
+/* Prints write-back daemon statistics, if it is running. */
+void
+flusher_print_stats (void) {
+	if (interval == 0)
+		return;
+	printf ("Flusher: %lld sweeps, %lld pages written back\n",
+			vm_stats.flusher_passes, vm_stats.flusher_pages);
+}
@@ -0,0 +1,206 @@
+/* ksm.c: Merging of identical anonymous pages. */
+
+#include "vm/ksm.h"
+#include <hash.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "vm/vm.h"
+
+/* A low-priority kernel thread walks the frame table a few frames at a
+ * time, looking for anonymous frames with the same contents.  Each
+ * frame is hashed and looked up among the frames hashed so far on this
+ * pass over the table.  A match is write-protected and compared in
+ * full, and the second frame's pages are moved onto the first, which
+ * is then shared copy-on-write like a frame after fork.
+ *
+ * A frame written since the last pass is skipped, since merging it
+ * would likely be undone by the next write.  The dirty bits tell: the
+ * daemon clears them as it goes, and swap does not rely on them for
+ * anonymous pages. */
+
+/* Time between rounds. */
+#define KSM_INTERVAL (TIMER_FREQ / 10)
+
+/* A frame hashed on this pass. */
+struct ksm_node {
+	uint64_t hash;               /* Hash of the frame's contents. */
+	struct frame *frame;         /* May since have been freed. */
+	struct hash_elem elem;       /* In ksm_nodes. */
+};
+
+/* Frames scanned per round, or 0 if merging is off. */
+static size_t pages_per_round;
+
+/* Frames hashed on this pass, by hash.  Rebuilt every pass, which
+ * disposes of nodes whose frames have gone.  Guarded by the frame table
+ * lock, like everything the daemon looks at. */
+static struct hash ksm_nodes;
+
+static uint64_t
+ksm_node_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_entry (e, struct ksm_node, elem)->hash;
+}
+
+static bool
+ksm_node_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct ksm_node, elem)->hash
+		< hash_entry (b, struct ksm_node, elem)->hash;
+}
+
+static void
+ksm_node_free (struct hash_elem *e, void *aux UNUSED) {
+	free (hash_entry (e, struct ksm_node, elem));
+}
+
+/* Returns true if FRAME is in use, mapped, and holds only anonymous
+ * pages of live processes. */
+static bool
+frame_is_anon (struct frame *frame) {
+	struct list_elem *e;
+
+	if (!frame->active || frame->page == NULL)
+		return false;
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+
+		if (VM_TYPE (page->operations->type) != VM_ANON
+				|| page->owner->pml4 == NULL)
+			return false;
+	}
+	return true;
+}
+
+/* Returns true if any page of FRAME has been written since the last
+ * call, and clears their dirty bits. */
+static bool
+frame_test_and_clear_dirty (struct frame *frame) {
+	bool dirty = false;
+	struct list_elem *e;
+
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+
+		if (pml4_is_dirty (page->owner->pml4, page->va)) {
+			/* With the dirty bit gone, MADV_FREE could no longer
+			 * tell that the page was written. */
+			pml4_set_dirty (page->owner->pml4, page->va, false);
+			page->anon.lazy_free = false;
+			dirty = true;
+		}
+	}
+	return dirty;
+}
+
+/* Maps every page of FRAME read-only, so that its contents stay put
+ * until it is merged.  A page left read-only when the contents turn out
+ * to differ takes one cheap fault on its next write. */
+static void
+frame_write_protect (struct frame *frame) {
+	struct list_elem *e;
+
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+
+		pml4_set_writable (page->owner->pml4, page->va, false);
+	}
+}
+
+/* Merges FRAME into an earlier frame with the same contents, if there
+ * is one, or else remembers it for later frames. */
+static void
+ksm_scan_frame (struct frame *frame) {
+	struct ksm_node probe, *node;
+	struct hash_elem *e;
+	struct frame *other;
+
+	if (!frame_is_anon (frame) || frame_test_and_clear_dirty (frame))
+		return;
+	vm_stats.merge_scans++;
+
+	probe.hash = hash_bytes (frame->kva, PGSIZE);
+	e = hash_find (&ksm_nodes, &probe.elem);
+	if (e == NULL) {
+		node = malloc (sizeof *node);
+		if (node != NULL) {
+			node->hash = probe.hash;
+			node->frame = frame;
+			hash_insert (&ksm_nodes, &node->elem);
+		}
+		return;
+	}
+
+	node = hash_entry (e, struct ksm_node, elem);
+	other = node->frame;
+	if (other == frame)
+		return;
+	if (!frame_is_anon (other)) {
+		node->frame = frame;
+		return;
+	}
+
+	frame_write_protect (frame);
+	frame_write_protect (other);
+	if (memcmp (frame->kva, other->kva, PGSIZE) == 0) {
+		vm_merge_frames (other, frame);
+		vm_stats.merges++;
+	}
+}
+
+/* The merging daemon.  Scans PAGES_PER_ROUND frames every
+ * KSM_INTERVAL, starting a new pass when it reaches the end of the
+ * frame table. */
+static void
+ksm_daemon (void *aux UNUSED) {
+	size_t frame_cnt = palloc_user_page_cnt ();
+	size_t next = 0;
+
+	for (;;) {
+		size_t i;
+
+		timer_sleep (KSM_INTERVAL);
+		vm_frame_lock ();
+		for (i = 0; i < pages_per_round; i++) {
+			ksm_scan_frame (vm_frame_at (next));
+			if (++next == frame_cnt) {
+				next = 0;
+				hash_clear (&ksm_nodes, ksm_node_free);
+			}
+		}
+		vm_frame_unlock ();
+	}
+}
+
+/* Makes the merging daemon scan PAGES frames every tenth of a second.
+ * Must be called before vm_init(). */
+void
+ksm_enable (size_t pages) {
+	pages_per_round = pages;
+}
+
+/* Starts the merging daemon, if ksm_enable() asked for it. */
+void
+ksm_init (void) {
+	if (pages_per_round == 0)
+		return;
+	hash_init (&ksm_nodes, ksm_node_hash, ksm_node_less, NULL);
+	if (thread_create ("ksm", PRI_MIN, ksm_daemon, NULL) == TID_ERROR)
+		PANIC ("ksm_init: cannot start the merging daemon");
+}
+
+/* Prints merging statistics, if the daemon is running. */
+void
+ksm_print_stats (void) {
+	if (pages_per_round == 0)
+		return;
+	printf ("Merging: %lld frames scanned, %lld frames merged\n",
+			vm_stats.merge_scans, vm_stats.merges);
+}
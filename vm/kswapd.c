@@ -0,0 +1,84 @@
+/* kswapd.c: Page-out daemon keeping frames free ahead of demand. */
+
+#include "vm/kswapd.h"
+#include <stdio.h>
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "vm/vm.h"
+
+/* Without the daemon, a fault that finds the user pool empty evicts
+ * pages itself, and waits for them to be written out.  The daemon
+ * instead starts evicting when free frames drop below a low watermark
+ * and keeps at it until they reach a high watermark, twice the low,
+ * so that faults normally find a free frame waiting.  A fault still
+ * evicts for itself if the daemon falls behind. */
+
+/* Watermarks in free frames, or 0 if the daemon is off. */
+static size_t low_water, high_water;
+
+/* Upped to wake the daemon.  AWAKE avoids upping it on every
+ * allocation while the daemon is already at work. */
+static struct semaphore wake;
+static bool awake;
+
+/* The page-out daemon. */
+static void
+kswapd (void *aux UNUSED) {
+	for (;;) {
+		sema_down (&wake);
+		vm_stats.kswapd_wakeups++;
+		while (palloc_user_free_cnt () < high_water) {
+			size_t freed = vm_reclaim ();
+
+			if (freed == 0)
+				break;
+			vm_stats.kswapd_frames += freed;
+		}
+		awake = false;
+	}
+}
+
+/* Makes the daemon keep at least LOW frames free, with a high watermark
+ * of twice that.  Must be called before vm_init(). */
+void
+kswapd_enable (size_t low) {
+	low_water = low;
+}
+
+/* Starts the daemon, if kswapd_enable() asked for it.  The watermarks
+ * are capped at a quarter and a half of the user pool. */
+void
+kswapd_init (void) {
+	size_t frame_cnt = palloc_user_page_cnt ();
+
+	if (low_water == 0)
+		return;
+	if (low_water > frame_cnt / 4)
+		low_water = frame_cnt / 4 > 0 ? frame_cnt / 4 : 1;
+	high_water = low_water * 2;
+	sema_init (&wake, 0);
+	if (thread_create ("kswapd", PRI_DEFAULT, kswapd, NULL) == TID_ERROR)
+		PANIC ("kswapd_init: cannot start the page-out daemon");
+}
+
+/* Wakes the daemon if free frames have dropped below the low
+ * watermark.  Called after each frame is allocated. */
+void
+kswapd_poke (void) {
+	if (low_water > 0 && !awake && palloc_user_free_cnt () < low_water) {
+		awake = true;
+		sema_up (&wake);
+	}
+}
+
+/* Prints page-out daemon statistics, if it is running. */
+void
+kswapd_print_stats (void) {
+	if (low_water == 0)
+		return;
+	printf ("Kswapd: %zu/%zu frames watermarks, %lld wakeups, "
+			"%lld frames reclaimed, %lld reclaims by faults\n",
+			low_water, high_water, vm_stats.kswapd_wakeups,
+			vm_stats.kswapd_frames, vm_stats.direct_reclaims);
+}
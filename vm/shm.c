@@ -0,0 +1,385 @@
+/* shm.c: Shared memory objects, behind MAP_SHARED file mappings and
+ * anonymous shared regions. */
+
+#include "vm/vm.h"
+#include <round.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/vaddr.h"
+
+/* A page of a shared region is only a view of a page of the region's
+ * object.  The first process to touch a page brings it into a frame,
+ * which the object records; every other process touching the page then
+ * maps that same frame, writable if its region is.  Evicting the frame
+ * unmaps it from all of them and writes it back to the file, or to
+ * swap for an anonymous object, to be brought in again on the next
+ * touch.  A frame no page maps any more, because the processes that had
+ * it mapped have unmapped it or exited, stays with the eviction policy,
+ * held for the object, so that the next process to map the page finds
+ * it still in memory.  It is written out only if it is evicted first,
+ * and not at all if the object goes away first. */
+
+static bool shm_swap_in (struct page *page, void *kva);
+static bool shm_swap_out (struct page *page);
+static void shm_destroy (struct page *page);
+
+static const struct page_operations shm_ops = {
+	.swap_in = shm_swap_in,
+	.swap_out = shm_swap_out,
+	.destroy = shm_destroy,
+	.type = VM_SHM,
+};
+
+/* Objects for files, by inode, so that every MAP_SHARED mapping of a
+ * file shares one.  SHM_FILES_LOCK also guards every object's
+ * reference count. */
+static struct hash shm_files;
+static struct lock shm_files_lock;
+
+static uint64_t
+slot_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct shm_slot *s = hash_entry (e, struct shm_slot, elem);
+
+	return hash_int (s->idx);
+}
+
+static bool
+slot_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct shm_slot *a = hash_entry (a_, struct shm_slot, elem);
+	const struct shm_slot *b = hash_entry (b_, struct shm_slot, elem);
+
+	return a->idx < b->idx;
+}
+
+static uint64_t
+shm_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct shm *s = hash_entry (e, struct shm, elem);
+
+	return hash_bytes (&s->inode, sizeof s->inode);
+}
+
+static bool
+shm_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct shm *a = hash_entry (a_, struct shm, elem);
+	const struct shm *b = hash_entry (b_, struct shm, elem);
+
+	return a->inode < b->inode;
+}
+
+/* Initializes the table of file objects. */
+void
+vm_shm_init (void) {
+	hash_init (&shm_files, shm_hash, shm_less, NULL);
+	lock_init (&shm_files_lock);
+}
+
+/* Returns a new object with one reference, backed by FILE, which the
+ * object takes over, or anonymous if FILE is null.  Returns a null
+ * pointer if memory is short. */
+static struct shm *
+shm_alloc (struct file *file) {
+	struct shm *shm = malloc (sizeof *shm);
+
+	if (shm == NULL)
+		return NULL;
+	shm->file = file;
+	shm->inode = file != NULL ? file_get_inode (file) : NULL;
+	shm->ref_cnt = 1;
+	lock_init (&shm->lock);
+	hash_init (&shm->slots, slot_hash, slot_less, shm);
+	return shm;
+}
+
+/* Returns a new anonymous object, all zeros, or a null pointer if
+ * memory is short. */
+struct shm *
+shm_create (void) {
+	return shm_alloc (NULL);
+}
+
+/* Returns a new reference to the object for FILE's inode, creating it
+ * if no region maps the file shared yet.  Returns a null pointer if
+ * memory is short. */
+struct shm *
+shm_open (struct file *file) {
+	struct shm probe = { .inode = file_get_inode (file) };
+	struct hash_elem *e;
+	struct shm *shm = NULL;
+	struct file *handle;
+
+	lock_acquire (&shm_files_lock);
+	e = hash_find (&shm_files, &probe.elem);
+	if (e != NULL) {
+		shm = hash_entry (e, struct shm, elem);
+		shm->ref_cnt++;
+	} else if ((handle = file_reopen (file)) != NULL) {
+		shm = shm_alloc (handle);
+		if (shm != NULL)
+			hash_insert (&shm_files, &shm->elem);
+		else
+			file_close (handle);
+	}
+	lock_release (&shm_files_lock);
+	return shm;
+}
+
+/* Adds a reference to SHM, for a region copied into a child. */
+void
+shm_ref (struct shm *shm) {
+	lock_acquire (&shm_files_lock);
+	shm->ref_cnt++;
+	lock_release (&shm_files_lock);
+}
+
+/* Returns the number of bytes of page IDX of SHM that exist in its
+ * file, which is 0 for an anonymous object. */
+static size_t
+shm_page_bytes (struct shm *shm, size_t idx) {
+	off_t ofs = (off_t) idx * PGSIZE;
+	off_t len;
+	bool acquired;
+
+	if (shm->file == NULL)
+		return 0;
+	acquired = filesys_lock_acquire ();
+	len = file_length (shm->file);
+	filesys_lock_release (acquired);
+	if (ofs >= len)
+		return 0;
+	return len - ofs < PGSIZE ? (size_t) (len - ofs) : PGSIZE;
+}
+
+/* Writes the page at KVA, page IDX of file object SHM, back to the
+ * file.  Only the bytes that exist in the file are written; a mapping
+ * does not extend its file.  The caller must hold the frame table
+ * lock. */
+static void
+shm_write_back (struct shm *shm, size_t idx, const void *kva) {
+	struct wb_page wb = {
+		.file = shm->file,
+		.ofs = (off_t) idx * PGSIZE,
+		.bytes = shm_page_bytes (shm, idx),
+		.kva = kva,
+	};
+
+	if (wb.bytes > 0)
+		write_back_pages (&wb, 1);
+}
+
+/* Frees SLOT and whatever holds its page, writing the page back first
+ * if it belongs to a file and was modified.  The caller must hold the
+ * frame table lock. */
+static void
+slot_free (struct hash_elem *e, void *aux) {
+	struct shm_slot *slot = hash_entry (e, struct shm_slot, elem);
+	struct shm *shm = aux;
+
+	if (slot->frame != NULL) {
+		if (slot->dirty)
+			shm_write_back (shm, slot->idx, slot->frame->kva);
+		vm_free_held_frame (slot->frame);
+	} else if (slot->swap_slot != SWAP_SLOT_NONE)
+		anon_swap_discard (slot->swap_slot);
+	free (slot);
+}
+
+/* Drops a reference to SHM, freeing it with the last.  By then no page
+ * maps any of its frames. */
+void
+shm_unref (struct shm *shm) {
+	bool last;
+
+	lock_acquire (&shm_files_lock);
+	last = --shm->ref_cnt == 0;
+	if (last && shm->file != NULL)
+		hash_delete (&shm_files, &shm->elem);
+	lock_release (&shm_files_lock);
+	if (!last)
+		return;
+
+	vm_frame_lock ();
+	hash_destroy (&shm->slots, slot_free);
+	vm_frame_unlock ();
+	if (shm->file != NULL)
+		file_close (shm->file);
+	free (shm);
+}
+
+/* Returns the slot of the object page PAGE views, creating it if need
+ * be, and remembers it in PAGE.  Returns a null pointer if memory is
+ * short.  The caller must hold the frame table lock. */
+struct shm_slot *
+shm_get_slot (struct page *page) {
+	struct vm_area *vma = page->vma;
+	struct shm_slot probe, *slot;
+	struct hash_elem *e;
+
+	if (page->shm.slot != NULL)
+		return page->shm.slot;
+
+	probe.idx = (vma->offset + ((uint8_t *) page->va - (uint8_t *) vma->start))
+		/ PGSIZE;
+	e = hash_find (&vma->shm->slots, &probe.elem);
+	if (e != NULL)
+		slot = hash_entry (e, struct shm_slot, elem);
+	else {
+		slot = malloc (sizeof *slot);
+		if (slot == NULL)
+			return NULL;
+		slot->shm = vma->shm;
+		slot->idx = probe.idx;
+		slot->frame = NULL;
+		slot->swap_slot = SWAP_SLOT_NONE;
+		slot->dirty = false;
+		hash_insert (&vma->shm->slots, &slot->elem);
+	}
+	page->shm.slot = slot;
+	return slot;
+}
+
+/* Initializes PAGE as a view of a page of its region's object. */
+bool
+shm_initializer (struct page *page, enum vm_type type UNUSED,
+		void *kva UNUSED) {
+	page->operations = &shm_ops;
+	page->shm.slot = NULL;
+	return true;
+}
+
+/* Brings PAGE's object page into KVA, from the file, from swap, or as
+ * zeros.  Called with the object's lock held, so no other process is
+ * bringing in the same page. */
+static bool
+shm_swap_in (struct page *page, void *kva) {
+	struct shm *shm = page->vma->shm;
+	struct shm_slot *slot = page->shm.slot;
+	size_t read_bytes = shm_page_bytes (shm, slot->idx);
+
+	if (read_bytes > 0) {
+		bool acquired = filesys_lock_acquire ();
+		off_t n = file_read_at (shm->file, kva, read_bytes,
+				(off_t) slot->idx * PGSIZE);
+
+		filesys_lock_release (acquired);
+		if (n != (off_t) read_bytes)
+			return false;
+	} else if (slot->swap_slot != SWAP_SLOT_NONE) {
+		anon_swap_restore (slot->swap_slot, kva);
+		slot->swap_slot = SWAP_SLOT_NONE;
+		return true;
+	}
+	memset ((uint8_t *) kva + read_bytes, 0, PGSIZE - read_bytes);
+	return true;
+}
+
+/* Like page_take_dirty(), for PAGE, a page of a shared region: if the
+ * object is a file and the frame holding the page has been modified
+ * through any page mapping it, clears their dirty bits and fills in WB
+ * to write it back.  The caller must hold the frame table lock. */
+bool
+shm_take_dirty (struct page *page, struct wb_page *wb) {
+	struct shm *shm = page->vma->shm;
+	struct shm_slot *slot = page->shm.slot;
+	struct frame *frame = page->frame;
+	struct list_elem *e;
+
+	if (shm->file == NULL || frame == NULL)
+		return false;
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages);
+			e = list_next (e)) {
+		struct page *p = list_entry (e, struct page, frame_elem);
+
+		if (p->owner->pml4 != NULL && pml4_is_dirty (p->owner->pml4, p->va)) {
+			pml4_set_dirty (p->owner->pml4, p->va, false);
+			slot->dirty = true;
+		}
+	}
+	if (!slot->dirty)
+		return false;
+	slot->dirty = false;
+	wb->file = shm->file;
+	wb->ofs = (off_t) slot->idx * PGSIZE;
+	wb->bytes = shm_page_bytes (shm, slot->idx);
+	wb->kva = frame->kva;
+	return wb->bytes > 0;
+}
+
+/* Writes out the frame of PAGE, which every page sharing it has been
+ * unmapped from: back to the file if any of them modified it, or to
+ * swap.  The caller must hold the frame table lock. */
+static bool
+shm_swap_out (struct page *page) {
+	struct shm *shm = page->vma->shm;
+	struct shm_slot *slot = page->shm.slot;
+	struct frame *frame = page->frame;
+	struct wb_page wb;
+
+	if (shm->file != NULL) {
+		if (shm_take_dirty (page, &wb))
+			write_back_pages (&wb, 1);
+	} else {
+		slot->swap_slot = anon_swap_save (frame->kva);
+		if (slot->swap_slot == SWAP_SLOT_NONE)
+			return false;
+	}
+	slot->frame = NULL;
+	return true;
+}
+
+/* Writes out FRAME, which holds a page of a shared object that no page
+ * maps, for it to be evicted: back to the file if it was modified, or
+ * to swap for an anonymous object.  Returns false if swap is full.  The
+ * caller must hold the frame table lock. */
+bool
+shm_evict (struct frame *frame) {
+	struct shm_slot *slot = frame->slot;
+	struct shm *shm = slot->shm;
+
+	if (shm->file != NULL) {
+		if (slot->dirty)
+			shm_write_back (shm, slot->idx, frame->kva);
+		slot->dirty = false;
+	} else {
+		slot->swap_slot = anon_swap_save (frame->kva);
+		if (slot->swap_slot == SWAP_SLOT_NONE)
+			return false;
+	}
+	slot->frame = NULL;
+	frame->slot = NULL;
+	return true;
+}
+
+/* Unmaps PAGE.  Its frame stays with the object even if no other page
+ * maps it. */
+static void
+shm_destroy (struct page *page) {
+	uint64_t *pml4 = page->owner->pml4;
+
+	vm_frame_lock ();
+	if (page->frame != NULL && pml4 != NULL && pml4_is_dirty (pml4, page->va))
+		page->shm.slot->dirty = true;
+	vm_detach_shared (page);
+	vm_frame_unlock ();
+}
+
+/* Maps LENGTH bytes of zeros at ADDR, shared with every child the
+ * process forks from now on.  Returns ADDR, or a null pointer if the
+ * range is unusable or memory is short. */
+void *
+do_shmap (void *addr, size_t length) {
+	struct vm_area *vma;
+
+	vma = vm_alloc_region (VM_SHM, addr, DIV_ROUND_UP (length, PGSIZE),
+			true, NULL, NULL);
+	if (vma == NULL)
+		return NULL;
+	vma->shm = shm_create ();
+	if (vma->shm == NULL) {
+		vm_free_region (vma);
+		return NULL;
+	}
+	return addr;
+}
@@ -3,3 +3,10 @@ vm_SRC += vm/uninit.c     # Uninitialized page
 vm_SRC += vm/anon.c       # Anonymous page
 vm_SRC += vm/file.c       # File mapped page
 vm_SRC += vm/inspect.c    # Testing utility
+vm_SRC += vm/evict.c      # Page replacement policies
+vm_SRC += vm/zswap.c      # Compressed swap cache
+vm_SRC += vm/ksm.c        # Same-page merging
+vm_SRC += vm/kswapd.c     # Page-out daemon
+vm_SRC += vm/shm.c        # Shared memory objects
+vm_SRC += vm/flusher.c    # Write-back daemon
+vm_SRC += vm/faultstat.c  # Fault latency statistics
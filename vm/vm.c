@@ -1,8 +1,71 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "intrinsic.h"
 #include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
 #include "vm/vm.h"
+#include "vm/evict.h"
+#include "vm/flusher.h"
 #include "vm/inspect.h"
+#include "vm/ksm.h"
+#include "vm/kswapd.h"
+#include "vm/zswap.h"
+
+/* The stack may grow down to at most this many bytes. */
+#define STACK_MAX (1 << 20)
+
+/* Pages mapped after the first fault in a file-backed region; see
+ * vm_fault_around(). */
+#define FAULT_AROUND_INIT 4
+
+/* Pages mapped after each fault in a region advised MADV_SEQUENTIAL, if
+ * fault-around is otherwise off. */
+#define FAULT_AROUND_SEQUENTIAL 16
+
+static bool vma_less (const struct treap_elem *, const struct treap_elem *,
+		void *);
+static uint64_t page_hash (const struct hash_elem *, void *);
+static bool page_less (const struct hash_elem *, const struct hash_elem *,
+		void *);
+static uint64_t text_hash (const struct hash_elem *, void *);
+static bool text_less (const struct hash_elem *, const struct hash_elem *,
+		void *);
+
+/* Eviction policies, selectable with -evict. */
+static const struct evict_policy *const policies[] = {
+	&clock_policy, &wsclock_policy, &twoq_policy,
+};
+static const struct evict_policy *policy = &clock_policy;
+
+/* The frame table has one entry for each page in the user pool, indexed
+ * by its position there.  A frame is known to the eviction policy from
+ * the time its page is mapped until it is released; until then it is
+ * private to the thread filling it.  frame_lock guards the table, the
+ * policy, and the frame links of pages with frames known to the policy. */
+static struct frame *frame_table;
+static struct lock frame_lock;
+
+/* Frames holding pages of executables' read-only segments, by file and
+ * offset, so that every process running an executable maps the same
+ * frames for its text.  A frame leaves the cache when it is freed or
+ * evicted.  Guarded by frame_lock. */
+static struct hash text_cache;
+
+/* A page of zeros, mapped read-only into every page that has been read
+ * but never written.  It comes from the kernel pool, so it is never
+ * evicted. */
+static void *zero_page;
+
+/* Most pages mapped after a fault, set by -fault-around.  0 turns
+ * fault-around off. */
+static size_t fault_around_max;
+
+struct vm_stats vm_stats;
 
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
@@ -15,7 +78,75 @@ vm_init (void) {
 #endif
 	register_inspect_intr ();
 	/* DO NOT MODIFY UPPER LINES. */
-	/* TODO: Your code goes here. */
+
+	frame_table = calloc (palloc_user_page_cnt (), sizeof *frame_table);
+	if (frame_table == NULL)
+		PANIC ("vm_init: out of memory for the frame table");
+	lock_init (&frame_lock);
+	hash_init (&text_cache, text_hash, text_less, NULL);
+	vm_shm_init ();
+	zero_page = palloc_get_page (PAL_ZERO | PAL_ASSERT);
+	ksm_init ();
+	kswapd_init ();
+	flusher_init ();
+	policy->init (palloc_user_page_cnt ());
+}
+
+/* Makes the eviction policy called NAME the one to use.  Returns false
+ * if there is no such policy.  Must be called before vm_init(). */
+bool
+vm_select_policy (const char *name) {
+	size_t i;
+
+	for (i = 0; i < sizeof policies / sizeof *policies; i++)
+		if (!strcmp (policies[i]->name, name)) {
+			policy = policies[i];
+			return true;
+		}
+	return false;
+}
+
+/* Maps up to MAX pages after each fault in a file-backed region. */
+void
+vm_set_fault_around (size_t max) {
+	fault_around_max = max;
+}
+
+/* Prints paging statistics. */
+void
+vm_print_stats (void) {
+	long long swap_pages = vm_stats.swap_outs + vm_stats.swap_ins;
+
+	printf ("Paging: %s eviction, %lld faults, %lld faulted around, "
+			"%lld evictions, %lld write-backs, %lld copy-on-write copies, "
+			"%lld shared text pages\n",
+			policy->name, vm_stats.faults, vm_stats.fault_arounds,
+			vm_stats.evictions, vm_stats.write_backs, vm_stats.cow_copies,
+			vm_stats.text_shares);
+	printf ("Zero page: %lld pages mapped, %lld later written, "
+			"%lld frames saved\n",
+			vm_stats.zero_maps, vm_stats.zero_writes,
+			vm_stats.zero_maps - vm_stats.zero_writes);
+	printf ("Write-back: %lld pages in %lld writes, %lld pages by msync\n",
+			vm_stats.write_backs, vm_stats.write_back_runs,
+			vm_stats.msync_pages);
+	printf ("Advice: %lld pages prefetched, %lld dropped, "
+			"%lld frames marked cold, %lld freed unwritten\n",
+			vm_stats.prefetches, vm_stats.drops, vm_stats.cold_marks,
+			vm_stats.lazy_frees);
+	printf ("Resident limits: %lld frames reclaimed by processes "
+			"over their limits\n", vm_stats.rss_reclaims);
+	printf ("Swap: %lld pages out in %lld writes, %lld pages in in %lld reads, "
+			"%lld pages/s\n",
+			vm_stats.swap_outs, vm_stats.swap_writes,
+			vm_stats.swap_ins, vm_stats.swap_reads,
+			vm_stats.swap_ticks > 0
+			? swap_pages * TIMER_FREQ / vm_stats.swap_ticks : 0);
+	zswap_print_stats ();
+	ksm_print_stats ();
+	kswapd_print_stats ();
+	flusher_print_stats ();
+	faultstat_print_stats ();
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -35,109 +166,1066 @@ page_get_type (struct page *page) {
 /* Helpers */
 static struct frame *vm_get_victim (void);
 static bool vm_do_claim_page (struct page *page);
+static bool vm_claim_frame (struct page *page, struct frame *frame);
+static bool vm_claim_shared (struct page *page);
+static bool page_is_zero (struct page *page);
 static struct frame *vm_evict_frame (void);
+static struct frame *frame_alloc (void);
+
+/* Transmutes uninit PAGE into a page of TYPE backed by the frame at KVA.
+ * Used as the page_initializer of every uninit page. */
+static bool
+page_initialize (struct page *page, enum vm_type type, void *kva) {
+	switch (VM_TYPE (type)) {
+		case VM_ANON:
+			return anon_initializer (page, type, kva);
+		case VM_FILE:
+			return file_backed_initializer (page, type, kva);
+		case VM_SHM:
+			return shm_initializer (page, type, kva);
+		default:
+			return false;
+	}
+}
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
- * `vm_alloc_page`. */
+ * `vm_alloc_page`.  A single page is simply a one-page region. */
 bool
 vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		vm_initializer *init, void *aux) {
 
 	ASSERT (VM_TYPE(type) != VM_UNINIT)
 
+	return vm_alloc_region (type, upage, 1, writable, init, aux) != NULL;
+}
+
+/* Returns true if any region of SPT overlaps [START, END). */
+static bool
+spt_overlaps (struct supplemental_page_table *spt, void *start, void *end) {
+	struct vm_area probe = { .start = (uint8_t *) end - 1 };
+	struct treap_elem *e;
+
+	e = treap_floor (&spt->vmas, &probe.elem);
+	return e != NULL && treap_entry (e, struct vm_area, elem)->end > start;
+}
+
+/* Creates a region of PAGE_CNT pending pages of TYPE at START in the
+ * current process, each filled by INIT with AUX on its first fault, or
+ * zeroed if INIT is null.  This takes the same time however large the
+ * region is.  Returns the new region, for the caller to attach a backing
+ * file to, or a null pointer if the range is not page-aligned user
+ * memory, overlaps an existing region, or memory is short. */
+struct vm_area *
+vm_alloc_region (enum vm_type type, void *start, size_t page_cnt,
+		bool writable, vm_initializer *init, void *aux) {
 	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct vm_area *vma;
+	void *end;
 
-	/* Check wheter the upage is already occupied or not. */
-	if (spt_find_page (spt, upage) == NULL) {
-		/* TODO: Create the page, fetch the initialier according to the VM type,
-		 * TODO: and then create "uninit" page struct by calling uninit_new. You
-		 * TODO: should modify the field after calling the uninit_new. */
+	ASSERT (VM_TYPE (type) != VM_UNINIT);
 
-		/* TODO: Insert the page into the spt. */
-	}
-err:
-	return false;
+	if (start == NULL || pg_ofs (start) != 0 || !is_user_vaddr (start)
+			|| page_cnt == 0
+			|| page_cnt > ((uintptr_t) KERN_BASE - (uintptr_t) start) / PGSIZE)
+		return NULL;
+	end = (uint8_t *) start + page_cnt * PGSIZE;
+	if (spt_overlaps (spt, start, end))
+		return NULL;
+
+	vma = malloc (sizeof *vma);
+	if (vma == NULL)
+		return NULL;
+	vma->start = start;
+	vma->end = end;
+	vma->type = type;
+	vma->writable = writable;
+	vma->init = init;
+	vma->aux = aux;
+	vma->file = NULL;
+	vma->offset = 0;
+	vma->read_bytes = 0;
+	vma->fault_next = start;
+	vma->fault_window = FAULT_AROUND_INIT;
+	vma->shm = NULL;
+	vma->advice = MADV_NORMAL;
+	list_init (&vma->pages);
+	treap_insert (&spt->vmas, &vma->elem);
+	return vma;
+}
+
+/* Removes VMA from SPT, destroying its pages, closing its file and
+ * dropping its shared memory object. */
+static void
+vma_destroy (struct supplemental_page_table *spt, struct vm_area *vma) {
+	while (!list_empty (&vma->pages))
+		spt_remove_page (spt, list_entry (list_front (&vma->pages),
+					struct page, vma_elem));
+	treap_delete (&spt->vmas, &vma->elem);
+	if (vma->shm != NULL)
+		shm_unref (vma->shm);
+	if (vma->file != NULL)
+		file_close (vma->file);
+	free (vma);
+}
+
+/* Removes VMA from the current process.  Dirty file-backed pages are
+ * written back first. */
+void
+vm_free_region (struct vm_area *vma) {
+	vma_destroy (&thread_current ()->spt, vma);
+}
+
+/* Returns the region of SPT that contains VA, or a null pointer. */
+struct vm_area *
+spt_find_vma (struct supplemental_page_table *spt, void *va) {
+	struct vm_area probe = { .start = va };
+	struct treap_elem *e;
+	struct vm_area *vma;
+
+	e = treap_floor (&spt->vmas, &probe.elem);
+	if (e == NULL)
+		return NULL;
+	vma = treap_entry (e, struct vm_area, elem);
+	return va < vma->end ? vma : NULL;
+}
+
+/* Returns true if every page in [START, END) lies in some region of
+ * SPT. */
+bool
+spt_range_mapped (struct supplemental_page_table *spt, void *start,
+		void *end) {
+	struct vm_area *vma;
+	void *va;
+
+	for (va = start; va < end; va = vma->end)
+		if ((vma = spt_find_vma (spt, va)) == NULL)
+			return false;
+	return true;
+}
+
+/* Returns the page of SPT at VA if it has been materialized, or a null
+ * pointer.  Unlike spt_find_page(), never creates a page. */
+struct page *
+spt_lookup_page (struct supplemental_page_table *spt, void *va) {
+	struct page probe;
+	struct hash_elem *e;
+
+	probe.va = pg_round_down (va);
+	e = hash_find (&spt->pages, &probe.spt_elem);
+	return e != NULL ? hash_entry (e, struct page, spt_elem) : NULL;
 }
 
-/* Find VA from spt and return page. On error, return NULL. */
+/* Find VA from spt and return page. On error, return NULL.
+ * The first lookup of a page inside a region materializes it as an
+ * uninit page. */
 struct page *
-spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
-	struct page *page = NULL;
-	/* TODO: Fill this function. */
+spt_find_page (struct supplemental_page_table *spt, void *va) {
+	struct vm_area *vma;
+	struct page *page;
 
+	page = spt_lookup_page (spt, va);
+	if (page != NULL)
+		return page;
+
+	va = pg_round_down (va);
+	vma = spt_find_vma (spt, va);
+	if (vma == NULL)
+		return NULL;
+	page = malloc (sizeof *page);
+	if (page == NULL)
+		return NULL;
+	uninit_new (page, va, vma->init, vma->type, vma->aux,
+			page_initialize);
+	page->vma = vma;
+	spt_insert_page (spt, page);
 	return page;
 }
 
-/* Insert PAGE into spt with validation. */
+/* Insert PAGE into spt with validation.  PAGE->vma must already be set. */
 bool
-spt_insert_page (struct supplemental_page_table *spt UNUSED,
-		struct page *page UNUSED) {
-	int succ = false;
-	/* TODO: Fill this function. */
+spt_insert_page (struct supplemental_page_table *spt,
+		struct page *page) {
+	ASSERT (page->vma != NULL);
+	ASSERT (page->va >= page->vma->start && page->va < page->vma->end);
 
-	return succ;
+	if (hash_insert (&spt->pages, &page->spt_elem) != NULL)
+		return false;
+	list_push_back (&page->vma->pages, &page->vma_elem);
+	page->owner = thread_current ();
+	return true;
 }
 
 void
 spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
+	hash_delete (&spt->pages, &page->spt_elem);
+	list_remove (&page->vma_elem);
 	vm_dealloc_page (page);
-	return true;
+}
+
+/* Adds DELTA to the resident set size of PAGE's owner.  Pages are
+ * linked to frames both with and without the frame table lock held, so
+ * this turns interrupts off instead. */
+static void
+rss_charge (struct page *page, int delta) {
+	enum intr_level old_level = intr_disable ();
+
+	page->owner->rss += delta;
+	intr_set_level (old_level);
+}
+
+/* Links PAGE to FRAME. */
+static void
+frame_link (struct frame *frame, struct page *page) {
+	list_push_back (&frame->pages, &page->frame_elem);
+	frame->page_cnt++;
+	if (frame->page == NULL)
+		frame->page = page;
+	page->frame = frame;
+	rss_charge (page, 1);
+}
+
+/* Unlinks PAGE from its frame.  Returns the number of pages still
+ * linked to the frame. */
+static size_t
+frame_unlink (struct page *page) {
+	struct frame *frame = page->frame;
+
+	list_remove (&page->frame_elem);
+	page->frame = NULL;
+	frame->page_cnt--;
+	rss_charge (page, -1);
+	if (frame->page == page)
+		frame->page = frame->page_cnt > 0
+			? list_entry (list_front (&frame->pages), struct page, frame_elem)
+			: NULL;
+	return frame->page_cnt;
+}
+
+/* Returns whether PAGE, which has a frame, may be mapped writable: only
+ * if its region is writable and no other process shares the frame
+ * copy-on-write.  Pages of shared regions share it writable. */
+static bool
+page_map_writable (struct page *page) {
+	return page->vma->writable
+		&& (page->frame->page_cnt == 1 || page->vma->shm != NULL);
+}
+
+/* Sets the text cache key of FRAME to the part of an executable that
+ * PAGE, a page of a VM_TEXT region, holds. */
+static void
+text_key (struct frame *frame, struct page *page) {
+	struct vm_area *vma = page->vma;
+
+	frame->inode = file_get_inode (vma->file);
+	frame->offset = vma->offset + ((uint8_t *) page->va - (uint8_t *) vma->start);
+	frame->read_bytes = vma_page_read_bytes (vma, page->va);
+}
+
+/* Adds FRAME, just filled with the contents of PAGE, a page of a VM_TEXT
+ * region, to the text cache.  If another process got there first, FRAME
+ * stays private to PAGE. */
+static void
+text_cache_insert (struct frame *frame, struct page *page) {
+	lock_acquire (&frame_lock);
+	text_key (frame, page);
+	if (hash_insert (&text_cache, &frame->text_elem) != NULL)
+		frame->inode = NULL;
+	lock_release (&frame_lock);
+}
+
+/* Removes FRAME from the text cache, if it is there.  The caller must
+ * hold the frame table lock. */
+static void
+text_uncache (struct frame *frame) {
+	if (frame->inode != NULL) {
+		hash_delete (&text_cache, &frame->text_elem);
+		frame->inode = NULL;
+	}
+}
+
+/* Maps PAGE, a page of a VM_TEXT region of the current process, to the
+ * frame in the text cache holding the same part of the executable.
+ * Returns false, leaving PAGE as it was, if there is no such frame. */
+static bool
+text_share (struct page *page) {
+	struct frame probe;
+	struct hash_elem *e;
+	struct frame *frame;
+	bool success = false;
+
+	text_key (&probe, page);
+	lock_acquire (&frame_lock);
+	e = hash_find (&text_cache, &probe.text_elem);
+	if (e != NULL && (VM_TYPE (page->operations->type) != VM_UNINIT
+				|| page_initialize (page, page->uninit.type, NULL))) {
+		frame = hash_entry (e, struct frame, text_elem);
+		frame_link (frame, page);
+		success = pml4_set_page (thread_current ()->pml4, page->va,
+				frame->kva, false);
+		if (success)
+			vm_stats.text_shares++;
+		else
+			vm_release_frame (page);
+	}
+	lock_release (&frame_lock);
+	return success;
 }
 
 /* Get the struct frame, that will be evicted. */
 static struct frame *
 vm_get_victim (void) {
-	struct frame *victim = NULL;
-	 /* TODO: The policy for eviction is up to you. */
+	struct frame *frame;
 
-	return victim;
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+	frame = policy->victim ();
+	if (frame != NULL)
+		frame->active = false;
+	return frame;
 }
 
-/* Evict one page and return the corresponding frame.
- * Return NULL on error.*/
+/* Unmaps every page of FRAME, so that no owner changes it while it is
+ * written out.  The dirty bits survive. */
+static void
+frame_unmap (struct frame *frame) {
+	struct list_elem *e;
+
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+
+		pml4_clear_page (page->owner->pml4, page->va);
+	}
+}
+
+/* Maps FRAME back into every page of it, after eviction failed, and
+ * returns it to the eviction policy. */
+static void
+frame_remap (struct frame *frame) {
+	struct list_elem *e;
+
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+
+		pml4_set_page (page->owner->pml4, page->va, frame->kva,
+				page_map_writable (page));
+	}
+	policy->add (frame);
+	frame->active = true;
+}
+
+/* Returns true if FRAME, just unmapped for eviction, holds a private
+ * anonymous page given MADV_FREE and not written since, which can simply
+ * be dropped.  The page reads as zeros from then on. */
+static bool
+frame_lazy_free (struct frame *frame) {
+	struct page *page = frame->page;
+
+	if (VM_TYPE (page->operations->type) != VM_ANON || !page->anon.lazy_free)
+		return false;
+	page->anon.lazy_free = false;
+	if (frame->page_cnt != 1 || pml4_is_dirty (page->owner->pml4, page->va))
+		return false;
+	page->anon.swap_slot = SWAP_SLOT_ZERO;
+	vm_stats.lazy_frees++;
+	return true;
+}
+
+/* Tells the eviction policy that FRAME will not be needed soon, and
+ * clears its accessed bit so that it gets no second chance.  Frames
+ * shared between processes are left alone.  The caller must hold the
+ * frame table lock. */
+static void
+frame_cold (struct frame *frame) {
+	if (!frame->active || frame->page_cnt != 1)
+		return;
+	pml4_set_accessed (frame->page->owner->pml4, frame->page->va, false);
+	policy->cold (frame);
+	vm_stats.cold_marks++;
+}
+
+/* Unlinks every page of FRAME. */
+static void
+frame_unlink_all (struct frame *frame) {
+	while (!list_empty (&frame->pages))
+		frame_unlink (list_entry (list_front (&frame->pages),
+					struct page, frame_elem));
+}
+
+/* Returns true if the current process has as many pages resident as
+ * its limit allows. */
+static bool
+rss_over_limit (void) {
+	struct thread *t = thread_current ();
+
+	return t->rss_limit > 0 && t->rss >= t->rss_limit;
+}
+
+/* Returns the page of T that maps FRAME, or a null pointer if none
+ * does. */
+static struct page *
+frame_page_of (struct frame *frame, struct thread *t) {
+	struct list_elem *e;
+
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+
+		if (page->owner == t)
+			return page;
+	}
+	return NULL;
+}
+
+/* Chooses a frame of the current process to evict in favour of another
+ * of its own, and takes it from the eviction policy.  The process's
+ * working set is estimated from accessed bits, clock-style: the hand
+ * sweeps the frame table, clearing the accessed bit of each frame of
+ * the process it passes, and stops at one whose bit is already clear,
+ * which has gone untouched for a whole sweep.  Frames the process
+ * shares, copy-on-write after fork or through a shared region, count
+ * as its own, so that a process whose pages are mostly shared is held
+ * to its limit all the same; evicting one unmaps it from the other
+ * processes too.  Returns a null pointer only if none of the process's
+ * frames is with the eviction policy, which means all of them are
+ * being evicted already.  The caller must hold the frame table lock. */
 static struct frame *
-vm_evict_frame (void) {
-	struct frame *victim UNUSED = vm_get_victim ();
-	/* TODO: swap out the victim and return the evicted frame. */
+rss_victim (void) {
+	struct thread *t = thread_current ();
+	size_t frame_cnt = palloc_user_page_cnt ();
+	size_t i;
 
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	for (i = 0; i < 2 * frame_cnt; i++) {
+		struct frame *frame = &frame_table[t->rss_hand];
+		struct page *page;
+
+		t->rss_hand = (t->rss_hand + 1) % frame_cnt;
+		if (!frame->active || (page = frame_page_of (frame, t)) == NULL)
+			continue;
+		if (pml4_is_accessed (t->pml4, page->va)) {
+			pml4_set_accessed (t->pml4, page->va, false);
+			continue;
+		}
+		policy->remove (frame);
+		frame->active = false;
+		vm_stats.rss_reclaims++;
+		return frame;
+	}
 	return NULL;
 }
 
+/* Evict one page and return the corresponding frame.
+ * Return NULL on error.
+ * Up to MAX_CNT frames, at most SWAP_CLUSTER, are reclaimed at a time,
+ * so that anonymous pages go out to swap together, in one transfer, to
+ * adjacent slots.  The frames not returned go back to the user pool,
+ * where the next few allocations find them without evicting anything.
+ * Victims come from PICK, which takes each from the eviction policy, or
+ * returns a null pointer when there are no more. */
+static struct frame *
+vm_evict_with (struct frame *(*pick) (void), size_t max_cnt) {
+	struct frame *victims[SWAP_CLUSTER];
+	struct frame *anon[SWAP_CLUSTER];
+	struct frame *frame;
+	size_t victim_cnt = 0, anon_cnt = 0, written, i;
+
+	ASSERT (max_cnt > 0 && max_cnt <= SWAP_CLUSTER);
+
+	while (victim_cnt + anon_cnt < max_cnt && (frame = pick ()) != NULL) {
+		frame_unmap (frame);
+		if (frame->slot != NULL) {
+			/* A shared object's page that no process maps. */
+			if (shm_evict (frame))
+				victims[victim_cnt++] = frame;
+			else
+				frame_remap (frame);
+		} else if (frame_lazy_free (frame))
+			victims[victim_cnt++] = frame;
+		else if (VM_TYPE (frame->page->operations->type) == VM_ANON)
+			anon[anon_cnt++] = frame;
+		else if (swap_out (frame->page))
+			victims[victim_cnt++] = frame;
+		else
+			frame_remap (frame);
+	}
+
+	written = anon_swap_out_cluster (anon, anon_cnt);
+	for (i = 0; i < anon_cnt; i++)
+		if (i < written)
+			victims[victim_cnt++] = anon[i];
+		else
+			frame_remap (anon[i]);
+
+	if (victim_cnt == 0)
+		return NULL;
+	for (i = 0; i < victim_cnt; i++) {
+		frame_unlink_all (victims[i]);
+		text_uncache (victims[i]);
+		if (i > 0)
+			palloc_free_page (victims[i]->kva);
+	}
+	vm_stats.evictions += victim_cnt;
+	return victims[0];
+}
+
+/* Evicts pages chosen by the eviction policy, as vm_evict_with(). */
+static struct frame *
+vm_evict_frame (void) {
+	return vm_evict_with (vm_get_victim, SWAP_CLUSTER);
+}
+
 /* palloc() and get frame. If there is no available page, evict the page
- * and return it. This always return valid address. That is, if the user pool
- * memory is full, this function evicts the frame to get the available memory
- * space.*/
+ * and return it.  Returns NULL if the user pool is full and no frame can
+ * be evicted.  The frame is private to the caller until it is passed to
+ * frame_activate() or frame_free().  A process at its resident limit
+ * gets one of its own frames back, if it has any to give up, so that it
+ * pages against itself rather than against everyone else. */
 static struct frame *
 vm_get_frame (void) {
-	struct frame *frame = NULL;
-	/* TODO: Fill this function. */
+	struct frame *frame;
+
+	if (rss_over_limit ()) {
+		lock_acquire (&frame_lock);
+		frame = vm_evict_with (rss_victim, 1);
+		lock_release (&frame_lock);
+		if (frame != NULL)
+			return frame;
+	}
+
+	/* Try the pool before taking the lock, which the page-out daemon
+	 * may be holding across a write. */
+	frame = frame_alloc ();
+	if (frame != NULL)
+		return frame;
+
+	lock_acquire (&frame_lock);
+	frame = frame_alloc ();
+	if (frame == NULL) {
+		frame = vm_evict_frame ();
+		vm_stats.direct_reclaims++;
+	}
+	lock_release (&frame_lock);
+	return frame;
+}
+
+/* Evicts pages ahead of demand and returns their frames to the user
+ * pool.  Returns the number of frames freed, which is 0 if there is
+ * nothing to evict. */
+size_t
+vm_reclaim (void) {
+	struct frame *frame;
+	long long evictions;
+
+	lock_acquire (&frame_lock);
+	evictions = vm_stats.evictions;
+	frame = vm_evict_frame ();
+	if (frame != NULL)
+		palloc_free_page (frame->kva);
+	evictions = vm_stats.evictions - evictions;
+	lock_release (&frame_lock);
+	return evictions;
+}
+
+/* Like vm_get_frame(), but returns a null pointer instead of evicting a
+ * page if the user pool is empty, or if the current process is at its
+ * resident limit.  For speculative uses such as reading ahead. */
+struct frame *
+vm_get_frame_nowait (void) {
+	return rss_over_limit () ? NULL : frame_alloc ();
+}
+
+/* Takes a frame from the user pool, or returns a null pointer if it is
+ * empty. */
+static struct frame *
+frame_alloc (void) {
+	struct frame *frame;
+	void *kva = palloc_get_page (PAL_USER);
 
-	ASSERT (frame != NULL);
-	ASSERT (frame->page == NULL);
+	kswapd_poke ();
+	if (kva == NULL)
+		return NULL;
+	frame = &frame_table[palloc_user_page_no (kva)];
+	frame->kva = kva;
+	frame->page = NULL;
+	list_init (&frame->pages);
+	frame->page_cnt = 0;
+	frame->active = false;
+	frame->inode = NULL;
+	frame->slot = NULL;
 	return frame;
 }
 
-/* Growing the stack. */
+/* Hands FRAME, now mapped, to the eviction policy. */
+static void
+frame_activate (struct frame *frame) {
+	lock_acquire (&frame_lock);
+	policy->add (frame);
+	frame->active = true;
+	lock_release (&frame_lock);
+}
+
+/* Frees FRAME, obtained from vm_get_frame() but never activated, and
+ * unlinks it from its page. */
 static void
-vm_stack_growth (void *addr UNUSED) {
+frame_free (struct frame *frame) {
+	lock_acquire (&frame_lock);
+	frame_unlink_all (frame);
+	palloc_free_page (frame->kva);
+	lock_release (&frame_lock);
+}
+
+/* Maps FRAME, which holds the contents of PAGE of the current process,
+ * into PAGE and hands it to the eviction policy.  If PAGE cannot be
+ * mapped, frees FRAME and returns false. */
+bool
+vm_install_frame (struct page *page, struct frame *frame) {
+	frame_link (frame, page);
+	if (!pml4_set_page (thread_current ()->pml4, page->va, frame->kva,
+				page->vma->writable)) {
+		frame_free (frame);
+		return false;
+	}
+	frame_activate (frame);
+	return true;
+}
+
+/* Acquires the frame table lock, which keeps the frame of every page
+ * where it is. */
+void
+vm_frame_lock (void) {
+	lock_acquire (&frame_lock);
+}
+
+/* Releases the frame table lock. */
+void
+vm_frame_unlock (void) {
+	lock_release (&frame_lock);
 }
 
-/* Handle the fault on write_protected page */
+/* Unmaps PAGE from its owner, even if it has no frame of its own, and
+ * drops its reference to its frame, if it has one, freeing the frame if
+ * no other page shares it.  The caller must hold the frame table lock. */
+void
+vm_release_frame (struct page *page) {
+	struct frame *frame = vm_detach_frame (page);
+
+	if (frame != NULL)
+		palloc_free_page (frame->kva);
+}
+
+/* Like vm_release_frame(), but a frame no other page shares is taken
+ * from the eviction policy and returned rather than freed, for the
+ * caller to keep.  Returns a null pointer otherwise.  The caller must
+ * hold the frame table lock. */
+struct frame *
+vm_detach_frame (struct page *page) {
+	struct frame *frame = page->frame;
+	uint64_t *pml4 = page->owner->pml4;
+
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	if (pml4 != NULL)
+		pml4_clear_page (pml4, page->va);
+	if (frame == NULL || frame_unlink (page) > 0)
+		return NULL;
+	policy->remove (frame);
+	frame->active = false;
+	text_uncache (frame);
+	return frame;
+}
+
+/* Like vm_detach_frame(), for PAGE, a page of a shared region, except
+ * that a frame no other page maps stays with the eviction policy, held
+ * for PAGE's slot of the object.  Another process mapping the page
+ * finds it there; otherwise it is written out only when evicted.  The
+ * caller must hold the frame table lock. */
+void
+vm_detach_shared (struct page *page) {
+	struct frame *frame = page->frame;
+	uint64_t *pml4 = page->owner->pml4;
+
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	if (pml4 != NULL)
+		pml4_clear_page (pml4, page->va);
+	if (frame != NULL && frame_unlink (page) == 0)
+		frame->slot = page->shm.slot;
+}
+
+/* Frees FRAME, which vm_detach_shared() left held for the slot of an
+ * object that is going away.  The caller must hold the frame table
+ * lock. */
+void
+vm_free_held_frame (struct frame *frame) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+	ASSERT (frame->active && frame->page_cnt == 0);
+
+	policy->remove (frame);
+	frame->active = false;
+	frame->slot = NULL;
+	palloc_free_page (frame->kva);
+}
+
+/* Returns entry IDX of the frame table, which has one entry for each of
+ * the palloc_user_page_cnt() pages in the user pool.  Only an active
+ * entry is in use.  The caller must hold the frame table lock. */
+struct frame *
+vm_frame_at (size_t idx) {
+	ASSERT (idx < palloc_user_page_cnt ());
+	return &frame_table[idx];
+}
+
+/* Moves every page of SRC over to DST, which holds the same contents,
+ * and frees SRC.  The pages are mapped read-only, so DST ends up shared
+ * copy-on-write, as after fork.  Both frames must be active and all
+ * their pages already read-only.  The caller must hold the frame table
+ * lock. */
+void
+vm_merge_frames (struct frame *dst, struct frame *src) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+	ASSERT (dst->active && src->active && dst != src);
+
+	while (!list_empty (&src->pages)) {
+		struct page *page = list_entry (list_front (&src->pages),
+				struct page, frame_elem);
+
+		/* Clearing first flushes the old translation.  The page
+		 * table page stays, so mapping again cannot fail. */
+		pml4_clear_page (page->owner->pml4, page->va);
+		frame_unlink (page);
+		frame_link (dst, page);
+		pml4_set_page (page->owner->pml4, page->va, dst->kva, false);
+	}
+	policy->remove (src);
+	src->active = false;
+	palloc_free_page (src->kva);
+}
+
+/* Growing the stack, by extending the stack region below it down to
+ * ADDR.  Returns false if ADDR is not just below the stack region or the
+ * stack would exceed STACK_MAX. */
+static bool
+vm_stack_growth (void *addr) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct vm_area probe = { .start = addr };
+	struct treap_elem *e;
+	struct vm_area *stack;
+
+	if ((uint8_t *) addr < (uint8_t *) USER_STACK - STACK_MAX)
+		return false;
+
+	/* ADDR lies in no region, so everything from its page up to the
+	 * next region is free. */
+	e = treap_ceil (&spt->vmas, &probe.elem);
+	if (e == NULL)
+		return false;
+	stack = treap_entry (e, struct vm_area, elem);
+	if ((stack->type & VM_STACK) == 0)
+		return false;
+
+	/* Moving the start down keeps the regions in order. */
+	stack->start = pg_round_down (addr);
+	return true;
+}
+
+/* Handle the fault on write_protected page.  Pages of writable regions
+ * are only mapped read-only while shared copy-on-write, so this breaks
+ * the sharing: the last process sharing a frame takes it over, and any
+ * other gets a copy.  A page mapped to the zero page gets a zeroed
+ * frame.  Sets *CLASS to what it took. */
+static bool
+vm_handle_wp (struct page *page, enum fault_class *class) {
+	uint64_t *pml4 = thread_current ()->pml4;
+	struct frame *frame;
+
+	if (!page->vma->writable)
+		return false;
+
+	lock_acquire (&frame_lock);
+	if (page->frame != NULL && page->frame->page_cnt == 1) {
+		pml4_set_writable (pml4, page->va, true);
+		lock_release (&frame_lock);
+		*class = FAULT_COW;
+		return true;
+	}
+	lock_release (&frame_lock);
+
+	frame = vm_get_frame ();
+	if (frame == NULL)
+		return false;
+
+	lock_acquire (&frame_lock);
+	if (page_is_zero (page)) {
+		memset (frame->kva, 0, PGSIZE);
+		page->anon.swap_slot = SWAP_SLOT_NONE;
+		vm_stats.zero_writes++;
+		*class = FAULT_ANON;
+	} else if (page->frame == NULL) {
+		/* Evicted in the meantime.  Retrying the access faults it
+		 * back in, privately. */
+		lock_release (&frame_lock);
+		frame_free (frame);
+		*class = FAULT_SPURIOUS;
+		return true;
+	} else {
+		copy_page (frame->kva, page->frame->kva);
+		vm_stats.cow_copies++;
+		*class = FAULT_COW;
+	}
+	vm_release_frame (page);
+	frame_link (frame, page);
+	if (!pml4_set_page (pml4, page->va, frame->kva, true)) {
+		lock_release (&frame_lock);
+		frame_free (frame);
+		return false;
+	}
+	policy->add (frame);
+	frame->active = true;
+	lock_release (&frame_lock);
+	return true;
+}
+
+/* Returns true if the page of VMA at VA, which may not have been looked
+ * up yet, can be filled from VMA's file.  A page that was written and
+ * then swapped out cannot, and neither can one past the end of the file
+ * data, such as the zero-filled tail of an ELF segment: a read maps
+ * that to the shared zero page rather than a frame of its own, so
+ * claiming one ahead of time would only waste it. */
+static bool
+page_is_refillable (struct vm_area *vma, void *va) {
+	struct page *page;
+	enum vm_type type;
+
+	if (va >= vma->end || vma_page_read_bytes (vma, va) == 0)
+		return false;
+	page = spt_lookup_page (&thread_current ()->spt, va);
+	if (page == NULL)
+		return true;
+	type = VM_TYPE (page->operations->type);
+	return page->frame == NULL && (type == VM_UNINIT || type == VM_FILE);
+}
+
+/* Maps pages following PAGE, which just faulted in, in the hope of
+ * saving their faults.  PAGE's region must have a backing file, so the
+ * pages are cheap to fill.  The number mapped adapts to the access
+ * pattern: it doubles, up to fault_around_max, each time a fault lands
+ * just past the pages mapped last time, and halves, down to none, each
+ * time one does not.  Only free frames are used; nothing is evicted to
+ * make room, and the pages mapped have their accessed bits clear, so
+ * they go first if they turn out not to be needed.  Pages of an
+ * executable that the text cache already holds share that frame, as
+ * they would on a fault of their own.  A region advised
+ * MADV_SEQUENTIAL always gets the largest window. */
+static void
+vm_fault_around (struct page *page) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct vm_area *vma = page->vma;
+	uint8_t *va = (uint8_t *) page->va + PGSIZE;
+	size_t i;
+
+	if (vma->advice == MADV_SEQUENTIAL)
+		vma->fault_window = fault_around_max > 0
+			? fault_around_max : FAULT_AROUND_SEQUENTIAL;
+	else {
+		if (page->va == vma->fault_next)
+			vma->fault_window = vma->fault_window == 0
+				? 1 : vma->fault_window * 2;
+		else
+			vma->fault_window /= 2;
+		if (vma->fault_window > fault_around_max)
+			vma->fault_window = fault_around_max;
+	}
+
+	for (i = 0; i < vma->fault_window && page_is_refillable (vma, va);
+			i++, va += PGSIZE) {
+		struct page *n = spt_find_page (spt, va);
+		struct frame *frame;
+
+		if (n == NULL)
+			break;
+		if ((vma->type & VM_TEXT) != 0 && text_share (n)) {
+			vm_stats.fault_arounds++;
+			continue;
+		}
+		if ((frame = vm_get_frame_nowait ()) == NULL
+				|| !vm_claim_frame (n, frame))
+			break;
+		vm_stats.fault_arounds++;
+	}
+	vma->fault_next = va;
+}
+
+/* Marks cold the pages just behind PAGE, which just faulted in, in a
+ * region advised MADV_SEQUENTIAL.  A single pass will not touch them
+ * again, so they should be evicted before anyone else's pages.  The
+ * pages marked are the ones mapped since the previous fault. */
+static void
+vm_drop_behind (struct page *page) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct vm_area *vma = page->vma;
+	uint8_t *va = page->va;
+	size_t window = vma->fault_window > 0 ? vma->fault_window : 1;
+	size_t i;
+
+	lock_acquire (&frame_lock);
+	for (i = 0; i < window && va > (uint8_t *) vma->start; i++) {
+		struct page *p;
+
+		va -= PGSIZE;
+		p = spt_lookup_page (spt, va);
+		if (p != NULL && p->frame != NULL)
+			frame_cold (p->frame);
+	}
+	lock_release (&frame_lock);
+}
+
+/* Returns true if PAGE has never been written and reads as zeros: an
+ * untouched page of an anonymous region, or of the part of an ELF
+ * segment past the end of its file data, or a page already mapped to
+ * the zero page. */
+static bool
+page_is_zero (struct page *page) {
+	struct vm_area *vma = page->vma;
+
+	switch (VM_TYPE (page->operations->type)) {
+		case VM_UNINIT:
+			return VM_TYPE (vma->type) == VM_ANON
+				&& (vma->init == NULL
+					|| (vma->file != NULL
+						&& vma_page_read_bytes (vma, page->va) == 0));
+		case VM_ANON:
+			return page->anon.swap_slot == SWAP_SLOT_ZERO;
+		default:
+			return false;
+	}
+}
+
+/* Maps PAGE, which reads as zeros, to the zero page, read-only, so that
+ * reading it takes no frame.  Writing it faults, and vm_handle_wp()
+ * gives it a frame of its own. */
+static bool
+vm_map_zero (struct page *page) {
+	if (VM_TYPE (page->operations->type) == VM_UNINIT
+			&& !page_initialize (page, page->uninit.type, NULL))
+		return false;
+	page->anon.swap_slot = SWAP_SLOT_ZERO;
+	if (!pml4_set_page (thread_current ()->pml4, page->va, zero_page, false))
+		return false;
+	vm_stats.faults++;
+	vm_stats.zero_maps++;
+	return true;
+}
+
+/* Returns what bringing in PAGE, which has no frame, involves. */
+static enum fault_class
+page_fault_class (struct page *page) {
+	struct vm_area *vma = page->vma;
+
+	switch (VM_TYPE (page->operations->type)) {
+		case VM_UNINIT:
+			if ((vma->type & VM_TEXT) != 0
+					|| (VM_TYPE (vma->type) == VM_ANON && vma->file != NULL))
+				return FAULT_ELF;
+			return VM_TYPE (vma->type) == VM_FILE ? FAULT_FILE : FAULT_ANON;
+		case VM_ANON:
+			return page->anon.swap_slot == SWAP_SLOT_ZERO
+				? FAULT_ANON : FAULT_SWAP;
+		case VM_FILE:
+			return (vma->type & VM_TEXT) != 0 ? FAULT_ELF : FAULT_FILE;
+		case VM_SHM:
+			if (vma->shm->file != NULL)
+				return FAULT_FILE;
+			return page->shm.slot != NULL
+				&& page->shm.slot->swap_slot != SWAP_SLOT_NONE
+				? FAULT_SWAP : FAULT_ANON;
+		default:
+			return FAULT_ANON;
+	}
+}
+
+/* Handles a page fault at ADDR, setting *CLASS to what it took.  Returns
+ * true on success. */
 static bool
-vm_handle_wp (struct page *page UNUSED) {
+vm_handle_fault (struct intr_frame *f, void *addr, bool user, bool write,
+		bool not_present, enum fault_class *class) {
+	struct thread *curr = thread_current ();
+	struct supplemental_page_table *spt = &curr->spt;
+	struct page *page;
+	bool grown = false;
+
+	if (addr == NULL || !is_user_vaddr (addr))
+		return false;
+
+	page = spt_find_page (spt, addr);
+	if (page == NULL) {
+		/* A fault just below the stack pointer grows the stack.  A
+		 * fault from kernel mode happened inside a system call, so
+		 * use the user stack pointer saved on entry. */
+		uint8_t *rsp = user ? (uint8_t *) f->rsp : curr->user_rsp;
+
+		if ((uint8_t *) addr < rsp - 8 || (uint8_t *) addr >= (uint8_t *) USER_STACK
+				|| !vm_stack_growth (addr))
+			return false;
+		page = spt_find_page (spt, addr);
+		if (page == NULL)
+			return false;
+		grown = true;
+	}
+
+	if (!not_present)
+		return write && vm_handle_wp (page, class);
+	if (write && !page->vma->writable)
+		return false;
+	if (page->frame != NULL) {
+		/* Fork links the child's pages to the parent's frames but
+		 * leaves mapping them to the child's first touch. */
+		bool success;
+
+		lock_acquire (&frame_lock);
+		if (page->frame != NULL) {
+			if (pml4_get_page (curr->pml4, page->va) != NULL) {
+				*class = FAULT_SPURIOUS;
+				success = true;
+			} else {
+				*class = FAULT_MINOR;
+				success = pml4_set_page (curr->pml4, page->va,
+						page->frame->kva, page_map_writable (page));
+			}
+			lock_release (&frame_lock);
+			return success;
+		}
+		/* Evicted in the meantime; bring it back in. */
+		lock_release (&frame_lock);
+	}
+	*class = grown ? FAULT_STACK : page_fault_class (page);
+	if (!write && page_is_zero (page))
+		return vm_map_zero (page);
+	if (!vm_do_claim_page (page))
+		return false;
+	vm_stats.faults++;
+	if (page->vma->advice == MADV_SEQUENTIAL)
+		vm_drop_behind (page);
+	if ((fault_around_max > 0 || page->vma->advice == MADV_SEQUENTIAL)
+			&& page->vma->advice != MADV_RANDOM
+			&& page->vma->file != NULL && page->vma->shm == NULL)
+		vm_fault_around (page);
+	return true;
 }
 
 /* Return true on success */
 bool
-vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
-		bool user UNUSED, bool write UNUSED, bool not_present UNUSED) {
-	struct supplemental_page_table *spt UNUSED = &thread_current ()->spt;
-	struct page *page = NULL;
-	/* TODO: Validate the fault */
-	/* TODO: Your code goes here */
+vm_try_handle_fault (struct intr_frame *f, void *addr,
+		bool user, bool write, bool not_present) {
+	uint64_t start = rdtsc ();
+	enum fault_class class = FAULT_BAD;
+	bool success;
 
-	return vm_do_claim_page (page);
+	success = vm_handle_fault (f, addr, user, write, not_present, &class);
+	faultstat_record (success ? class : FAULT_BAD, rdtsc () - start);
+	return success;
 }
 
 /* Free the page.
@@ -150,41 +1238,426 @@ vm_dealloc_page (struct page *page) {
 
 /* Claim the page that allocate on VA. */
 bool
-vm_claim_page (void *va UNUSED) {
-	struct page *page = NULL;
-	/* TODO: Fill this function */
+vm_claim_page (void *va) {
+	struct page *page = spt_find_page (&thread_current ()->spt, va);
 
+	if (page == NULL)
+		return false;
 	return vm_do_claim_page (page);
 }
 
 /* Claim the PAGE and set up the mmu. */
 static bool
 vm_do_claim_page (struct page *page) {
-	struct frame *frame = vm_get_frame ();
+	struct frame *frame;
 
+	if (page->vma->shm != NULL)
+		return vm_claim_shared (page);
+	if ((page->vma->type & VM_TEXT) != 0 && text_share (page))
+		return true;
+	frame = vm_get_frame ();
+	if (frame == NULL)
+		return false;
+	return vm_claim_frame (page, frame);
+}
+
+/* Fills FRAME with the contents of PAGE and maps it there.  Frees FRAME
+ * on failure. */
+static bool
+vm_claim_frame (struct page *page, struct frame *frame) {
 	/* Set links */
-	frame->page = page;
-	page->frame = frame;
+	frame_link (frame, page);
+
+	/* Fill the frame before mapping it, so user code never sees a
+	 * half-loaded page. */
+	if (!swap_in (page, frame->kva)
+			|| !pml4_set_page (thread_current ()->pml4, page->va, frame->kva,
+				page->vma->writable)) {
+		frame_free (frame);
+		return false;
+	}
+	if ((page->vma->type & VM_TEXT) != 0)
+		text_cache_insert (frame, page);
+	frame_activate (frame);
+	return true;
+}
+
+/* Claims PAGE, a page of a shared region: maps the frame its object
+ * already holds the page in, or else brings the page into a new frame
+ * and records that in the object.  The object's lock keeps two
+ * processes from bringing in the same page at once. */
+static bool
+vm_claim_shared (struct page *page) {
+	struct shm *shm = page->vma->shm;
+	struct shm_slot *slot;
+	struct frame *frame;
+	bool success = false;
+
+	if (VM_TYPE (page->operations->type) == VM_UNINIT
+			&& !page_initialize (page, page->uninit.type, NULL))
+		return false;
+
+	lock_acquire (&shm->lock);
+	lock_acquire (&frame_lock);
+	slot = shm_get_slot (page);
+	frame = slot != NULL ? slot->frame : NULL;
+	if (frame != NULL) {
+		/* No longer just held for the slot, if it was. */
+		frame->slot = NULL;
+		frame_link (frame, page);
+		success = pml4_set_page (thread_current ()->pml4, page->va,
+				frame->kva, page->vma->writable);
+		if (!success)
+			vm_detach_shared (page);
+	}
+	lock_release (&frame_lock);
+	if (slot == NULL || frame != NULL) {
+		lock_release (&shm->lock);
+		return slot != NULL && success;
+	}
+
+	frame = vm_get_frame ();
+	success = frame != NULL && vm_claim_frame (page, frame);
+	if (success) {
+		/* Unless it was evicted already. */
+		lock_acquire (&frame_lock);
+		slot->frame = page->frame;
+		lock_release (&frame_lock);
+	}
+	lock_release (&shm->lock);
+	return success;
+}
+
+/* Brings in the pages of VMA in [START, END) that are not in memory,
+ * for MADV_WILLNEED.  Like vm_fault_around(), this only uses free
+ * frames, and stops when there are none.  Pages that read as zeros are
+ * left to the zero page, and pages of shared regions to their next
+ * fault. */
+static void
+vm_prefetch (struct vm_area *vma, uint8_t *start, uint8_t *end) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *va;
+
+	if (vma->shm != NULL)
+		return;
+	for (va = start; va < end; va += PGSIZE) {
+		struct page *page = spt_find_page (spt, va);
+		struct frame *frame;
+
+		if (page == NULL)
+			break;
+		if (page->frame != NULL || page_is_zero (page))
+			continue;
+		if ((vma->type & VM_TEXT) != 0 && text_share (page)) {
+			vm_stats.prefetches++;
+			continue;
+		}
+		if ((frame = vm_get_frame_nowait ()) == NULL
+				|| !vm_claim_frame (page, frame))
+			break;
+		vm_stats.prefetches++;
+	}
+}
+
+/* Marks the private anonymous pages of VMA in [START, END) as free to
+ * drop, for MADV_FREE.  A page in memory keeps its contents until it is
+ * evicted, which writes nothing out unless the page was written in the
+ * meantime.  A page in swap is dropped at once.  Either way the page
+ * reads as zeros once dropped. */
+static void
+vm_lazy_free (struct vm_area *vma, uint8_t *start, uint8_t *end) {
+	struct list_elem *e;
+
+	if (vma->shm != NULL)
+		return;
+	lock_acquire (&frame_lock);
+	for (e = list_begin (&vma->pages); e != list_end (&vma->pages);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, vma_elem);
+		struct anon_page *anon = &page->anon;
+
+		if ((uint8_t *) page->va < start || (uint8_t *) page->va >= end
+				|| VM_TYPE (page->operations->type) != VM_ANON)
+			continue;
+		if (page->frame == NULL) {
+			if (anon->swap_slot != SWAP_SLOT_NONE
+					&& anon->swap_slot != SWAP_SLOT_ZERO) {
+				anon_swap_discard (anon->swap_slot);
+				anon->swap_slot = SWAP_SLOT_ZERO;
+			}
+		} else if (page->frame->page_cnt == 1) {
+			pml4_set_dirty (page->owner->pml4, page->va, false);
+			anon->lazy_free = true;
+			frame_cold (page->frame);
+		}
+	}
+	lock_release (&frame_lock);
+}
+
+/* Drops the pages of VMA in [START, END), for MADV_DONTNEED.  Dirty
+ * pages of file mappings are written back first.  Each page then
+ * starts over as if never touched: it is read in again from its file,
+ * or reads as zeros, on its next fault.  Pages of a shared region only
+ * let go of the object's page, which keeps its contents. */
+static void
+vm_drop (struct vm_area *vma, uint8_t *start, uint8_t *end) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct list_elem *e, *next;
+
+	for (e = list_begin (&vma->pages); e != list_end (&vma->pages); e = next) {
+		struct page *page = list_entry (e, struct page, vma_elem);
+
+		next = list_next (e);
+		if ((uint8_t *) page->va < start || (uint8_t *) page->va >= end)
+			continue;
+		if (page->frame != NULL)
+			vm_stats.drops++;
+		spt_remove_page (spt, page);
+	}
+}
+
+/* Applies ADVICE, one of the MADV_* values, to the LENGTH bytes at ADDR
+ * in the current process.  MADV_NORMAL, MADV_RANDOM and MADV_SEQUENTIAL
+ * describe how a region will be accessed, and apply to every region the
+ * range touches as a whole.  The rest act on the pages of the range
+ * right away.  Returns false, doing nothing, if ADDR is not page-aligned
+ * or any page of the range is not mapped. */
+bool
+do_madvise (void *addr, size_t length, int advice) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *start = addr, *end, *va, *next;
+	struct vm_area *vma;
 
-	/* TODO: Insert page table entry to map page's VA to frame's PA. */
+	if (pg_ofs (addr) != 0 || length == 0 || !is_user_vaddr (addr)
+			|| length > (uintptr_t) KERN_BASE - (uintptr_t) addr)
+		return false;
+	if (advice != MADV_NORMAL && advice != MADV_RANDOM
+			&& advice != MADV_SEQUENTIAL && advice != MADV_WILLNEED
+			&& advice != MADV_DONTNEED && advice != MADV_FREE)
+		return false;
+	end = pg_round_up (start + length);
+	if (!spt_range_mapped (spt, start, end))
+		return false;
 
-	return swap_in (page, frame->kva);
+	for (va = start; va < end; va = next) {
+		vma = spt_find_vma (spt, va);
+		next = (uint8_t *) vma->end < end ? (uint8_t *) vma->end : end;
+		switch (advice) {
+			case MADV_WILLNEED:
+				vm_prefetch (vma, va, next);
+				break;
+			case MADV_DONTNEED:
+				vm_drop (vma, va, next);
+				break;
+			case MADV_FREE:
+				vm_lazy_free (vma, va, next);
+				break;
+			default:
+				vma->advice = advice;
+				break;
+		}
+	}
+	return true;
+}
+
+/* Limits the current process to PAGES resident pages, or lifts the limit
+ * if PAGES is 0, and returns the previous limit.  Pages are not evicted
+ * to meet a new limit at once; the process gives up its own pages as it
+ * faults in new ones until it is back under.  Children forked from now
+ * on inherit the limit. */
+size_t
+vm_set_rss_limit (size_t pages) {
+	struct thread *t = thread_current ();
+	size_t old = t->rss_limit;
+
+	t->rss_limit = pages;
+	return old;
 }
 
 /* Initialize new supplemental page table */
 void
-supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
+supplemental_page_table_init (struct supplemental_page_table *spt) {
+	treap_init (&spt->vmas, vma_less, NULL);
+	hash_init (&spt->pages, page_hash, page_less, NULL);
 }
 
-/* Copy supplemental page table from src to dst */
+/* Gives PAGE, a page of the current process, a private copy of SRC, a
+ * file page of another process.  If SRC is not resident, PAGE is left
+ * to be read in on demand. */
+static bool
+spt_copy_file_page (struct page *page, struct page *src) {
+	struct frame *frame = vm_get_frame ();
+
+	if (frame == NULL)
+		return false;
+	frame_link (frame, page);
+
+	/* Getting our frame may have evicted SRC. */
+	lock_acquire (&frame_lock);
+	if (src->frame == NULL) {
+		lock_release (&frame_lock);
+		frame_free (frame);
+		return true;
+	}
+	copy_page (frame->kva, src->frame->kva);
+	lock_release (&frame_lock);
+
+	if (!page_initialize (page, page->uninit.type, frame->kva)
+			|| !pml4_set_page (thread_current ()->pml4, page->va, frame->kva,
+				page->vma->writable)) {
+		frame_free (frame);
+		return false;
+	}
+	frame_activate (frame);
+	return true;
+}
+
+/* Gives DST, a page of the current process, the contents of SRC, a page
+ * of another process that has been brought in at least once.  Anonymous
+ * pages are shared copy-on-write, from memory or from swap; nothing is
+ * copied until one side writes.  The page is linked to SRC's frame but
+ * not mapped: the page table of the current process is filled in by
+ * faults, for the pages it turns out to touch, so that a fork followed
+ * by exec costs no page table work for the pages it never touches. */
+static bool
+spt_copy_page (struct supplemental_page_table *dst, struct page *src) {
+	struct page *page;
+
+	/* Text is shared through the text cache on the first fault. */
+	if ((src->vma->type & VM_TEXT) != 0)
+		return true;
+
+	page = spt_find_page (dst, src->va);
+	if (page == NULL)
+		return false;
+	if (VM_TYPE (src->operations->type) == VM_FILE)
+		return spt_copy_file_page (page, src);
+
+	/* Transmute the page straight into SRC's type instead of running its
+	 * initializer, which would only reload what is shared here. */
+	if (!page_initialize (page, page->uninit.type, NULL))
+		return false;
+
+	lock_acquire (&frame_lock);
+	if (src->frame != NULL) {
+		frame_link (src->frame, page);
+		pml4_set_writable (src->owner->pml4, src->va, false);
+	} else
+		anon_swap_share (page, src);
+	lock_release (&frame_lock);
+	return true;
+}
+
+/* Copy supplemental page table from src to dst.  Runs in the context of
+ * the process that owns DST.  Regions are duplicated and anonymous pages
+ * are shared copy-on-write, so this takes time in proportion to the
+ * number of pages but copies none of them, nor maps them in DST's page
+ * table.  Pages never touched, and file pages not in memory, stay
+ * pending in DST and are read in on demand. */
 bool
-supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
-		struct supplemental_page_table *src UNUSED) {
+supplemental_page_table_copy (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src) {
+	struct treap_elem *e;
+	struct list_elem *p;
+
+	for (e = treap_first (&src->vmas); e != NULL; e = treap_next (&src->vmas, e)) {
+		struct vm_area *src_vma = treap_entry (e, struct vm_area, elem);
+		struct vm_area *vma = malloc (sizeof *vma);
+
+		if (vma == NULL)
+			return false;
+		*vma = *src_vma;
+		list_init (&vma->pages);
+		if (src_vma->file != NULL && (vma->file = file_reopen (src_vma->file)) == NULL) {
+			free (vma);
+			return false;
+		}
+		treap_insert (&dst->vmas, &vma->elem);
+		if (vma->shm != NULL) {
+			/* The child maps the same object, page by page as it
+			 * touches them. */
+			shm_ref (vma->shm);
+			continue;
+		}
+
+		for (p = list_begin (&src_vma->pages); p != list_end (&src_vma->pages);
+				p = list_next (p)) {
+			struct page *page = list_entry (p, struct page, vma_elem);
+
+			if (VM_TYPE (page->operations->type) != VM_UNINIT
+					&& !spt_copy_page (dst, page))
+				return false;
+		}
+	}
+	return true;
 }
 
-/* Free the resource hold by the supplemental page table */
+/* Free the resource hold by the supplemental page table.  Dirty file-backed
+ * pages are written back by their destroy operation, and the eviction
+ * policy forgets whatever it remembers of the current process's pages.
+ * SPT must be reinitialized before it is used again. */
 void
-supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
-	/* TODO: Destroy all the supplemental_page_table hold by thread and
-	 * TODO: writeback all the modified contents to the storage. */
+supplemental_page_table_kill (struct supplemental_page_table *spt) {
+	struct treap_elem *e;
+
+	while ((e = treap_first (&spt->vmas)) != NULL)
+		vma_destroy (spt, treap_entry (e, struct vm_area, elem));
+	hash_destroy (&spt->pages, NULL);
+
+	if (policy->forget != NULL) {
+		lock_acquire (&frame_lock);
+		policy->forget (thread_current ()->tid);
+		lock_release (&frame_lock);
+	}
+}
+
+/* Orders regions by start address. */
+static bool
+vma_less (const struct treap_elem *a_, const struct treap_elem *b_,
+		void *aux UNUSED) {
+	const struct vm_area *a = treap_entry (a_, struct vm_area, elem);
+	const struct vm_area *b = treap_entry (b_, struct vm_area, elem);
+
+	return a->start < b->start;
+}
+
+/* Returns a hash value for page P. */
+static uint64_t
+page_hash (const struct hash_elem *p_, void *aux UNUSED) {
+	const struct page *p = hash_entry (p_, struct page, spt_elem);
+
+	return hash_bytes (&p->va, sizeof p->va);
+}
+
+/* Returns true if page A precedes page B. */
+static bool
+page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct page *a = hash_entry (a_, struct page, spt_elem);
+	const struct page *b = hash_entry (b_, struct page, spt_elem);
+
+	return a->va < b->va;
+}
+
+/* Returns a hash value for the part of an executable frame F holds. */
+static uint64_t
+text_hash (const struct hash_elem *f_, void *aux UNUSED) {
+	const struct frame *f = hash_entry (f_, struct frame, text_elem);
+
+	return hash_bytes (&f->inode, sizeof f->inode)
+		^ hash_int (f->offset) ^ hash_int (f->read_bytes);
+}
+
+/* Returns true if the part of an executable in frame A precedes B's. */
+static bool
+text_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct frame *a = hash_entry (a_, struct frame, text_elem);
+	const struct frame *b = hash_entry (b_, struct frame, text_elem);
+
+	if (a->inode != b->inode)
+		return a->inode < b->inode;
+	if (a->offset != b->offset)
+		return a->offset < b->offset;
+	return a->read_bytes < b->read_bytes;
 }
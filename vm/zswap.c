@@ -0,0 +1,286 @@
+/* zswap.c: Compressed cache in front of the swap disk. */
+
+#include "vm/zswap.h"
+#include <hash.h>
+#include <list.h>
+#include <lz.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/vm.h"
+
+/* A page on its way to swap is compressed and kept in a pool of kernel
+ * pages instead, under the swap slot already allocated for it, until it
+ * is read back or the slot is freed.  Only when the pool is full is the
+ * least recently stored page decompressed and written to its slot.
+ * Slots keep their meaning throughout, so a page need not know where
+ * its contents are.
+ *
+ * The pool holds at most two compressed pages per kernel page, one at
+ * each end, as in zbud.  That wastes the space between them, but makes
+ * freeing one trivial and never needs compaction. */
+
+/* Pages compressing to more than this are not worth keeping. */
+#define ZSWAP_MAX_SIZE (PGSIZE * 3 / 4)
+
+/* A kernel page in the pool. */
+struct zpage {
+	void *kva;
+	struct zentry *first;        /* Entry at the start of the page, or NULL. */
+	struct zentry *last;         /* Entry at the end of the page, or NULL. */
+	struct list_elem elem;       /* In unbuddied, if it holds one entry. */
+};
+
+/* A compressed page. */
+struct zentry {
+	size_t slot;                 /* Swap slot it stands in for. */
+	struct zpage *zpage;         /* Where it is stored. */
+	size_t size;                 /* Compressed size in bytes. */
+	struct hash_elem hash_elem;  /* In entries. */
+	struct list_elem lru_elem;   /* In lru. */
+};
+
+/* Most pool pages, or 0 if zswap is off. */
+static size_t page_limit;
+static size_t page_cnt;
+
+/* zswap_lock guards everything below, and the scratch space. */
+static struct lock zswap_lock;
+static struct hash entries;          /* By slot. */
+static struct list lru;              /* Least recently stored first. */
+static struct list unbuddied;        /* Pool pages holding one entry. */
+static void *work;                   /* Compressor hash table. */
+static void *cbuf;                   /* Page being compressed into. */
+static void *wbuf;                   /* Page being written back. */
+
+static uint64_t
+zentry_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct zentry *z = hash_entry (e, struct zentry, hash_elem);
+
+	return hash_int (z->slot);
+}
+
+static bool
+zentry_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct zentry, hash_elem)->slot
+		< hash_entry (b, struct zentry, hash_elem)->slot;
+}
+
+/* Makes swap keep up to PAGE_LIMIT kernel pages of compressed pages in
+ * memory.  Must be called before vm_init(). */
+void
+zswap_enable (size_t limit) {
+	page_limit = limit;
+}
+
+/* Sets up the pool, if zswap_enable() asked for one.  Called once
+ * there is a swap disk to write back to. */
+void
+zswap_init (void) {
+	if (page_limit == 0)
+		return;
+	lock_init (&zswap_lock);
+	hash_init (&entries, zentry_hash, zentry_less, NULL);
+	list_init (&lru);
+	list_init (&unbuddied);
+	work = malloc (LZ_WORK_SIZE);
+	cbuf = palloc_get_page (0);
+	wbuf = palloc_get_page (0);
+	if (work == NULL || cbuf == NULL || wbuf == NULL)
+		PANIC ("zswap_init: out of memory");
+}
+
+static struct zentry *
+zentry_find (size_t slot) {
+	struct zentry probe = { .slot = slot };
+	struct hash_elem *e = hash_find (&entries, &probe.hash_elem);
+
+	return e != NULL ? hash_entry (e, struct zentry, hash_elem) : NULL;
+}
+
+static void *
+zentry_data (const struct zentry *z) {
+	uint8_t *kva = z->zpage->kva;
+
+	return z == z->zpage->first ? kva : kva + PGSIZE - z->size;
+}
+
+/* Finds room for Z in the pool and records where in Z.  Returns false
+ * if the pool is full. */
+static bool
+zpool_place (struct zentry *z) {
+	struct zpage *zp;
+	struct list_elem *e;
+
+	for (e = list_begin (&unbuddied); e != list_end (&unbuddied);
+			e = list_next (e)) {
+		struct zentry *other;
+
+		zp = list_entry (e, struct zpage, elem);
+		other = zp->first != NULL ? zp->first : zp->last;
+		if (other->size + z->size <= PGSIZE) {
+			if (zp->first == NULL)
+				zp->first = z;
+			else
+				zp->last = z;
+			list_remove (&zp->elem);
+			z->zpage = zp;
+			return true;
+		}
+	}
+
+	if (page_cnt >= page_limit || (zp = malloc (sizeof *zp)) == NULL)
+		return false;
+	zp->kva = palloc_get_page (0);
+	if (zp->kva == NULL) {
+		free (zp);
+		return false;
+	}
+	page_cnt++;
+	zp->first = z;
+	zp->last = NULL;
+	list_push_back (&unbuddied, &zp->elem);
+	z->zpage = zp;
+	return true;
+}
+
+/* Removes Z from the pool and frees it, and its pool page if that is
+ * now empty. */
+static void
+zentry_free (struct zentry *z) {
+	struct zpage *zp = z->zpage;
+
+	hash_delete (&entries, &z->hash_elem);
+	list_remove (&z->lru_elem);
+	if (zp->first == z)
+		zp->first = NULL;
+	else
+		zp->last = NULL;
+	if (zp->first == NULL && zp->last == NULL) {
+		list_remove (&zp->elem);
+		palloc_free_page (zp->kva);
+		free (zp);
+		page_cnt--;
+	} else
+		list_push_back (&unbuddied, &zp->elem);
+	free (z);
+}
+
+/* Decompresses Z into KVA. */
+static void
+zentry_decompress (struct zentry *z, void *kva) {
+	if (!lz_decompress (zentry_data (z), z->size, kva, PGSIZE))
+		PANIC ("zswap: swap slot %zu is corrupt", z->slot);
+}
+
+/* Writes the least recently stored page to its slot on disk and drops
+ * it.  Returns false if the pool is empty. */
+static bool
+zswap_write_back (void) {
+	struct zentry *z;
+	const void *kva = wbuf;
+
+	if (list_empty (&lru))
+		return false;
+	z = list_entry (list_front (&lru), struct zentry, lru_elem);
+	zentry_decompress (z, wbuf);
+	swap_write (z->slot, &kva, 1);
+	vm_stats.zswap_write_backs++;
+	zentry_free (z);
+	return true;
+}
+
+/* Compresses the page at KVA into the pool as the contents of swap
+ * slot SLOT, making room by writing older pages to disk if necessary.
+ * Returns false if the page is to be written to disk itself, because
+ * zswap is off or the page does not compress well. */
+bool
+zswap_store (size_t slot, const void *kva) {
+	struct zentry *z;
+	size_t size;
+
+	if (page_limit == 0)
+		return false;
+
+	lock_acquire (&zswap_lock);
+	ASSERT (zentry_find (slot) == NULL);
+	size = lz_compress (kva, PGSIZE, cbuf, ZSWAP_MAX_SIZE, work);
+	if (size == 0 || (z = malloc (sizeof *z)) == NULL) {
+		vm_stats.zswap_rejects++;
+		lock_release (&zswap_lock);
+		return false;
+	}
+	z->slot = slot;
+	z->size = size;
+	while (!zpool_place (z))
+		if (!zswap_write_back ()) {
+			free (z);
+			vm_stats.zswap_rejects++;
+			lock_release (&zswap_lock);
+			return false;
+		}
+	memcpy (zentry_data (z), cbuf, size);
+	hash_insert (&entries, &z->hash_elem);
+	list_push_back (&lru, &z->lru_elem);
+	vm_stats.zswap_stores++;
+	vm_stats.zswap_bytes += size;
+	lock_release (&zswap_lock);
+	return true;
+}
+
+/* Decompresses the contents of swap slot SLOT into KVA, if they are in
+ * the pool.  The pool keeps them until the slot is freed.  Returns false
+ * if they must be read from disk. */
+bool
+zswap_load (size_t slot, void *kva) {
+	struct zentry *z;
+
+	if (page_limit == 0)
+		return false;
+
+	lock_acquire (&zswap_lock);
+	z = zentry_find (slot);
+	if (z != NULL) {
+		zentry_decompress (z, kva);
+		vm_stats.zswap_hits++;
+	} else
+		vm_stats.zswap_misses++;
+	lock_release (&zswap_lock);
+	return z != NULL;
+}
+
+/* Forgets the contents of swap slot SLOT, which is being freed. */
+void
+zswap_invalidate (size_t slot) {
+	struct zentry *z;
+
+	if (page_limit == 0)
+		return;
+
+	lock_acquire (&zswap_lock);
+	z = zentry_find (slot);
+	if (z != NULL)
+		zentry_free (z);
+	lock_release (&zswap_lock);
+}
+
+/* Prints compressed cache statistics, if it is on. */
+void
+zswap_print_stats (void) {
+	long long ratio;
+
+	if (page_limit == 0)
+		return;
+	ratio = vm_stats.zswap_bytes > 0
+		? vm_stats.zswap_stores * PGSIZE * 100 / vm_stats.zswap_bytes : 0;
+	printf ("Zswap: %lld stores, %lld rejects, %lld hits, %lld misses, "
+			"%lld write-backs, %lld.%02lld:1 compression, %zu/%zu pool pages\n",
+			vm_stats.zswap_stores, vm_stats.zswap_rejects,
+			vm_stats.zswap_hits, vm_stats.zswap_misses,
+			vm_stats.zswap_write_backs, ratio / 100, ratio % 100,
+			page_cnt, page_limit);
+}